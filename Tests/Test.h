@@ -0,0 +1,66 @@
+/**
+ * @file Test.h
+ *
+ * @brief Minimal check and timing helpers shared by the host tests.
+ *
+ * Each test is its own executable; TEST_CHECK reports and counts failures so
+ * one run lists every broken case, and TEST_EXIT turns the count into the
+ * exit status CTest reads.
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+static int test_failures;
+
+#define TEST_CHECK(condition)                                                      \
+    do                                                                             \
+    {                                                                              \
+        if (!(condition))                                                          \
+        {                                                                          \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++;                                                       \
+        }                                                                          \
+    } while (0)
+
+#define TEST_EXIT() return (test_failures == 0) ? 0 : 1
+
+/**
+ * @brief Monotonic time in nanoseconds, for the host benchmarks.
+ */
+static inline uint64_t Test_Now_Ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TEST_HAVE_CYCLES 1
+
+/**
+ * @brief Time stamp counter, for cycle counts in the host benchmarks.
+ *
+ * The counter runs at the nominal clock rate, so under frequency scaling it
+ * counts reference cycles rather than core cycles.
+ */
+static inline uint64_t Test_Now_Cycles(void)
+{
+    return __rdtsc();
+}
+#else
+#define TEST_HAVE_CYCLES 0
+
+static inline uint64_t Test_Now_Cycles(void)
+{
+    return 0;
+}
+#endif
+
+#endif /* TEST_H */
@@ -0,0 +1,209 @@
+/**
+ * @file Test_Command_Hash.c
+ *
+ * @brief Builds the command hash for Command_Table.def and for synthetic
+ * tables of 10, 50 and 200 names, checks every lookup, and times a console
+ * lookup through the hash against the strcmp scan it replaced at each size.
+ */
+
+#include <string.h>
+
+#include "Test.h"
+#include "L3/Command_Hash.h"
+
+#define BENCHMARK_LOOKUPS 4000000
+#define SYNTHETIC_MAX_COMMANDS 200
+
+static const char *const registered_names[] = {
+#define COMMAND(name, opcode, arg_format, handler) #name,
+#include "L3/Command_Table.def"
+#undef COMMAND
+};
+
+#define REGISTERED_COUNT (sizeof(registered_names) / sizeof(registered_names[0]))
+
+/* Names no table may accept, including one too long to pack */
+static const char *const unknown_names[] = {"pidx", "spd", "gainsx", "chmode", "calibrate"};
+
+static const uint8_t synthetic_sizes[] = {10, 50, SYNTHETIC_MAX_COMMANDS};
+
+/* One table under test at a time */
+typedef struct
+{
+    const char *names[SYNTHETIC_MAX_COMMANDS];
+    uint8_t count;
+    uint64_t keys[SYNTHETIC_MAX_COMMANDS];
+    uint8_t displacements[COMMAND_HASH_BUCKETS(SYNTHETIC_MAX_COMMANDS)];
+    uint8_t slots[COMMAND_HASH_SLOTS(SYNTHETIC_MAX_COMMANDS)];
+    Command_Hash_t hash;
+} Table_t;
+
+static Table_t table;
+static char synthetic_storage[SYNTHETIC_MAX_COMMANDS][COMMAND_KEY_LENGTH + 1];
+
+/**
+ * @brief Pack and index a list of names, as Build_Command_Lookup does.
+ *
+ * @return true if the index was built
+ */
+static bool Build_Table(const char *const *names, uint8_t count)
+{
+    table.count = count;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        table.names[i] = names[i];
+        if (!Command_Pack_Key(names[i], &table.keys[i]))
+        {
+            return false;
+        }
+    }
+    table.hash.displacements = table.displacements;
+    table.hash.slots = table.slots;
+    return Command_Hash_Build(&table.hash, table.keys, count);
+}
+
+/**
+ * @brief Hash lookup, as Find_Command does for console messages.
+ */
+static int Hash_Lookup(const char *command)
+{
+    uint64_t key;
+    uint8_t index;
+
+    if (!Command_Pack_Key(command, &key))
+    {
+        return -1;
+    }
+    index = Command_Hash_Find(&table.hash, key);
+    return (index != COMMAND_HASH_EMPTY && table.keys[index] == key) ? index : -1;
+}
+
+/**
+ * @brief Linear strcmp scan, the dispatcher's lookup before the hash.
+ */
+static int Scan_Lookup(const char *command)
+{
+    for (uint8_t i = 0; i < table.count; i++)
+    {
+        if (strcmp(command, table.names[i]) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Every name resolves to itself and every unknown name to nothing.
+ */
+static void Check_Table(void)
+{
+    uint32_t failures = 0;
+
+    for (uint8_t i = 0; i < table.count; i++)
+    {
+        failures += Hash_Lookup(table.names[i]) != i;
+    }
+    for (size_t i = 0; i < sizeof(unknown_names) / sizeof(unknown_names[0]); i++)
+    {
+        failures += Hash_Lookup(unknown_names[i]) != -1;
+    }
+    TEST_CHECK(failures == 0);
+}
+
+/**
+ * @brief Distinct lowercase names of 3 to 8 characters from a fixed seed.
+ */
+static void Make_Synthetic_Names(uint8_t count)
+{
+    static const char *names[SYNTHETIC_MAX_COMMANDS];
+    uint32_t seed = 0x2545F491u;
+    uint8_t made = 0;
+
+    while (made < count)
+    {
+        char *name = synthetic_storage[made];
+        uint8_t length;
+        bool repeated = false;
+
+        seed = seed * 1664525u + 1013904223u;
+        length = 3 + (seed >> 24) % 6;
+        for (uint8_t i = 0; i < length; i++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            name[i] = (char)('a' + (seed >> 24) % 26);
+        }
+        name[length] = '\0';
+
+        for (uint8_t i = 0; i < made && !repeated; i++)
+        {
+            repeated = strcmp(names[i], name) == 0;
+        }
+        if (!repeated)
+        {
+            names[made++] = name;
+        }
+    }
+    TEST_CHECK(Build_Table(names, count));
+}
+
+/**
+ * @brief Mean time of a lookup by each method, cycling through every name.
+ */
+static void Benchmark_Lookup(const char *label)
+{
+    volatile int sink = 0; /* Keeps the lookups live */
+    uint64_t start;
+    uint64_t hash_ns;
+    uint64_t scan_ns;
+    uint8_t index = 0;
+
+    start = Test_Now_Ns();
+    for (uint32_t n = 0; n < BENCHMARK_LOOKUPS; n++)
+    {
+        sink = Hash_Lookup(table.names[index]);
+        index = (index + 1 == table.count) ? 0 : index + 1;
+    }
+    hash_ns = Test_Now_Ns() - start;
+
+    index = 0;
+    start = Test_Now_Ns();
+    for (uint32_t n = 0; n < BENCHMARK_LOOKUPS; n++)
+    {
+        sink = Scan_Lookup(table.names[index]);
+        index = (index + 1 == table.count) ? 0 : index + 1;
+    }
+    scan_ns = Test_Now_Ns() - start;
+
+    printf("%-10s %3u commands, %3u slots: hash %6.1f ns, strcmp scan %6.1f ns\n", label, table.count,
+           1u << table.hash.slot_bits, (double)hash_ns / BENCHMARK_LOOKUPS, (double)scan_ns / BENCHMARK_LOOKUPS);
+    (void)sink;
+}
+
+int main(void)
+{
+    uint64_t key;
+
+    TEST_CHECK(Build_Table(registered_names, REGISTERED_COUNT));
+    TEST_CHECK(COMMAND_HASH_SLOTS(REGISTERED_COUNT) >= 2 * REGISTERED_COUNT);
+    Check_Table();
+    Benchmark_Lookup("registered");
+
+    for (size_t i = 0; i < sizeof(synthetic_sizes) / sizeof(synthetic_sizes[0]); i++)
+    {
+        Make_Synthetic_Names(synthetic_sizes[i]);
+        TEST_CHECK(COMMAND_HASH_SLOTS(table.count) >= 2u * table.count);
+        Check_Table();
+        Benchmark_Lookup("synthetic");
+    }
+
+    /* The largest table the slot indices allow still gets twice the slots */
+    TEST_CHECK(COMMAND_HASH_SLOTS(COMMAND_HASH_MAX_COMMANDS) >= 2u * COMMAND_HASH_MAX_COMMANDS);
+
+    /* Repeated names cannot be separated */
+    TEST_CHECK(!Build_Table((const char *const[]){"pid", "spt", "pid"}, 3));
+
+    TEST_CHECK(Command_Pack_Key("pidbench", &key));
+    TEST_CHECK(!Command_Pack_Key("pidbenchx", &key));
+    TEST_EXIT();
+}
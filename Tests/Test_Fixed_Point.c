@@ -0,0 +1,313 @@
+/**
+ * @file Test_Fixed_Point.c
+ *
+ * @brief Checks the fixed-point operations and blocks bit for bit against a
+ * floating-point reference of the same rounding, and the low-pass and PID
+ * against their ideal real-valued forms.
+ *
+ * Products of two 32-bit values need 62 bits, so those references use long
+ * double, which carries a 64-bit mantissa on the x86 hosts the tests run on.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "Test.h"
+#include "Fixed_Point.h"
+
+#define RANDOM_CASES 1000000
+#define FILTER_STEPS 2000
+#define PID_STEPS 4000
+
+_Static_assert(LDBL_MANT_DIG >= 64, "The 62-bit product references need an extended long double");
+
+static int64_t Random_S64(uint8_t bits)
+{
+    uint64_t value = ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand();
+
+    if (bits == 64)
+    {
+        return (int64_t)value;
+    }
+    return (int64_t)(value & (((uint64_t)1 << bits) - 1)) - ((int64_t)1 << (bits - 1));
+}
+
+/**
+ * @brief Round to nearest with halves upwards, and saturate, in double precision.
+ *
+ * Exact while the operands stay within the 53-bit mantissa.
+ */
+static int64_t Reference_Round(double value, double low, double high)
+{
+    return (int64_t)fmin(high, fmax(low, floor(value + 0.5)));
+}
+
+/**
+ * @brief Reference_Round in long double, exact for any 64-bit integer or 62-bit product.
+ */
+static int64_t Reference_Round_Long(long double value, long double low, long double high)
+{
+    return (int64_t)fminl(high, fmaxl(low, floorl(value + 0.5L)));
+}
+
+static void Test_Round_Shift(void)
+{
+    uint32_t failures = 0;
+
+    for (uint32_t n = 0; n < RANDOM_CASES; n++)
+    {
+        int64_t value = Random_S64(52);
+        uint8_t shift = 1 + n % 40;
+
+        failures += Fixed_Round_Shift(value, shift) !=
+                    Reference_Round(ldexp((double)value, -shift), -INFINITY, INFINITY);
+    }
+    TEST_CHECK(failures == 0);
+
+    /* Halves round upwards, including negative ones */
+    TEST_CHECK(Fixed_Round_Shift(3, 1) == 2);
+    TEST_CHECK(Fixed_Round_Shift(-3, 1) == -1);
+
+    /* The rounding increment cannot overflow */
+    TEST_CHECK(Fixed_Round_Shift(INT64_MAX, 16) == INT64_MAX >> 16);
+}
+
+static void Test_Saturating_Arithmetic(void)
+{
+    uint32_t failures = 0;
+
+    for (uint32_t n = 0; n < RANDOM_CASES; n++)
+    {
+        int32_t a = (int32_t)Random_S64(32);
+        int32_t b = (int32_t)Random_S64(32);
+        int32_t value = (int32_t)Random_S64(18);
+
+        failures += Fixed_Sub_Saturate(a, b) != Reference_Round((double)a - b, INT32_MIN, INT32_MAX);
+        failures += Fixed_Saturate_32((int64_t)a * 4) != Reference_Round((double)a * 4, INT32_MIN, INT32_MAX);
+        failures += Fixed_Q16_From_Int(value) != Reference_Round(value * 65536.0, INT32_MIN, INT32_MAX);
+        failures += Fixed_Q16_To_Float((Fixed_Q16_t)value) != (float)(value / 65536.0);
+    }
+    TEST_CHECK(failures == 0);
+    TEST_CHECK(Fixed_Q16_From_Int(-32768) == INT32_MIN);
+    TEST_CHECK(Fixed_Q16_From_Int(32768) == INT32_MAX);
+}
+
+static void Test_Saturate_16_And_Add(void)
+{
+    uint32_t failures = 0;
+
+    for (uint32_t n = 0; n < RANDOM_CASES; n++)
+    {
+        int32_t a = (int32_t)Random_S64(32);
+        int32_t b = (int32_t)Random_S64(32);
+        int32_t narrow = (int32_t)Random_S64(18);
+
+        failures += Fixed_Add_Saturate(a, b) != Reference_Round((double)a + b, INT32_MIN, INT32_MAX);
+        failures += Fixed_Saturate_16(narrow) != Reference_Round(narrow, INT16_MIN, INT16_MAX);
+    }
+    TEST_CHECK(failures == 0);
+    TEST_CHECK(Fixed_Add_Saturate(INT32_MAX, 1) == INT32_MAX);
+    TEST_CHECK(Fixed_Add_Saturate(INT32_MIN, -1) == INT32_MIN);
+}
+
+static void Test_Multiply(void)
+{
+    uint32_t failures = 0;
+
+    for (uint32_t n = 0; n < RANDOM_CASES; n++)
+    {
+        Fixed_Q15_t a15 = (Fixed_Q15_t)Random_S64(16);
+        Fixed_Q15_t b15 = (Fixed_Q15_t)Random_S64(16);
+        int32_t a = (int32_t)Random_S64(32);
+        int32_t b = (int32_t)Random_S64(32);
+
+        failures += Fixed_Mul_Q15(a15, b15) != Reference_Round((double)a15 * b15 / 32768.0, INT16_MIN, INT16_MAX);
+        failures += Fixed_Mul_Q31(a, b) !=
+                    Reference_Round_Long(ldexpl((long double)a * b, -31), INT32_MIN, INT32_MAX);
+        failures += Fixed_Mul_Q16(a, b) !=
+                    Reference_Round_Long(ldexpl((long double)a * b, -16), INT32_MIN, INT32_MAX);
+    }
+    TEST_CHECK(failures == 0);
+
+    /* -1 x -1 is the one product out of range in Q15 and Q31 */
+    TEST_CHECK(Fixed_Mul_Q15(INT16_MIN, INT16_MIN) == INT16_MAX);
+    TEST_CHECK(Fixed_Mul_Q31(INT32_MIN, INT32_MIN) == INT32_MAX);
+    TEST_CHECK(Fixed_Mul_Q31(FIXED_Q31(0.5), FIXED_Q31(-0.5)) == FIXED_Q31(-0.25));
+    TEST_CHECK(Fixed_Mul_Q16(FIXED_Q16(300.0), FIXED_Q16(300.0)) == INT32_MAX);
+    TEST_CHECK(Fixed_Mul_Q16(FIXED_Q16(-1.5), FIXED_Q16(2.25)) == FIXED_Q16(-3.375));
+}
+
+/**
+ * @brief Runs of products into one accumulator, saturating at each step as the
+ * accumulator does.
+ */
+static void Test_Mac(void)
+{
+    uint32_t failures = 0;
+
+    for (uint32_t run = 0; run < RANDOM_CASES / 64; run++)
+    {
+        int64_t accumulator = Random_S64(64);
+        long double reference = (long double)accumulator;
+
+        for (uint8_t n = 0; n < 64; n++)
+        {
+            int32_t a = (int32_t)Random_S64(32);
+            int32_t b = (int32_t)Random_S64(32);
+
+            accumulator = Fixed_Mac(accumulator, a, b);
+            reference = fminl((long double)INT64_MAX, fmaxl((long double)INT64_MIN, reference + (long double)a * b));
+            failures += accumulator != (int64_t)reference;
+        }
+    }
+    TEST_CHECK(failures == 0);
+
+    TEST_CHECK(Fixed_Mac(INT64_MAX - 1, 2, 1) == INT64_MAX);
+    TEST_CHECK(Fixed_Mac(INT64_MIN + 1, -2, 1) == INT64_MIN);
+    TEST_CHECK(Fixed_Mac(INT64_MAX, -1, 1) == INT64_MAX - 1); /* Saturation is not sticky */
+}
+
+static void Test_Constants(void)
+{
+    TEST_CHECK(FIXED_Q15(0.625) == 20480);
+    TEST_CHECK(FIXED_Q15(-0.5) == -16384);
+    TEST_CHECK(FIXED_Q15(0.99997) == 32767);
+    TEST_CHECK(FIXED_Q15(1.0 / 3.0) == (Fixed_Q15_t)Reference_Round(32768.0 / 3.0, INT16_MIN, INT16_MAX));
+    TEST_CHECK(FIXED_Q31(0.5) == 0x40000000);
+    TEST_CHECK(FIXED_Q31(-1.0 / 3.0) == (Fixed_Q31_t)Reference_Round(-2147483648.0 / 3.0, INT32_MIN, INT32_MAX));
+    TEST_CHECK(FIXED_Q16(-2.5) == -163840);
+}
+
+/**
+ * @brief Steps and noisy distances through the low-pass.
+ *
+ * Each step must match y += round((x - y) * alpha) in double precision bit for
+ * bit, and the output must stay within the accumulated rounding error of the
+ * ideal filter: half an LSB per step, decaying by (1 - alpha) per step.
+ */
+static void Test_IIR1(void)
+{
+    const Fixed_Q15_t alphas[] = {FIXED_Q15(0.625), FIXED_Q15(0.1), FIXED_Q15(0.01), 1};
+    uint32_t failures = 0;
+
+    for (size_t a = 0; a < sizeof(alphas) / sizeof(alphas[0]); a++)
+    {
+        Fixed_IIR1_t filter = {.alpha = alphas[a]};
+        double alpha = alphas[a] / 32768.0;
+        double ideal = 0.0;
+        double bound = 0.5 / alpha + 1.0;
+
+        Fixed_IIR1_Reset(&filter, 0);
+        for (uint32_t n = 0; n < FILTER_STEPS; n++)
+        {
+            int32_t distance = (n < FILTER_STEPS / 2) ? 1200 + rand() % 64 - 32 : 40 + rand() % 8;
+            Fixed_Q16_t input = Fixed_Q16_From_Int(distance);
+            double expected = filter.output + floor((double)(input - filter.output) * alphas[a] / 32768.0 + 0.5);
+
+            failures += Fixed_IIR1_Step(&filter, input) != (Fixed_Q16_t)expected;
+            ideal += alpha * (input - ideal);
+            failures += fabs(filter.output - ideal) > bound;
+        }
+    }
+    TEST_CHECK(failures == 0);
+
+    /* Full-scale swings saturate rather than wrap */
+    {
+        Fixed_IIR1_t filter = {.alpha = FIXED_Q15(0.625)};
+
+        Fixed_IIR1_Reset(&filter, INT32_MIN);
+        for (uint8_t n = 0; n < 64; n++)
+        {
+            Fixed_IIR1_Step(&filter, INT32_MAX);
+        }
+        TEST_CHECK(filter.output == INT32_MAX);
+    }
+}
+
+/**
+ * @brief A simulated hoist under the PID block.
+ *
+ * Each step must match the same arithmetic in long double bit for bit, and the
+ * output must stay within 2 LSB of the ideal real-valued controller stepped
+ * from the same integral.
+ */
+static void Test_PID(void)
+{
+    Fixed_PID_t pid = {
+        .Kp = FIXED_Q16(2.5),
+        .Ki = FIXED_Q16(1.25),
+        .Kd = FIXED_Q16(0.08),
+        .integral = 0,
+        .integral_limit = FIXED_Q16(20.0),
+        .output_limit = FIXED_Q16(100.0),
+    };
+    const Fixed_Q16_t dt = FIXED_Q16(0.005);
+    const long double q16 = 65536.0L;
+    long double integral = 0.0L;
+    long double ideal_integral = 0.0L;
+    double position = 400.0;
+    double velocity = 0.0;
+    uint32_t failures = 0;
+    uint32_t ideal_failures = 0;
+    uint32_t clamped_steps = 0;
+
+    for (uint32_t n = 0; n < PID_STEPS; n++)
+    {
+        double setpoint = (n < PID_STEPS / 2) ? 150.0 : 600.0;
+        Fixed_Q16_t error = (Fixed_Q16_t)Reference_Round((setpoint - position) * 65536.0, INT32_MIN, INT32_MAX);
+        Fixed_Q16_t rate = (Fixed_Q16_t)Reference_Round(velocity * 65536.0, INT32_MIN, INT32_MAX);
+        Fixed_Q16_t output = Fixed_PID_Step(&pid, error, rate, dt);
+        long double increment;
+        long double expected;
+        long double ideal;
+
+        /* Same operations and roundings as Fixed_PID_Step */
+        increment = Reference_Round_Long((long double)pid.Ki * error / q16, INT32_MIN, INT32_MAX);
+        increment = Reference_Round_Long(increment * dt / q16, INT32_MIN, INT32_MAX);
+        integral = fminl(pid.integral_limit, fmaxl(-pid.integral_limit, integral + increment));
+        expected = floorl(((long double)pid.Kp * error - (long double)pid.Kd * rate) / q16 + 0.5L) + integral;
+        expected = fminl(pid.output_limit, fmaxl(-pid.output_limit, expected));
+        failures += output != (Fixed_Q16_t)expected || pid.integral != (Fixed_Q16_t)integral;
+
+        /* Real-valued controller on the same inputs */
+        ideal_integral += (long double)pid.Ki * error / (q16 * q16) * dt;
+        ideal_integral = fminl(pid.integral_limit, fmaxl(-pid.integral_limit, ideal_integral));
+        ideal = ((long double)pid.Kp * error - (long double)pid.Kd * rate) / q16 + ideal_integral;
+        ideal = fminl(pid.output_limit, fmaxl(-pid.output_limit, ideal));
+        ideal_failures += fabsl(output - ideal) > 2.0L; /* Two roundings of the increment, one of the output */
+        clamped_steps += (output == pid.output_limit || output == -pid.output_limit);
+
+        /* Hoist: velocity follows the drive with a 50 ms lag */
+        velocity += ((double)output / 65536.0 * 4.0 - velocity) * 0.1;
+        position += velocity * 0.005;
+        ideal_integral = integral; /* Compare one step of rounding at a time */
+    }
+    TEST_CHECK(failures == 0);
+    TEST_CHECK(ideal_failures == 0);
+    TEST_CHECK(clamped_steps > 0 && clamped_steps < PID_STEPS / 4);
+    TEST_CHECK(fabs(position - 600.0) < 1.0);
+
+    /* Integral clamps at its limit instead of winding up */
+    pid.integral = 0;
+    for (uint32_t n = 0; n < PID_STEPS; n++)
+    {
+        Fixed_PID_Step(&pid, FIXED_Q16(1000.0), 0, dt);
+    }
+    TEST_CHECK(pid.integral == pid.integral_limit);
+    TEST_CHECK(Fixed_PID_Step(&pid, FIXED_Q16(1000.0), 0, dt) == pid.output_limit);
+}
+
+int main(void)
+{
+    srand(1);
+    Test_Round_Shift();
+    Test_Saturating_Arithmetic();
+    Test_Saturate_16_And_Add();
+    Test_Multiply();
+    Test_Mac();
+    Test_Constants();
+    Test_IIR1();
+    Test_PID();
+    TEST_EXIT();
+}
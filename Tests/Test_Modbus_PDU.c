@@ -0,0 +1,201 @@
+/**
+ * @file Test_Modbus_PDU.c
+ *
+ * @brief Drives Modbus_Process_Frame with whole ADUs: function codes 0x03,
+ * 0x04, 0x06 and 0x10, every exception reply, and the frames that must not be
+ * answered.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "Test.h"
+#include "L2/Modbus_PDU.h"
+
+#define HOLDING_COUNT 4
+#define INPUT_COUNT 2
+#define REJECTED_VALUE 0xFFFF /* Write_Holding refuses this value */
+
+static uint16_t holding[HOLDING_COUNT];
+static const uint16_t input[INPUT_COUNT] = {0x1234, 0xABCD};
+static uint8_t response[MODBUS_MAX_ADU_LENGTH];
+
+static Modbus_Exception_t Read_Holding(uint16_t address, uint16_t *value)
+{
+    *value = holding[address];
+    return MODBUS_EXCEPTION_NONE;
+}
+
+static Modbus_Exception_t Write_Holding(uint16_t address, uint16_t value)
+{
+    if (value == REJECTED_VALUE)
+    {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    holding[address] = value;
+    return MODBUS_EXCEPTION_NONE;
+}
+
+static Modbus_Exception_t Read_Input(uint16_t address, uint16_t *value)
+{
+    *value = input[address];
+    return MODBUS_EXCEPTION_NONE;
+}
+
+static const Modbus_Register_Map_t test_map = {
+    .holding_count = HOLDING_COUNT,
+    .input_count = INPUT_COUNT,
+    .read_holding = Read_Holding,
+    .write_holding = Write_Holding,
+    .read_input = Read_Input,
+};
+
+/**
+ * @brief Append the CRC to an ADU and run it through the server.
+ *
+ * @param adu Address and PDU, with two spare bytes for the CRC
+ * @param length Address and PDU length
+ * @return Reply length
+ */
+static size_t Transact(const Modbus_Register_Map_t *map, uint8_t *adu, size_t length)
+{
+    uint16_t crc = Modbus_Crc16(adu, length);
+
+    adu[length] = (uint8_t)crc;
+    adu[length + 1] = (uint8_t)(crc >> 8);
+    memset(response, 0, sizeof(response));
+    return Modbus_Process_Frame(map, adu, length + 2, response);
+}
+
+/**
+ * @brief Check a reply's CRC and compare its address and PDU with the expected bytes.
+ */
+static bool Reply_Is(size_t length, const uint8_t *expected, size_t expected_length)
+{
+    uint16_t crc;
+
+    if (length != expected_length + 2)
+    {
+        return false;
+    }
+    crc = Modbus_Crc16(response, expected_length);
+    return memcmp(response, expected, expected_length) == 0 && response[expected_length] == (uint8_t)crc &&
+           response[expected_length + 1] == (uint8_t)(crc >> 8);
+}
+
+static void Test_Crc(void)
+{
+    const uint8_t check[] = "123456789";
+    const uint8_t request[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x01};
+
+    TEST_CHECK(Modbus_Crc16(check, 9) == 0x4B37);
+    TEST_CHECK(Modbus_Crc16(request, sizeof(request)) == 0x0A84); /* Sent as 84 0A */
+}
+
+static void Test_Read_Registers(void)
+{
+    uint8_t adu[16];
+
+    holding[1] = 0x0102;
+    holding[2] = 0x0304;
+    memcpy(adu, (const uint8_t[]){0x01, 0x03, 0x00, 0x01, 0x00, 0x02}, 6);
+    TEST_CHECK(Reply_Is(Transact(&test_map, adu, 6), (const uint8_t[]){0x01, 0x03, 0x04, 0x01, 0x02, 0x03, 0x04}, 7));
+
+    memcpy(adu, (const uint8_t[]){0x01, 0x04, 0x00, 0x00, 0x00, 0x02}, 6);
+    TEST_CHECK(Reply_Is(Transact(&test_map, adu, 6), (const uint8_t[]){0x01, 0x04, 0x04, 0x12, 0x34, 0xAB, 0xCD}, 7));
+
+    /* Past the end of the map */
+    memcpy(adu, (const uint8_t[]){0x01, 0x03, 0x00, 0x03, 0x00, 0x02}, 6);
+    TEST_CHECK(Reply_Is(Transact(&test_map, adu, 6), (const uint8_t[]){0x01, 0x83, 0x02}, 3));
+
+    /* Count of zero and count above the 125 register limit */
+    memcpy(adu, (const uint8_t[]){0x01, 0x04, 0x00, 0x00, 0x00, 0x00}, 6);
+    TEST_CHECK(Reply_Is(Transact(&test_map, adu, 6), (const uint8_t[]){0x01, 0x84, 0x03}, 3));
+    memcpy(adu, (const uint8_t[]){0x01, 0x03, 0x00, 0x00, 0x00, 0x7E}, 6);
+    TEST_CHECK(Reply_Is(Transact(&test_map, adu, 6), (const uint8_t[]){0x01, 0x83, 0x03}, 3));
+
+    /* Truncated request */
+    memcpy(adu, (const uint8_t[]){0x01, 0x03, 0x00, 0x00, 0x00}, 5);
+    TEST_CHECK(Reply_Is(Transact(&test_map, adu, 5), (const uint8_t[]){0x01, 0x83, 0x03}, 3));
+}
+
+static void Test_Write_Single_Register(void)
+{
+    uint8_t adu[16];
+
+    memcpy(adu, (const uint8_t[]){0x01, 0x06, 0x00, 0x02, 0xBE, 0xEF}, 6);
+    TEST_CHECK(Reply_Is(Transact(&test_map, adu, 6), adu, 6));
+    TEST_CHECK(holding[2] == 0xBEEF);
+
+    memcpy(adu, (const uint8_t[]){0x01, 0x06, 0x00, 0x04, 0x00, 0x01}, 6);
+    TEST_CHECK(Reply_Is(Transact(&test_map, adu, 6), (const uint8_t[]){0x01, 0x86, 0x02}, 3));
+
+    /* Exception raised by the application */
+    memcpy(adu, (const uint8_t[]){0x01, 0x06, 0x00, 0x00, 0xFF, 0xFF}, 6);
+    TEST_CHECK(Reply_Is(Transact(&test_map, adu, 6), (const uint8_t[]){0x01, 0x86, 0x03}, 3));
+}
+
+static void Test_Write_Multiple_Registers(void)
+{
+    uint8_t adu[32];
+
+    memcpy(adu, (const uint8_t[]){0x01, 0x10, 0x00, 0x00, 0x00, 0x02, 0x04, 0x11, 0x22, 0x33, 0x44}, 11);
+    TEST_CHECK(Reply_Is(Transact(&test_map, adu, 11), (const uint8_t[]){0x01, 0x10, 0x00, 0x00, 0x00, 0x02}, 6));
+    TEST_CHECK(holding[0] == 0x1122 && holding[1] == 0x3344);
+
+    /* Byte count disagrees with the register count */
+    memcpy(adu, (const uint8_t[]){0x01, 0x10, 0x00, 0x00, 0x00, 0x02, 0x02, 0x11, 0x22}, 9);
+    TEST_CHECK(Reply_Is(Transact(&test_map, adu, 9), (const uint8_t[]){0x01, 0x90, 0x03}, 3));
+
+    memcpy(adu, (const uint8_t[]){0x01, 0x10, 0x00, 0x03, 0x00, 0x02, 0x04, 0x11, 0x22, 0x33, 0x44}, 11);
+    TEST_CHECK(Reply_Is(Transact(&test_map, adu, 11), (const uint8_t[]){0x01, 0x90, 0x02}, 3));
+
+    /* Registers before a refused one are written in ascending order */
+    memcpy(adu, (const uint8_t[]){0x01, 0x10, 0x00, 0x02, 0x00, 0x02, 0x04, 0x55, 0x66, 0xFF, 0xFF}, 11);
+    TEST_CHECK(Reply_Is(Transact(&test_map, adu, 11), (const uint8_t[]){0x01, 0x90, 0x03}, 3));
+    TEST_CHECK(holding[2] == 0x5566 && holding[3] == 0);
+}
+
+static void Test_Exceptions(void)
+{
+    uint8_t adu[16];
+
+    memcpy(adu, (const uint8_t[]){0x01, 0x05, 0x00, 0x00, 0xFF, 0x00}, 6);
+    TEST_CHECK(Reply_Is(Transact(&test_map, adu, 6), (const uint8_t[]){0x01, 0x85, 0x01}, 3));
+
+    /* No register map registered yet */
+    memcpy(adu, (const uint8_t[]){0x01, 0x03, 0x00, 0x00, 0x00, 0x01}, 6);
+    TEST_CHECK(Reply_Is(Transact(NULL, adu, 6), (const uint8_t[]){0x01, 0x83, 0x04}, 3));
+}
+
+static void Test_Silent_Frames(void)
+{
+    uint8_t adu[16];
+
+    /* Corrupted CRC */
+    memcpy(adu, (const uint8_t[]){0x01, 0x03, 0x00, 0x00, 0x00, 0x01, 0x84, 0x0B}, 8);
+    TEST_CHECK(Modbus_Process_Frame(&test_map, adu, 8, response) == 0);
+
+    /* Another server */
+    memcpy(adu, (const uint8_t[]){0x02, 0x03, 0x00, 0x00, 0x00, 0x01}, 6);
+    TEST_CHECK(Transact(&test_map, adu, 6) == 0);
+
+    /* Too short to hold an address, function and CRC */
+    TEST_CHECK(Modbus_Process_Frame(&test_map, adu, 3, response) == 0);
+
+    /* Broadcasts are executed but not answered */
+    memcpy(adu, (const uint8_t[]){0x00, 0x06, 0x00, 0x01, 0x0B, 0xAD}, 6);
+    TEST_CHECK(Transact(&test_map, adu, 6) == 0);
+    TEST_CHECK(holding[1] == 0x0BAD);
+}
+
+int main(void)
+{
+    Test_Crc();
+    Test_Read_Registers();
+    Test_Write_Single_Register();
+    Test_Write_Multiple_Registers();
+    Test_Exceptions();
+    Test_Silent_Frames();
+    TEST_EXIT();
+}
@@ -0,0 +1,219 @@
+/**
+ * @file Test_Rank_Filter.c
+ *
+ * @brief Checks the sorting networks exhaustively by the 0-1 principle and
+ * against a reference sort, and times the medians and trimmed means against
+ * the median of three they replaced, in nanoseconds and cycles per sample.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "Test.h"
+#include "L2/Rank_Filter.h"
+
+#define RANDOM_WINDOWS 100000
+#define BENCHMARK_SAMPLES 1000000
+#define ZERO_ONE_HIGH 1000000u /* Large enough that every trimmed mean of 0s and 1s is distinct */
+
+static uint32_t benchmark_samples[BENCHMARK_SAMPLES + RANK_FILTER_MAX_WINDOW];
+
+/**
+ * @brief The median of three used before the networks, including its 16-bit arguments.
+ */
+static uint32_t median_of_3(uint16_t a, uint16_t b, uint16_t c)
+{
+    if ((a > b) != (a > c))
+        return a;
+    else if ((b > a) != (b > c))
+        return b;
+    else
+        return c;
+}
+
+static int Compare_U32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Trimmed mean of a sorted window, rounded as Rank_Filter_Trimmed_Mean does.
+ */
+static uint32_t Reference_Trimmed_Mean(const uint32_t *sorted, uint8_t window, uint8_t trim)
+{
+    uint64_t sum = 0;
+    uint32_t count = window - 2 * trim;
+
+    for (uint8_t i = trim; i < window - trim; i++)
+    {
+        sum += sorted[i];
+    }
+    return (uint32_t)((sum + count / 2) / count);
+}
+
+static uint32_t Random_U32(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+/**
+ * @brief A network sorts every input if it sorts every input of 0s and 1s.
+ *
+ * The median and every trim of the trimmed mean read the sorted window, so
+ * between them they expose each output position.
+ */
+static void Test_Networks_Exhaustive(void)
+{
+    uint32_t samples[RANK_FILTER_MAX_WINDOW];
+    uint32_t sorted[RANK_FILTER_MAX_WINDOW];
+
+    for (uint8_t window = 3; window <= RANK_FILTER_MAX_WINDOW; window += 2)
+    {
+        for (uint32_t mask = 0; mask < (1u << window); mask++)
+        {
+            uint8_t ones = 0;
+
+            for (uint8_t i = 0; i < window; i++)
+            {
+                samples[i] = ((mask >> i) & 1) ? ZERO_ONE_HIGH : 0;
+                ones += (mask >> i) & 1;
+            }
+            for (uint8_t i = 0; i < window; i++)
+            {
+                sorted[i] = (i >= window - ones) ? ZERO_ONE_HIGH : 0;
+            }
+
+            TEST_CHECK(Rank_Filter_Median(samples, window) == sorted[window / 2]);
+            for (uint8_t trim = 0; 2 * trim < window; trim++)
+            {
+                TEST_CHECK(Rank_Filter_Trimmed_Mean(samples, window, trim) ==
+                           Reference_Trimmed_Mean(sorted, window, trim));
+            }
+        }
+    }
+}
+
+static void Test_Random_Windows(void)
+{
+    uint32_t samples[RANK_FILTER_MAX_WINDOW];
+    uint32_t sorted[RANK_FILTER_MAX_WINDOW];
+    uint32_t failures = 0;
+
+    srand(1);
+    for (uint32_t n = 0; n < RANDOM_WINDOWS; n++)
+    {
+        uint8_t window = 3 + 2 * (n % 4);
+
+        /* Full-width values, with runs of duplicates */
+        for (uint8_t i = 0; i < window; i++)
+        {
+            samples[i] = (rand() % 4 == 0) ? UINT32_MAX - (uint32_t)(rand() % 3) : Random_U32();
+            sorted[i] = samples[i];
+        }
+        qsort(sorted, window, sizeof(sorted[0]), Compare_U32);
+
+        failures += Rank_Filter_Median(samples, window) != sorted[window / 2];
+        for (uint8_t trim = 0; 2 * trim < window; trim++)
+        {
+            failures += Rank_Filter_Trimmed_Mean(samples, window, trim) != Reference_Trimmed_Mean(sorted, window, trim);
+        }
+    }
+    TEST_CHECK(failures == 0);
+    TEST_CHECK(!Rank_Filter_Window_Valid(1) && !Rank_Filter_Window_Valid(4) && Rank_Filter_Window_Valid(9));
+}
+
+/**
+ * @brief Print the time per sample of one benchmark run.
+ */
+static void Print_Timing(const char *label, unsigned window, uint64_t elapsed_ns, uint64_t elapsed_cycles)
+{
+    char name[32];
+
+    snprintf(name, sizeof(name), window ? "%s %u:" : "%s:", label, window);
+    if (TEST_HAVE_CYCLES)
+    {
+        printf("%-20s %6.2f ns, %6.1f cycles per sample\n", name, (double)elapsed_ns / BENCHMARK_SAMPLES,
+               (double)elapsed_cycles / BENCHMARK_SAMPLES);
+    }
+    else
+    {
+        printf("%-20s %6.2f ns per sample\n", name, (double)elapsed_ns / BENCHMARK_SAMPLES);
+    }
+}
+
+static void Benchmark_Medians(void)
+{
+    volatile uint32_t sink = 0; /* Keeps the results live */
+    uint32_t seed = 12345;
+    uint64_t start;
+    uint64_t start_cycles;
+    uint64_t elapsed_ns;
+    uint64_t elapsed_cycles;
+
+    /* Distances with occasional spikes, as in the on-target benchmark (Debug_Task5) */
+    for (uint32_t i = 0; i < BENCHMARK_SAMPLES + RANK_FILTER_MAX_WINDOW; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        benchmark_samples[i] = (seed >> 24) < 16 ? 4000 : 50 + ((seed >> 16) & 0x3F);
+    }
+
+    start = Test_Now_Ns();
+    start_cycles = Test_Now_Cycles();
+    for (uint32_t i = 0; i < BENCHMARK_SAMPLES; i++)
+    {
+        sink = median_of_3(benchmark_samples[i], benchmark_samples[i + 1], benchmark_samples[i + 2]);
+    }
+    elapsed_cycles = Test_Now_Cycles() - start_cycles;
+    elapsed_ns = Test_Now_Ns() - start;
+    Print_Timing("median_of_3", 0, elapsed_ns, elapsed_cycles);
+
+    for (uint8_t window = 3; window <= RANK_FILTER_MAX_WINDOW; window += 2)
+    {
+        start = Test_Now_Ns();
+        start_cycles = Test_Now_Cycles();
+        for (uint32_t i = 0; i < BENCHMARK_SAMPLES; i++)
+        {
+            sink = Rank_Filter_Median(&benchmark_samples[i], window);
+        }
+        elapsed_cycles = Test_Now_Cycles() - start_cycles;
+        elapsed_ns = Test_Now_Ns() - start;
+        Print_Timing("network median", window, elapsed_ns, elapsed_cycles);
+    }
+
+    /* Trim one from each end, as Debug_Task5 does */
+    for (uint8_t window = 3; window <= RANK_FILTER_MAX_WINDOW; window += 2)
+    {
+        start = Test_Now_Ns();
+        start_cycles = Test_Now_Cycles();
+        for (uint32_t i = 0; i < BENCHMARK_SAMPLES; i++)
+        {
+            sink = Rank_Filter_Trimmed_Mean(&benchmark_samples[i], window, 1);
+        }
+        elapsed_cycles = Test_Now_Cycles() - start_cycles;
+        elapsed_ns = Test_Now_Ns() - start;
+        Print_Timing("trimmed mean", window, elapsed_ns, elapsed_cycles);
+    }
+
+    /* The robust filter profile: two trimmed from each end of seven */
+    start = Test_Now_Ns();
+    start_cycles = Test_Now_Cycles();
+    for (uint32_t i = 0; i < BENCHMARK_SAMPLES; i++)
+    {
+        sink = Rank_Filter_Trimmed_Mean(&benchmark_samples[i], 7, 2);
+    }
+    elapsed_cycles = Test_Now_Cycles() - start_cycles;
+    elapsed_ns = Test_Now_Ns() - start;
+    Print_Timing("trimmed mean 7/2", 0, elapsed_ns, elapsed_cycles);
+    (void)sink;
+}
+
+int main(void)
+{
+    Test_Networks_Exhaustive();
+    Test_Random_Windows();
+    Benchmark_Medians();
+    TEST_EXIT();
+}
@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+"""Decode the Host PC link of the Automated Warehouse Crane.
+
+Splits the USART2 byte stream into ASCII console text and 0x00-delimited
+COBS frames, checks each frame's CRC-16/CCITT-FALSE and prints:
+
+  0x80  control-loop telemetry records (L2/Telemetry.h)
+  0x81  tokenized LOG() records, rebuilt from the .log_strings section of the ELF
+  0x82  command acks/nacks (L3/Command_Dispatch.h)
+  0x83  capture dump header (L2/Capture.h)
+  0x84  capture dump records, also written to --csv for offline tuning
+
+Usage:
+  log_decode.py firmware.elf /dev/ttyACM0 [--baud 115200] [--csv step.csv]
+  log_decode.py firmware.elf capture.bin
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+TELEMETRY_OPCODE = 0x80
+LOG_OPCODE = 0x81
+ACK_OPCODE = 0x82
+CAPTURE_HEADER_OPCODE = 0x83
+CAPTURE_RECORDS_OPCODE = 0x84
+
+TELEMETRY_FORMAT = "<IHHhfffbBBB"
+LOG_HEADER_FORMAT = "<IHB"
+ACK_FORMAT = "<HBBI"
+ACK_STATUS = ("ok", "unknown", "invalid arguments", "busy")
+CAPTURE_HEADER_FORMAT = "<HHIB"
+CAPTURE_RECORD_FORMAT = "<IHHHhhBB"
+CAPTURE_NOT_TRIGGERED = 0xFFFF
+CAPTURE_CSV_COLUMNS = ("index", "time_s", "echo_us", "raw_mm", "filtered_mm", "setpoint_mm", "output", "mode", "flags")
+
+CONVERSION = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|j|t)?([diouxXcfFeEgG%])")
+
+
+def read_log_strings(elf_path):
+    """Return the raw contents of the .log_strings section."""
+    with open(elf_path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF" or elf[4] != 1:
+        sys.exit(f"{elf_path}: not a 32-bit ELF file")
+    shoff, = struct.unpack_from("<I", elf, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+
+    def section(index):
+        # name, type, flags, addr, offset, size
+        return struct.unpack_from("<IIIIII", elf, shoff + index * shentsize)
+
+    names_offset = section(shstrndx)[4]
+    for index in range(shnum):
+        name, _, _, _, offset, size = section(index)
+        end = elf.index(b"\0", names_offset + name)
+        if elf[names_offset + name:end] == b".log_strings":
+            return elf[offset:offset + size]
+    sys.exit(f"{elf_path}: no .log_strings section")
+
+
+def cobs_decode(data):
+    out = bytearray()
+    index = 0
+    while index < len(data):
+        code = data[index]
+        if code == 0 or index + code > len(data):
+            return None
+        out += data[index + 1:index + code]
+        index += code
+        if code != 0xFF and index < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def crc16_ccitt(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def format_log(strings, log_id, words):
+    end = strings.find(b"\0", log_id)
+    if log_id >= len(strings) or end < 0:
+        return f"<unknown log id {log_id}>"
+    fmt = strings[log_id:end].decode("utf-8", "replace")
+    values = iter(words)
+
+    def convert(match):
+        flags, _, kind = match.groups()
+        if kind == "%":
+            return "%"
+        word = next(values, 0)
+        if kind in "fFeEgG":
+            value = struct.unpack("<f", struct.pack("<I", word))[0]
+        elif kind in "di":
+            value = struct.unpack("<i", struct.pack("<I", word))[0]
+        else:
+            value = word
+        return ("%" + flags + kind) % value
+
+    return CONVERSION.sub(convert, fmt)
+
+
+class CaptureDump:
+    """Collects a capture dump and writes it as CSV, time zero at the trigger."""
+
+    def __init__(self, csv_path):
+        self.csv_path = csv_path
+        self.header = None
+        self.records = {}
+
+    def start(self, count, trigger, cycles_per_second):
+        self.header = (count, trigger, cycles_per_second)
+        self.records = {}
+
+    def add(self, first_index, records):
+        for offset, record in enumerate(records):
+            self.records[first_index + offset] = record
+        if self.header and len(self.records) == self.header[0]:
+            self.write()
+            return True
+        return False
+
+    def write(self):
+        count, trigger, cycles_per_second = self.header
+        self.header = None
+        if not self.csv_path or count == 0:
+            return
+        zero = self.records[0 if trigger == CAPTURE_NOT_TRIGGERED else min(trigger, count - 1)][0]
+        with open(self.csv_path, "w") as f:
+            f.write(",".join(CAPTURE_CSV_COLUMNS) + "\n")
+            for index in range(count):
+                timestamp, *fields = self.records[index]
+                # Timestamps wrap at 32 bits; take the signed difference
+                seconds = ((timestamp - zero + 2**31) % 2**32 - 2**31) / cycles_per_second
+                f.write(f"{index},{seconds:.6f}," + ",".join(str(v) for v in fields) + "\n")
+
+
+def handle_frame(strings, frame, dump):
+    frame = cobs_decode(frame)
+    if frame is None or len(frame) < 3:
+        return "<malformed frame>"
+    body, crc = frame[:-2], struct.unpack("<H", frame[-2:])[0]
+    if crc16_ccitt(body) != crc:
+        return "<crc error>"
+    opcode, payload = body[0], body[1:]
+
+    if opcode == LOG_OPCODE and len(payload) >= struct.calcsize(LOG_HEADER_FORMAT):
+        timestamp, log_id, count = struct.unpack_from(LOG_HEADER_FORMAT, payload)
+        words = struct.unpack_from(f"<{count}I", payload, struct.calcsize(LOG_HEADER_FORMAT))
+        return f"[{timestamp:>9} ms] {format_log(strings, log_id, words)}"
+
+    if opcode == TELEMETRY_OPCODE and len(payload) == struct.calcsize(TELEMETRY_FORMAT):
+        (timestamp, raw, filtered, setpoint, p, i, d,
+         direction, duty, mode, flags) = struct.unpack(TELEMETRY_FORMAT, payload)
+        return (f"[{timestamp:>9} ms] TLM raw={raw} filt={filtered} spt={setpoint} "
+                f"P={p:.2f} I={i:.2f} D={d:.2f} pwm={direction:+d}/{duty} mode={mode} flags=0x{flags:02X}")
+
+    if opcode == ACK_OPCODE and len(payload) == struct.calcsize(ACK_FORMAT):
+        sequence, command, status, timestamp = struct.unpack(ACK_FORMAT, payload)
+        kind = "ACK " if status == 0 else "NACK"
+        reason = ACK_STATUS[status] if status < len(ACK_STATUS) else str(status)
+        return f"[{timestamp:>9} ms] {kind} #{sequence} op=0x{command:02X} {reason}"
+
+    if opcode == CAPTURE_HEADER_OPCODE and len(payload) == struct.calcsize(CAPTURE_HEADER_FORMAT):
+        count, trigger, cycles_per_second, record_size = struct.unpack(CAPTURE_HEADER_FORMAT, payload)
+        if record_size != struct.calcsize(CAPTURE_RECORD_FORMAT):
+            return f"CAP dump of {count} records of {record_size} bytes, record layout does not match"
+        dump.start(count, trigger, cycles_per_second)
+        at = "untriggered" if trigger == CAPTURE_NOT_TRIGGERED else f"trigger at {trigger}"
+        return f"CAP dump of {count} records, {at}"
+
+    record_size = struct.calcsize(CAPTURE_RECORD_FORMAT)
+    if opcode == CAPTURE_RECORDS_OPCODE and len(payload) >= 2 and (len(payload) - 2) % record_size == 0:
+        first_index, = struct.unpack_from("<H", payload)
+        records = list(struct.iter_unpack(CAPTURE_RECORD_FORMAT, payload[2:]))
+        if dump.add(first_index, records):
+            return f"CAP dump complete{f', written to {dump.csv_path}' if dump.csv_path else ''}"
+        return None
+
+    return f"<frame 0x{opcode:02X}: {payload.hex()}>"
+
+
+def stream(source, strings, dump):
+    frame = None
+    while True:
+        data = source.read(1)
+        if not data:
+            return
+        byte = data[0]
+        if byte == 0:
+            if frame:
+                text = handle_frame(strings, bytes(frame), dump)
+                if text is not None:
+                    print(text)
+                frame = None
+            else:
+                frame = bytearray()
+        elif frame is not None:
+            frame.append(byte)
+        else:
+            sys.stdout.write(chr(byte))
+            sys.stdout.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="firmware ELF with the .log_strings section")
+    parser.add_argument("source", help="serial port or capture file")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--csv", help="write capture dumps to this CSV file")
+    args = parser.parse_args()
+
+    strings = read_log_strings(args.elf)
+    if args.source.startswith(("/dev/", "COM")):
+        import serial  # pyserial
+        source = serial.Serial(args.source, args.baud)
+    else:
+        source = open(args.source, "rb")
+    try:
+        stream(source, strings, CaptureDump(args.csv))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
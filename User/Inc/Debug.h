@@ -6,9 +6,6 @@
 #ifndef DEBUG_H_
 #define DEBUG_H_
 
-void Debug_Task1(void *pvParameters);
-void Debug_Task2(void *pvParameters);
-void Debug_Task3(void *pvParameters);
-void Debug_Task4(void *pvParameters);
+void Debug_Create_Tasks(void);
 
 #endif /* DEBUG_H_ */
\ No newline at end of file
@@ -0,0 +1,210 @@
+/**
+ * @file Fixed_Point.h
+ *
+ * @brief Header-only fixed-point arithmetic and filter/controller blocks.
+ *
+ * Formats:
+ *   Fixed_Q15_t   1.15,  range [-1, 1)
+ *   Fixed_Q31_t   1.31,  range [-1, 1)
+ *   Fixed_Q16_t  16.16,  range [-32768, 32768)
+ *
+ * Every operation rounds to nearest, halves upwards, and saturates instead of
+ * wrapping, so results are bit-exact on any target with arithmetic right
+ * shifts, as GCC provides. Tests/Test_Fixed_Point.c checks each block
+ * against a floating-point reference.
+ *
+ * The median block is L2/Rank_Filter: distances are whole millimeters, and a
+ * median only compares samples, so it is already exact in integer math.
+ */
+
+#ifndef FIXED_POINT_H_
+#define FIXED_POINT_H_
+
+#include <stdint.h>
+
+typedef int16_t Fixed_Q15_t;
+typedef int32_t Fixed_Q31_t;
+typedef int32_t Fixed_Q16_t;
+
+/* Compile-time constants from real values; the argument must be in range */
+#define FIXED_Q15(x) ((Fixed_Q15_t)((x) * 32768.0 + ((x) >= 0 ? 0.5 : -0.5)))
+#define FIXED_Q31(x) ((Fixed_Q31_t)((x) * 2147483648.0 + ((x) >= 0 ? 0.5 : -0.5)))
+#define FIXED_Q16(x) ((Fixed_Q16_t)((x) * 65536.0 + ((x) >= 0 ? 0.5 : -0.5)))
+
+#define FIXED_Q16_ONE (1 << 16)
+
+static inline int32_t Fixed_Saturate_32(int64_t value)
+{
+    if (value > INT32_MAX)
+    {
+        return INT32_MAX;
+    }
+    if (value < INT32_MIN)
+    {
+        return INT32_MIN;
+    }
+    return (int32_t)value;
+}
+
+static inline int16_t Fixed_Saturate_16(int32_t value)
+{
+    if (value > INT16_MAX)
+    {
+        return INT16_MAX;
+    }
+    if (value < INT16_MIN)
+    {
+        return INT16_MIN;
+    }
+    return (int16_t)value;
+}
+
+/**
+ * @brief Arithmetic right shift rounding to nearest.
+ *
+ * @param value Value to shift
+ * @param shift Bit count, 1 to 62
+ */
+static inline int64_t Fixed_Round_Shift(int64_t value, uint8_t shift)
+{
+    int64_t half = (int64_t)1 << (shift - 1);
+
+    if (value > INT64_MAX - half)
+    {
+        return INT64_MAX >> shift;
+    }
+    return (value + half) >> shift;
+}
+
+static inline int32_t Fixed_Add_Saturate(int32_t a, int32_t b)
+{
+    return Fixed_Saturate_32((int64_t)a + b);
+}
+
+static inline int32_t Fixed_Sub_Saturate(int32_t a, int32_t b)
+{
+    return Fixed_Saturate_32((int64_t)a - b);
+}
+
+static inline Fixed_Q15_t Fixed_Mul_Q15(Fixed_Q15_t a, Fixed_Q15_t b)
+{
+    return Fixed_Saturate_16((int32_t)Fixed_Round_Shift((int32_t)a * b, 15));
+}
+
+static inline Fixed_Q31_t Fixed_Mul_Q31(Fixed_Q31_t a, Fixed_Q31_t b)
+{
+    return Fixed_Saturate_32(Fixed_Round_Shift((int64_t)a * b, 31));
+}
+
+static inline Fixed_Q16_t Fixed_Mul_Q16(Fixed_Q16_t a, Fixed_Q16_t b)
+{
+    return Fixed_Saturate_32(Fixed_Round_Shift((int64_t)a * b, 16));
+}
+
+/**
+ * @brief Multiply-accumulate into a 64-bit accumulator, saturating at its range.
+ *
+ * The product keeps its full precision; shift the accumulator down once at the end.
+ */
+static inline int64_t Fixed_Mac(int64_t accumulator, int32_t a, int32_t b)
+{
+    int64_t product = (int64_t)a * b;
+
+    if (product > 0 && accumulator > INT64_MAX - product)
+    {
+        return INT64_MAX;
+    }
+    if (product < 0 && accumulator < INT64_MIN - product)
+    {
+        return INT64_MIN;
+    }
+    return accumulator + product;
+}
+
+static inline Fixed_Q16_t Fixed_Q16_From_Int(int32_t value)
+{
+    return Fixed_Saturate_32((int64_t)value * FIXED_Q16_ONE);
+}
+
+static inline int32_t Fixed_Q16_To_Int(Fixed_Q16_t value)
+{
+    return (int32_t)Fixed_Round_Shift(value, 16);
+}
+
+static inline float Fixed_Q16_To_Float(Fixed_Q16_t value)
+{
+    return (float)value / FIXED_Q16_ONE;
+}
+
+/* First-order IIR low-pass: y += alpha * (x - y) */
+typedef struct Fixed_IIR1
+{
+    Fixed_Q15_t alpha; /* Smoothing factor, 0 to just under 1 */
+    Fixed_Q16_t output;
+} Fixed_IIR1_t;
+
+static inline void Fixed_IIR1_Reset(Fixed_IIR1_t *filter, Fixed_Q16_t value)
+{
+    filter->output = value;
+}
+
+static inline Fixed_Q16_t Fixed_IIR1_Step(Fixed_IIR1_t *filter, Fixed_Q16_t input)
+{
+    int64_t step = Fixed_Round_Shift((int64_t)Fixed_Sub_Saturate(input, filter->output) * filter->alpha, 15);
+
+    filter->output = Fixed_Saturate_32(filter->output + step);
+    return filter->output;
+}
+
+/* PID controller in Q16.16, derivative taken on a measured rate */
+typedef struct Fixed_PID
+{
+    Fixed_Q16_t Kp;
+    Fixed_Q16_t Ki;
+    Fixed_Q16_t Kd;
+    Fixed_Q16_t integral;
+    Fixed_Q16_t integral_limit; /* Anti-windup clamp, symmetric */
+    Fixed_Q16_t output_limit;   /* Output clamp, symmetric */
+} Fixed_PID_t;
+
+/**
+ * @brief Run one PID step.
+ *
+ * @param pid Controller state
+ * @param error Setpoint minus measurement
+ * @param rate Rate of change of the measurement, per second
+ * @param dt Time step in seconds
+ * @return Clamped control output
+ */
+static inline Fixed_Q16_t Fixed_PID_Step(Fixed_PID_t *pid, Fixed_Q16_t error, Fixed_Q16_t rate, Fixed_Q16_t dt)
+{
+    int64_t output;
+    Fixed_Q16_t integral;
+
+    integral = Fixed_Add_Saturate(pid->integral, Fixed_Mul_Q16(Fixed_Mul_Q16(pid->Ki, error), dt));
+    if (integral > pid->integral_limit)
+    {
+        integral = pid->integral_limit;
+    }
+    else if (integral < -pid->integral_limit)
+    {
+        integral = -pid->integral_limit;
+    }
+    pid->integral = integral;
+
+    output = Fixed_Mac(0, pid->Kp, error);
+    output = Fixed_Mac(output, pid->Kd, Fixed_Sub_Saturate(0, rate));
+    output = Fixed_Round_Shift(output, 16) + integral;
+
+    if (output > pid->output_limit)
+    {
+        return pid->output_limit;
+    }
+    if (output < -pid->output_limit)
+    {
+        return -pid->output_limit;
+    }
+    return (Fixed_Q16_t)output;
+}
+
+#endif /* FIXED_POINT_H_ */
@@ -0,0 +1,22 @@
+/**
+ * @file Control_Timer.h
+ */
+
+#ifndef CONTROL_TIMER_H
+#define CONTROL_TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define CONTROL_TIMER_MIN_RATE_HZ 20
+#define CONTROL_TIMER_MAX_RATE_HZ 1000
+
+bool Control_Timer_Start(uint32_t rate_hz, TaskHandle_t task);
+bool Control_Timer_Set_Rate(uint32_t rate_hz);
+uint32_t Control_Timer_Rate(void);
+uint32_t Control_Timer_Last_Tick(void);
+
+#endif /* CONTROL_TIMER_H */
@@ -0,0 +1,40 @@
+/**
+ * @file Cycle_Counter.h
+ *
+ * @brief Core clock timestamps from the DWT cycle counter.
+ *
+ * The counter wraps every 2^32 cycles (~51 s at 84 MHz); differences taken
+ * with unsigned subtraction are valid across one wrap.
+ */
+
+#ifndef CYCLE_COUNTER_H_
+#define CYCLE_COUNTER_H_
+
+#include <stdint.h>
+
+#include "main.h"
+
+/**
+ * @brief Start the DWT cycle counter. Call once before any timestamp is taken.
+ */
+static inline void Cycle_Counter_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t Cycle_Counter_Now(void)
+{
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief Convert a cycle count difference to seconds.
+ */
+static inline float Cycle_Counter_To_Seconds(uint32_t cycles)
+{
+    return (float)cycles / (float)SystemCoreClock;
+}
+
+#endif /* CYCLE_COUNTER_H_ */
@@ -10,6 +10,7 @@
 #define PWM_DRIVER_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 typedef enum PWM_CHANNEL
 {
@@ -32,6 +33,8 @@ typedef struct PWM_DUTY_CYCLE
 } PWM_Duty_Cycle_t;
 
 void PWM_Disable_All(void);
+bool PWM_Request_Speed(PWM_Channel_t channel, int32_t speed);
+void PWM_Set_Drive(const PWM_Duty_Cycle_t *cmd);
 void PWM_Timer_Task(void *pvParameters);
 
 #endif /* PWM_DRIVER_H */
\ No newline at end of file
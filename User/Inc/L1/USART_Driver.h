@@ -8,6 +8,44 @@
 #ifndef INC_USER_L1_USART_DRIVER_H_
 #define INC_USER_L1_USART_DRIVER_H_
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum TX_Overflow_Policy
+{
+	TX_POLICY_DROP = 0, /* Discard messages that do not fit */
+	TX_POLICY_BLOCK	/* Wait for space from task context, drop from ISRs */
+} TX_Overflow_Policy_t;
+
+typedef enum HostPC_Link_Mode
+{
+	HOSTPC_LINK_CONSOLE = 0, /* ASCII console and binary command frames */
+	HOSTPC_LINK_MODBUS		 /* Modbus RTU server */
+} HostPC_Link_Mode_t;
+
+typedef struct HostPC_TX_Stats
+{
+	uint32_t bytes_queued;
+	uint32_t bytes_dropped;
+	uint32_t overflow_events; /* Messages dropped because the ring was full */
+	uint32_t high_water;	  /* Peak ring occupancy in bytes */
+} HostPC_TX_Stats_t;
+
 void HostPC_RX_Task(void *pvParameters);
+uint32_t HostPC_RX_Dropped_Bytes(void);
+void HostPC_Set_Link_Mode(HostPC_Link_Mode_t mode);
+HostPC_Link_Mode_t HostPC_Get_Link_Mode(void);
+
+void HostPC_TX_Init(void);
+bool HostPC_Transmit(const uint8_t *data, size_t length);
+bool HostPC_Transmit_Modbus(const uint8_t *data, size_t length);
+void HostPC_Set_TX_Policy(TX_Overflow_Policy_t policy);
+void HostPC_Get_TX_Stats(HostPC_TX_Stats_t *stats);
+bool HostPC_TX_Idle(void);
+
+uint32_t HostPC_Max_Baud_Rate(void);
+bool HostPC_Baud_Rate_Valid(uint32_t baud);
+bool HostPC_Set_Baud_Rate(uint32_t baud);
 
 #endif /* INC_USER_L1_USART_DRIVER_H_ */
\ No newline at end of file
@@ -7,6 +7,35 @@
 #ifndef ULTRASONIC_DRIVER_H
 #define ULTRASONIC_DRIVER_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* One entry per sensor in the driver's sensor table */
+typedef enum Ultrasonic_Sensor
+{
+    ULTRASONIC_VERTICAL,
+    ULTRASONIC_SENSOR_COUNT
+} Ultrasonic_Sensor_t;
+
+/* Ultrasonic_Sample_t flags */
+#define ULTRASONIC_SAMPLE_VALID (1 << 0)
+#define ULTRASONIC_SAMPLE_TIMEOUT (1 << 1) /* No echo; distance is 0 */
+
+typedef struct Ultrasonic_Sample
+{
+    uint32_t distance_mm;
+    uint32_t timestamp_cycles; /* DWT cycle count at the echo's falling edge, or at the timeout */
+    uint32_t echo_us;          /* Raw echo pulse width, 1 us capture ticks */
+    uint32_t sequence;         /* Increments by one per ping, echoed or not */
+    uint8_t flags;             /* ULTRASONIC_SAMPLE_* */
+} Ultrasonic_Sample_t;
+
 void Ultrasonic_Read_Task(void *pvParameters);
+bool Ultrasonic_Read_Latest(Ultrasonic_Sensor_t sensor, Ultrasonic_Sample_t *sample);
+void Ultrasonic_Set_Consumer(Ultrasonic_Sensor_t sensor, TaskHandle_t task);
+uint32_t Ultrasonic_Echo_Timeouts(Ultrasonic_Sensor_t sensor);
 
-#endif /* ULTRASONIC_DRIVER_H */
\ No newline at end of file
+#endif /* ULTRASONIC_DRIVER_H */
@@ -0,0 +1,56 @@
+/**
+ * @file Capture.h
+ */
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CAPTURE_OPCODE_HEADER 0x83
+#define CAPTURE_OPCODE_RECORDS 0x84
+#define CAPTURE_LENGTH 2048    /* Records held, several seconds at the sensor rate */
+#define CAPTURE_PRETRIGGER 256 /* Records kept from before the trigger */
+
+/* Event that starts an armed capture, in "cap" command keyword order */
+typedef enum
+{
+    CAPTURE_TRIGGER_OFF = 0, /* Stop and keep what was recorded */
+    CAPTURE_TRIGGER_NOW,
+    CAPTURE_TRIGGER_SETPOINT,
+    CAPTURE_TRIGGER_MODE,
+    CAPTURE_TRIGGER_COUNT
+} Capture_Trigger_t;
+
+/* One control cycle, sent little-endian exactly as laid out here */
+typedef struct __attribute__((packed)) Capture_Record
+{
+    uint32_t timestamp_cycles; /* DWT time of the echo */
+    uint16_t echo_us;          /* Raw echo pulse width in timer ticks */
+    uint16_t raw_distance_mm;
+    uint16_t filtered_distance_mm;
+    int16_t setpoint_mm;
+    int16_t output; /* PWM duty, negative counter-clockwise */
+    uint8_t mode;   /* Control_Mode_t */
+    uint8_t flags;  /* Filtered_Sample_t flags */
+} Capture_Record_t;
+
+/* Sent once ahead of the records of a dump */
+typedef struct __attribute__((packed)) Capture_Header
+{
+    uint16_t record_count;
+    uint16_t trigger_index;     /* First record after the trigger, CAPTURE_NOT_TRIGGERED if none */
+    uint32_t cycles_per_second; /* Timestamp rate */
+    uint8_t record_size;
+} Capture_Header_t;
+
+#define CAPTURE_NOT_TRIGGERED 0xFFFF
+
+void Capture_Task(void *pvParameters);
+void Capture_Record(const Capture_Record_t *record);
+void Capture_Arm(Capture_Trigger_t trigger);
+void Capture_Trigger(Capture_Trigger_t event);
+bool Capture_Start_Dump(void);
+
+#endif /* CAPTURE_H_ */
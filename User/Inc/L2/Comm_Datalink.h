@@ -6,14 +6,46 @@
 #define COMM_DATALINK_H_
 
 #include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
 
+#define MESSAGE_LINE_LENGTH 96
+#define MESSAGE_MAX_ARGUMENTS 6
+#define MESSAGE_POOL_SIZE 8 /* Commands in flight between the datalink and dispatcher */
+#define DATALINK_MAX_PAYLOAD 64 /* Largest outgoing frame payload */
+
+/* Set on a binary opcode when a little-endian uint16 sequence number follows it */
+#define FRAME_SEQUENCE_FLAG 0x40
+
+/* Worst-case COBS output size for n input bytes, excluding the delimiter */
+#define COBS_ENCODED_LENGTH(n) ((n) + ((n) / 254) + 1)
+
+typedef enum Message_Format
+{
+    MESSAGE_FORMAT_ASCII,  /* Console line, see command and arguments */
+    MESSAGE_FORMAT_BINARY, /* COBS frame, see opcode and payload */
+} Message_Format_t;
+
+/* Pooled command message; command, arguments and payload point into line */
 typedef struct Message
 {
-    char command[32];
-    char arguments[6][16];
+    Message_Format_t format;
+    bool has_sequence; /* Host asked for an ack */
+    uint16_t sequence;
+    char *command;
+    char *arguments[MESSAGE_MAX_ARGUMENTS];
     uint8_t arg_count;
+    uint8_t opcode;
+    const uint8_t *payload; /* Fixed-width little-endian fields */
+    uint8_t payload_length;
+    char line[MESSAGE_LINE_LENGTH];
 } Message_t;
 
 void Tokenize_Task(void *pvParameters);
+void Message_Release(Message_t *message);
+bool Datalink_Send_Frame(uint8_t opcode, const void *payload, size_t length);
+size_t Cobs_Decode(uint8_t *buffer, size_t length);
+size_t Cobs_Encode(const uint8_t *source, size_t length, uint8_t *destination);
+uint16_t Crc16_Ccitt(const uint8_t *data, size_t length);
 
 #endif /* COMM_DATALINK_H_ */
\ No newline at end of file
@@ -0,0 +1,19 @@
+/**
+ * @file Link_Rate.h
+ */
+
+#ifndef LINK_RATE_H_
+#define LINK_RATE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LINK_RATE_DEFAULT_BAUD 115200
+
+void Link_Rate_Task(void *pvParameters);
+bool Link_Rate_Request(uint32_t baud);
+void Link_Rate_Confirm(void);
+bool Link_Rate_Switch_Pending(void);
+uint32_t Link_Rate_Current(void);
+
+#endif /* LINK_RATE_H_ */
@@ -0,0 +1,39 @@
+/**
+ * @file Modbus_PDU.h
+ */
+
+#ifndef MODBUS_PDU_H_
+#define MODBUS_PDU_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MODBUS_SERVER_ADDRESS 1
+#define MODBUS_BROADCAST_ADDRESS 0
+#define MODBUS_MAX_ADU_LENGTH 256
+
+typedef enum Modbus_Exception
+{
+    MODBUS_EXCEPTION_NONE = 0,
+    MODBUS_EXCEPTION_ILLEGAL_FUNCTION = 0x01,
+    MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS = 0x02,
+    MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE = 0x03,
+    MODBUS_EXCEPTION_SERVER_DEVICE_FAILURE = 0x04,
+    MODBUS_EXCEPTION_SERVER_DEVICE_BUSY = 0x06,
+} Modbus_Exception_t;
+
+/* Register access supplied by the application; addresses are already range checked */
+typedef struct Modbus_Register_Map
+{
+    uint16_t holding_count;
+    uint16_t input_count;
+    Modbus_Exception_t (*read_holding)(uint16_t address, uint16_t *value);
+    Modbus_Exception_t (*write_holding)(uint16_t address, uint16_t value);
+    Modbus_Exception_t (*read_input)(uint16_t address, uint16_t *value);
+} Modbus_Register_Map_t;
+
+size_t Modbus_Process_Frame(const Modbus_Register_Map_t *map, const uint8_t *request, size_t length,
+                            uint8_t *response);
+uint16_t Modbus_Crc16(const uint8_t *data, size_t length);
+
+#endif /* MODBUS_PDU_H_ */
@@ -0,0 +1,14 @@
+/**
+ * @file Modbus_RTU.h
+ */
+
+#ifndef MODBUS_RTU_H_
+#define MODBUS_RTU_H_
+
+#include "L2/Modbus_PDU.h"
+
+void Modbus_Task(void *pvParameters);
+void Modbus_Set_Register_Map(const Modbus_Register_Map_t *map);
+void Modbus_Request_Exit(void);
+
+#endif /* MODBUS_RTU_H_ */
@@ -0,0 +1,25 @@
+/**
+ * @file Position_Estimator.h
+ */
+
+#ifndef POSITION_ESTIMATOR_H_
+#define POSITION_ESTIMATOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Constant-velocity Kalman filter state */
+typedef struct Position_Estimator
+{
+    float position_mm;
+    float velocity_mm_s;
+    float covariance[2][2]; /* Position/velocity error covariance */
+    float innovation_mm;    /* Last measurement minus prediction */
+    uint8_t rejected_in_row;
+} Position_Estimator_t;
+
+void Position_Estimator_Reset(Position_Estimator_t *estimator, float position_mm);
+void Position_Estimator_Predict(Position_Estimator_t *estimator, float dt);
+bool Position_Estimator_Update(Position_Estimator_t *estimator, float measurement_mm);
+
+#endif /* POSITION_ESTIMATOR_H_ */
@@ -0,0 +1,17 @@
+/**
+ * @file Rank_Filter.h
+ */
+
+#ifndef RANK_FILTER_H_
+#define RANK_FILTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RANK_FILTER_MAX_WINDOW 9
+
+bool Rank_Filter_Window_Valid(uint8_t window);
+uint32_t Rank_Filter_Median(const uint32_t *samples, uint8_t window);
+uint32_t Rank_Filter_Trimmed_Mean(const uint32_t *samples, uint8_t window, uint8_t trim);
+
+#endif /* RANK_FILTER_H_ */
@@ -5,6 +5,41 @@
 #ifndef SENSOR_FILTER_H_
 #define SENSOR_FILTER_H_
 
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Filter pipelines selectable at runtime */
+typedef enum Sensor_Filter_Profile
+{
+    SENSOR_FILTER_LEGACY,   /* Median of 3, first-order low-pass */
+    SENSOR_FILTER_FAST,     /* Median of 3 only */
+    SENSOR_FILTER_SMOOTH,   /* Median of 3, 10 Hz Butterworth */
+    SENSOR_FILTER_DECIMATE, /* Median of 3, FIR low-pass decimating by 2 */
+    SENSOR_FILTER_KALMAN,   /* Constant-velocity Kalman position, the default */
+    SENSOR_FILTER_ROBUST,   /* Trimmed mean of 7, 10 Hz Butterworth */
+    SENSOR_FILTER_PROFILE_COUNT
+} Sensor_Filter_Profile_t;
+
+/* Filtered_Sample_t flags */
+#define SENSOR_SAMPLE_AFTER_MISSED (1 << 0) /* Samples were lost since the previous record */
+#define SENSOR_SAMPLE_REJECTED (1 << 1)     /* Estimator rejected this sample as an outlier */
+
+/* Record sent on Filtered_Ultrasonic_Queue */
+typedef struct Filtered_Sample
+{
+    uint32_t timestamp_cycles; /* DWT cycle count at the echo capture */
+    uint32_t sequence;         /* Ultrasonic_Sample_t sequence */
+    uint32_t distance_mm;      /* Filtered distance */
+    uint32_t raw_distance_mm;
+    uint32_t echo_us; /* Raw echo pulse width */
+    uint8_t flags;    /* SENSOR_SAMPLE_* */
+} Filtered_Sample_t;
+
 void Sensor_Filter_Task(void *pvParameters);
+bool Sensor_Filter_Select_Profile(Sensor_Filter_Profile_t profile);
+uint32_t Sensor_Filter_Last_Raw(void);
+uint32_t Sensor_Filter_Last_Filtered(void);
+float Sensor_Filter_Velocity(void);
+uint32_t Sensor_Filter_Rejected_Samples(void);
 
-#endif /* SENSOR_FILTER_H_ */
\ No newline at end of file
+#endif /* SENSOR_FILTER_H_ */
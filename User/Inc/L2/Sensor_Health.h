@@ -0,0 +1,35 @@
+/**
+ * @file Sensor_Health.h
+ */
+
+#ifndef SENSOR_HEALTH_H_
+#define SENSOR_HEALTH_H_
+
+#include <stdint.h>
+
+#include "L1/Ultrasonic_Driver.h"
+
+typedef enum Sensor_Health_State
+{
+    SENSOR_HEALTH_OK = 0,
+    SENSOR_HEALTH_DEGRADED, /* Usable, but too many recent samples were bad */
+    SENSOR_HEALTH_FAILED    /* Consecutive bad samples, or no samples at all */
+} Sensor_Health_State_t;
+
+typedef struct Sensor_Health_Counters
+{
+    uint32_t samples;         /* Samples read, including timeouts */
+    uint32_t dropped;         /* Samples overwritten before they were read */
+    uint32_t timeouts;        /* Pings with no echo */
+    uint32_t out_of_range;    /* Echoes outside the hoist's travel */
+    uint32_t rate_violations; /* Echoes implying an impossible hoist speed */
+    uint32_t jitter_violations;
+    uint32_t jitter_us; /* Smoothed deviation of the sample interval from its mean */
+    uint32_t failures;  /* Transitions into SENSOR_HEALTH_FAILED */
+} Sensor_Health_Counters_t;
+
+void Sensor_Health_Update(const Ultrasonic_Sample_t *sample, uint32_t dropped);
+Sensor_Health_State_t Sensor_Health_Get_State(void);
+void Sensor_Health_Get_Counters(Sensor_Health_Counters_t *copy);
+
+#endif /* SENSOR_HEALTH_H_ */
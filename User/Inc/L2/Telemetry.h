@@ -0,0 +1,37 @@
+/**
+ * @file Telemetry.h
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+
+#define TELEMETRY_OPCODE_CONTROL_RECORD 0x80
+#define TELEMETRY_QUEUE_LENGTH 8
+
+/* One control cycle, sent little-endian exactly as laid out here */
+typedef struct __attribute__((packed)) Telemetry_Record
+{
+    uint32_t timestamp_ms;
+    uint16_t raw_distance_mm;
+    uint16_t filtered_distance_mm;
+    int16_t setpoint_mm;
+    float proportional; /* PID terms before output clamping */
+    float integral;
+    float derivative;
+    int8_t pwm_direction; /* PWM_Direction_t */
+    uint8_t pwm_duty;
+    uint8_t mode; /* Control_Mode_t */
+    uint8_t flags;
+} Telemetry_Record_t;
+
+#define TELEMETRY_FLAG_PID_ENABLED (1 << 0)
+#define TELEMETRY_FLAG_SAMPLE_MISSED (1 << 1) /* Sensor samples were lost before this cycle */
+
+void Telemetry_Task(void *pvParameters);
+void Telemetry_Publish(const Telemetry_Record_t *record);
+void Telemetry_Set_Divisor(uint32_t divisor);
+uint32_t Telemetry_Dropped_Records(void);
+
+#endif /* TELEMETRY_H_ */
@@ -7,6 +7,78 @@
 #ifndef COMMAND_DISPATCH_H
 #define COMMAND_DISPATCH_H
 
+#include <stdint.h>
+
+#define COMMAND_MAX_ARGUMENTS 6
+#define COMMAND_OPCODE_ACK 0x82
+
+/* Binary frame opcodes; must stay in step with the host tools */
+typedef enum Command_Opcode
+{
+    OPCODE_CHANGE_MODE = 0x01,          /* b: 0 manual, 1 calibrate, 2 auto */
+    OPCODE_SET_SETPOINT = 0x02,         /* i: setpoint in mm */
+    OPCODE_SET_HORIZONTAL_SPEED = 0x03, /* i: signed speed */
+    OPCODE_SET_VERTICAL_SPEED = 0x04,   /* i: signed speed */
+    OPCODE_TOGGLE_PID = 0x05,           /* b: 0 off, 1 on */
+    OPCODE_SET_PID_P = 0x06,            /* f: Kp */
+    OPCODE_SET_PID_I = 0x07,            /* f: Ki */
+    OPCODE_SET_PID_D = 0x08,            /* f: Kd */
+    OPCODE_GET_PID_GAINS = 0x09,
+    OPCODE_SET_TELEMETRY_RATE = 0x0A, /* i: every Nth control cycle, 0 off */
+    OPCODE_ENTER_MODBUS = 0x0B,       /* Switch the link to Modbus RTU */
+    OPCODE_SET_BAUD_RATE = 0x0C,      /* i: new baud rate, 0 to report the limit */
+    OPCODE_CONFIRM_BAUD_RATE = 0x0D,  /* Sent at the new rate to keep it */
+    OPCODE_SET_FILTER_PROFILE = 0x0E, /* b: Sensor_Filter_Profile_t */
+    OPCODE_ARM_CAPTURE = 0x0F,        /* b: Capture_Trigger_t */
+    OPCODE_DUMP_CAPTURE = 0x10,       /* Send the capture buffer */
+    OPCODE_GET_SENSOR_HEALTH = 0x11,  /* Log the sensor health counters */
+    OPCODE_SET_CONTROL_RATE = 0x12,   /* i: control loop rate in Hz */
+    OPCODE_GET_CONTROL_STATS = 0x13,  /* Log and restart the control loop timing statistics */
+    OPCODE_SET_TRAJECTORY = 0x14,     /* fff: max velocity, acceleration, jerk */
+    OPCODE_SET_PID_FF = 0x15,         /* f: Kff */
+    OPCODE_SET_GAINS = 0x16,          /* bbfff: Gain_Direction_t, schedule point, Kp, Ki, Kd */
+    OPCODE_SET_GAIN_FF = 0x17,        /* bbff: Gain_Direction_t, schedule point, Kff, offset */
+    OPCODE_SET_GAIN_POINT = 0x18,     /* bf: schedule point, position in mm */
+    OPCODE_GET_GAIN_POINT = 0x19,     /* b: schedule point to log */
+    OPCODE_SET_AUTOTUNE = 0x1A,       /* b: Autotune_Rule_t for the next calibration */
+    OPCODE_BENCHMARK_PID = 0x1B,      /* Log PID step cycle counts */
+    OPCODE_SET_TX_POLICY = 0x1C,      /* b: TX_Overflow_Policy_t */
+    OPCODE_GET_LINK_STATS = 0x1D,     /* Log the host link TX and RX counters */
+    OPCODE_GET_TASK_STACKS = 0x1E,    /* Print each task's unused stack */
+} Command_Opcode_t;
+
+_Static_assert(OPCODE_GET_TASK_STACKS < 0x40, "Command opcodes must leave the sequence flag clear");
+
+/* Handler outcome, reported in Command_Ack_t */
+typedef enum Command_Status
+{
+    COMMAND_OK = 0,
+    COMMAND_UNKNOWN,
+    COMMAND_INVALID_ARGUMENTS,
+    COMMAND_BUSY, /* Resource full, retry later */
+} Command_Status_t;
+
+/* Ack/nack for a sequenced command, sent little-endian exactly as laid out here */
+typedef struct __attribute__((packed)) Command_Ack
+{
+    uint16_t sequence;
+    uint8_t opcode; /* Executed opcode, 0 for an unknown console command */
+    uint8_t status; /* Command_Status_t */
+    uint32_t timestamp_ms;
+} Command_Ack_t;
+
+/* Decoded handler arguments, typed by the command's argument format */
+typedef struct Command_Args
+{
+    uint8_t count;
+    const char *text[COMMAND_MAX_ARGUMENTS]; /* Console token, NULL for binary frames */
+    union
+    {
+        int32_t i; /* 'i' and 'b' arguments */
+        float f;   /* 'f' arguments */
+    } value[COMMAND_MAX_ARGUMENTS];
+} Command_Args_t;
+
 void Command_Dispatch_Task(void *pvParameters);
 
-#endif /* COMMAND_DISPATCH_H */
\ No newline at end of file
+#endif /* COMMAND_DISPATCH_H */
@@ -0,0 +1,96 @@
+/**
+ * @file Command_Hash.h
+ *
+ * @brief Perfect hash of console command names, by hash and displace.
+ *
+ * A name of up to COMMAND_KEY_LENGTH characters packs into one 64-bit key.
+ * Keys are split into buckets by one hash, and each bucket stores a
+ * displacement that moves all of its keys into free slots of a second hash.
+ * A lookup is therefore one bucket read, one slot read and one key compare,
+ * whatever the number of commands.
+ *
+ * The table sizes follow the command count: the slot count is the next power
+ * of two at or above twice the count, with one bucket per four slots.
+ * Tests/Test_Command_Hash.c builds the registered table with the same code as
+ * the firmware, so a table that cannot be built fails the host tests.
+ */
+
+#ifndef COMMAND_HASH_H
+#define COMMAND_HASH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define COMMAND_KEY_LENGTH 8 /* Longest command name, packed into one 64-bit key */
+#define COMMAND_HASH_EMPTY 0xFF
+#define COMMAND_HASH_MAX_COMMANDS (COMMAND_HASH_EMPTY - 1)
+
+/* log2 of the slot count for a command count, from 16 slots up */
+#define COMMAND_HASH_BITS(count)                                                                                     \
+    ((count) <= 8 ? 4 : (count) <= 16 ? 5 : (count) <= 32 ? 6 : (count) <= 64 ? 7 : (count) <= 128 ? 8 : 9)
+#define COMMAND_HASH_SLOTS(count) (1u << COMMAND_HASH_BITS(count))
+#define COMMAND_HASH_BUCKETS(count) (COMMAND_HASH_SLOTS(count) / 4)
+
+typedef struct Command_Hash
+{
+    uint8_t slot_bits;
+    uint8_t *displacements; /* COMMAND_HASH_BUCKETS entries */
+    uint8_t *slots;         /* COMMAND_HASH_SLOTS entries, command index or COMMAND_HASH_EMPTY */
+} Command_Hash_t;
+
+bool Command_Hash_Build(Command_Hash_t *hash, const uint64_t *keys, uint8_t count);
+
+/**
+ * @brief Fold a packed key to 32 bits, mixing in every character.
+ */
+static inline uint32_t Command_Hash_Fold(uint64_t key)
+{
+    return ((uint32_t)key * 0x85EBCA6Bu) ^ ((uint32_t)(key >> 32) * 0xC2B2AE35u);
+}
+
+static inline uint32_t Command_Hash_Bucket(uint32_t folded, uint8_t slot_bits)
+{
+    return (folded * 0x9E3779B1u) >> (32 - (slot_bits - 2));
+}
+
+static inline uint32_t Command_Hash_Slot(uint32_t folded, uint8_t displacement, uint8_t slot_bits)
+{
+    return ((folded ^ (displacement * 0x27D4EB2Fu)) * 0x165667B1u) >> (32 - slot_bits);
+}
+
+/**
+ * @brief Look up a packed key.
+ *
+ * @return Index of the only command the key can be, or COMMAND_HASH_EMPTY;
+ *         the caller compares the keys
+ */
+static inline uint8_t Command_Hash_Find(const Command_Hash_t *hash, uint64_t key)
+{
+    uint32_t folded = Command_Hash_Fold(key);
+    uint8_t displacement = hash->displacements[Command_Hash_Bucket(folded, hash->slot_bits)];
+
+    return hash->slots[Command_Hash_Slot(folded, displacement, hash->slot_bits)];
+}
+
+/**
+ * @brief Pack a command name into a 64-bit key, first character in the low byte.
+ *
+ * @return false if the name is longer than any registered command can be
+ */
+static inline bool Command_Pack_Key(const char *command, uint64_t *key)
+{
+    uint64_t packed = 0;
+
+    for (uint8_t i = 0; command[i] != '\0'; i++)
+    {
+        if (i == COMMAND_KEY_LENGTH)
+        {
+            return false;
+        }
+        packed |= (uint64_t)(uint8_t)command[i] << (8 * i);
+    }
+    *key = packed;
+    return true;
+}
+
+#endif /* COMMAND_HASH_H */
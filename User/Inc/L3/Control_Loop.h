@@ -8,16 +8,40 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/* Cycle timing since the statistics were last taken */
+typedef struct Control_Loop_Stats
+{
+    uint32_t rate_hz;
+    uint32_t cycles;
+    uint32_t overruns; /* Ticks missed because the previous cycle was still running */
+    uint32_t period_min_us;
+    uint32_t period_max_us;
+    uint32_t latency_max_us;   /* Timer interrupt to cycle start */
+    uint32_t execution_max_us; /* Cycle start to end */
+} Control_Loop_Stats_t;
+
 void Control_Loop_Task(void *pvParameters);
 void Update_Motor_Setpoint_Task(void *pvParameters);
 void Set_Setpoint(uint32_t setpoint_mm);
 void Toggle_PID_Control(bool enable);
 
-void Set_Proportional_Gain(float Kp);
-void Set_Integral_Gain(float Ki);
-void Set_Derivative_Gain(float Kd);
+bool Set_Proportional_Gain(float Kp);
+bool Set_Integral_Gain(float Ki);
+bool Set_Derivative_Gain(float Kd);
+bool Set_Feedforward_Gain(float Kff);
+bool Set_Trajectory_Limits(float velocity_mm_s, float acceleration_mm_s2, float jerk_mm_s3);
 void Print_PID_Gains(void);
+void Set_PID_Output_Limit(float limit);
+void Get_PID_Gains(float *Kp, float *Ki, float *Kd);
+int32_t Get_Setpoint(void);
+bool PID_Control_Enabled(void);
+uint32_t Control_Loop_Missed_Samples(void);
+bool Wait_For_Setpoint(void);
+bool Control_Loop_Set_Rate(uint32_t rate_hz);
+void Control_Loop_Take_Stats(Control_Loop_Stats_t *stats);
+float Control_Loop_Take_Peak_Output(void);
 
 #define MOTOR_EVENT_BIT (1 << 0)
+#define MOTOR_FAULT_BIT (1 << 1) /* Sensor failed while the control loop was enabled */
 
 #endif /* CONTROL_LOOP_H */
\ No newline at end of file
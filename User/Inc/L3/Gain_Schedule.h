@@ -0,0 +1,39 @@
+/**
+ * @file Gain_Schedule.h
+ */
+
+#ifndef GAIN_SCHEDULE_H
+#define GAIN_SCHEDULE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GAIN_SCHEDULE_POINTS 4
+
+/* Direction of travel; up shortens the measured distance */
+typedef enum Gain_Direction
+{
+    GAIN_DIRECTION_UP,
+    GAIN_DIRECTION_DOWN,
+    GAIN_DIRECTION_COUNT
+} Gain_Direction_t;
+
+/* Controller gains at one schedule point */
+typedef struct Gain_Set
+{
+    float Kp;
+    float Ki;
+    float Kd;
+    float Kff;    /* Feedforward gain on the reference velocity */
+    float offset; /* Constant feedforward output, pulse width */
+} Gain_Set_t;
+
+void Gain_Schedule_Lookup(Gain_Direction_t direction, float position_mm, Gain_Set_t *gains);
+bool Gain_Schedule_Get_Entry(Gain_Direction_t direction, uint8_t point, Gain_Set_t *gains);
+bool Gain_Schedule_Set_Entry(Gain_Direction_t direction, uint8_t point, const Gain_Set_t *gains);
+bool Gain_Schedule_Rescale_Term(Gain_Direction_t direction, size_t term, float from, float to);
+bool Gain_Schedule_Get_Point(uint8_t point, float *position_mm);
+bool Gain_Schedule_Set_Point(uint8_t point, float position_mm);
+
+#endif /* GAIN_SCHEDULE_H */
@@ -0,0 +1,47 @@
+/**
+ * @file Modbus_Registers.h
+ *
+ * @brief Modbus register map of the crane.
+ *
+ * Floats span two registers, high word first, and take effect when the low word
+ * is written, so write both in one 0x10 request.
+ */
+
+#ifndef MODBUS_REGISTERS_H
+#define MODBUS_REGISTERS_H
+
+/* Holding registers (read/write) */
+typedef enum Modbus_Holding_Register
+{
+    HOLDING_SETPOINT_MM = 0,
+    HOLDING_MODE = 1,             /* Control_Mode_t */
+    HOLDING_PID_ENABLE = 2,       /* 0 off, 1 on */
+    HOLDING_HORIZONTAL_SPEED = 3, /* Signed, last commanded */
+    HOLDING_VERTICAL_SPEED = 4,   /* Signed, last commanded */
+    HOLDING_KP_HIGH = 5,          /* float32 */
+    HOLDING_KP_LOW = 6,
+    HOLDING_KI_HIGH = 7, /* float32 */
+    HOLDING_KI_LOW = 8,
+    HOLDING_KD_HIGH = 9, /* float32 */
+    HOLDING_KD_LOW = 10,
+    HOLDING_LINK_MODE = 11, /* Write 0 to return the link to the console */
+    HOLDING_REGISTER_COUNT
+} Modbus_Holding_Register_t;
+
+/* Input registers (read only) */
+typedef enum Modbus_Input_Register
+{
+    INPUT_FILTERED_POSITION_MM = 0,
+    INPUT_RAW_POSITION_MM = 1,
+    INPUT_MODE = 2,          /* Control_Mode_t */
+    INPUT_STATUS = 3,        /* MODBUS_STATUS_* bits */
+    INPUT_SENSOR_HEALTH = 4, /* Sensor_Health_State_t */
+    INPUT_REGISTER_COUNT
+} Modbus_Input_Register_t;
+
+#define MODBUS_STATUS_PID_ENABLED (1 << 0)
+#define MODBUS_STATUS_SETPOINT_REACHED (1 << 1)
+
+void Modbus_Registers_Init(void);
+
+#endif /* MODBUS_REGISTERS_H */
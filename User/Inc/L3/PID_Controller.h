@@ -0,0 +1,37 @@
+/**
+ * @file PID_Controller.h
+ */
+
+#ifndef PID_CONTROLLER_H
+#define PID_CONTROLLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "arm_math.h"
+#include "L3/Gain_Schedule.h"
+
+typedef struct PID_Controller
+{
+    arm_pid_instance_f32 pi; /* Proportional and integral terms; Kd is unused */
+    float Kd;
+    float Kff;
+    float offset;
+    float output_limit;        /* Symmetric output clamp */
+    float derivative_filter_s; /* Time constant of the measured rate filter, 0 for none */
+    float dt;                  /* Cycle time rate_weight was computed for */
+    float rate_weight;         /* Rate filter weight per step */
+    float rate;                /* Filtered rate of change of the measurement */
+    bool have_rate;
+    float proportional; /* Last computed terms, for telemetry */
+    float integral;
+    float derivative;
+} PID_Controller_t;
+
+void PID_Controller_Init(PID_Controller_t *pid, float output_limit, float derivative_filter_s);
+void PID_Controller_Reset(PID_Controller_t *pid);
+void PID_Controller_Set_Gains(PID_Controller_t *pid, const Gain_Set_t *gains, float dT);
+float PID_Controller_Step(PID_Controller_t *pid, float error, float measured_rate, float reference_rate);
+void PID_Controller_Benchmark(uint32_t *reference_cycles, uint32_t *cmsis_cycles);
+
+#endif /* PID_CONTROLLER_H */
@@ -0,0 +1,46 @@
+/**
+ * @file Relay_Autotune.h
+ */
+
+#ifndef RELAY_AUTOTUNE_H
+#define RELAY_AUTOTUNE_H
+
+#include <stdbool.h>
+
+#include "L3/Gain_Schedule.h"
+
+typedef enum Autotune_State
+{
+    AUTOTUNE_IDLE,
+    AUTOTUNE_RUNNING,
+    AUTOTUNE_DONE,
+    AUTOTUNE_FAILED
+} Autotune_State_t;
+
+/* Tuning rules from the ultimate gain and period */
+typedef enum Autotune_Rule
+{
+    AUTOTUNE_RULE_NONE, /* Do not tune */
+    AUTOTUNE_RULE_ZIEGLER_NICHOLS,
+    AUTOTUNE_RULE_ZIEGLER_NICHOLS_PI,
+    AUTOTUNE_RULE_TYREUS_LUYBEN,
+    AUTOTUNE_RULE_NO_OVERSHOOT,
+    AUTOTUNE_RULE_COUNT
+} Autotune_Rule_t;
+
+typedef struct Autotune_Result
+{
+    float ultimate_gain; /* Pulse width per mm */
+    float ultimate_period_s;
+    float amplitude_mm; /* Overshoot past the setpoint after travel in this direction */
+} Autotune_Result_t;
+
+void Relay_Autotune_Start(float output, float hysteresis, float bias);
+void Relay_Autotune_Cancel(void);
+float Relay_Autotune_Step(float error, float dt);
+bool Relay_Autotune_Running(void);
+Autotune_State_t Relay_Autotune_Get_State(void);
+bool Relay_Autotune_Get_Result(Gain_Direction_t direction, Autotune_Result_t *copy);
+bool Relay_Autotune_Gains(Autotune_Rule_t rule, const Autotune_Result_t *identified, float *Kp, float *Ki, float *Kd);
+
+#endif /* RELAY_AUTOTUNE_H */
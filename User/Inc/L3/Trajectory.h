@@ -0,0 +1,25 @@
+/**
+ * @file Trajectory.h
+ */
+
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <stdbool.h>
+
+/* Jerk-limited reference between setpoints */
+typedef struct Trajectory
+{
+    float max_velocity_mm_s; /* 0 passes setpoints straight through */
+    float max_acceleration_mm_s2;
+    float max_jerk_mm_s3;
+    float position_mm; /* Reference state */
+    float velocity_mm_s;
+    float acceleration_mm_s2;
+} Trajectory_t;
+
+void Trajectory_Reset(Trajectory_t *trajectory, float position_mm);
+void Trajectory_Step(Trajectory_t *trajectory, float target_mm, float dt);
+bool Trajectory_Done(const Trajectory_t *trajectory, float target_mm);
+
+#endif /* TRAJECTORY_H */
@@ -5,7 +5,10 @@
 #ifndef CALIBRATE_MODE_H
 #define CALIBRATE_MODE_H
 
+#include "L3/Relay_Autotune.h"
+
 void Run_Calibrate_Mode(void);
 void Initialize_Calibrate_Mode(void);
+void Set_Autotune_Rule(Autotune_Rule_t rule);
 
 #endif /* CALIBRATE_MODE_H */
\ No newline at end of file
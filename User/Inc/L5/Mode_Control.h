@@ -13,5 +13,6 @@ typedef enum
 
 void Mode_Control_Task(void *pvParameters);
 void Transition_Mode(Control_Mode_t new_mode);
+Control_Mode_t Get_Control_Mode(void);
 
 #endif /* MODE_CONTROL_H */
\ No newline at end of file
@@ -0,0 +1,63 @@
+/**
+ * @file Log.h
+ *
+ * @brief Tokenized logging.
+ *
+ * LOG("Setpoint %ld mm, Kp %.2f", setpoint, Kp);
+ *
+ * The format string is placed in the non-loaded .log_strings section and never
+ * reaches flash; its offset in that section is the log ID. A call site only
+ * stores the ID, a timestamp and up to LOG_MAX_ARGUMENTS raw 32-bit arguments,
+ * and Tools/log_decode.py rebuilds the text from the ELF file.
+ *
+ * Arguments must be integers or floats (doubles are narrowed to float); %s is
+ * not supported. Safe from tasks and ISRs.
+ */
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define LOG_OPCODE_RECORD 0x81
+#define LOG_MAX_ARGUMENTS 4
+
+static inline uint32_t Log_Float_Bits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static inline uint32_t Log_Int_Bits(uint32_t value)
+{
+    return value;
+}
+
+#define LOG_ARG(x) _Generic((x), float: Log_Float_Bits, double: Log_Float_Bits, default: Log_Int_Bits)(x)
+
+#define LOG_COUNT_(_0, _1, _2, _3, _4, N, ...) N
+#define LOG_COUNT(...) LOG_COUNT_(_, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define LOG_ARGS_0()
+#define LOG_ARGS_1(a) LOG_ARG(a)
+#define LOG_ARGS_2(a, b) LOG_ARG(a), LOG_ARG(b)
+#define LOG_ARGS_3(a, b, c) LOG_ARG(a), LOG_ARG(b), LOG_ARG(c)
+#define LOG_ARGS_4(a, b, c, d) LOG_ARG(a), LOG_ARG(b), LOG_ARG(c), LOG_ARG(d)
+#define LOG_ARGS_(n, ...) LOG_ARGS_##n(__VA_ARGS__)
+#define LOG_ARGS(n, ...) LOG_ARGS_(n, __VA_ARGS__)
+
+#define LOG(format, ...)                                                                             \
+    do                                                                                               \
+    {                                                                                                \
+        static const char log_format_[] __attribute__((section(".log_strings"), used)) = format;    \
+        const uint32_t log_args_[LOG_COUNT(__VA_ARGS__) + 1] = {                                     \
+            LOG_ARGS(LOG_COUNT(__VA_ARGS__), ##__VA_ARGS__)};                                        \
+        Log_Write((uint16_t)(uintptr_t)log_format_, log_args_, LOG_COUNT(__VA_ARGS__));              \
+    } while (0)
+
+void Log_Write(uint16_t id, const uint32_t *arguments, uint8_t count);
+void Log_Task(void *pvParameters);
+uint32_t Log_Dropped_Records(void);
+
+#endif /* LOG_H_ */
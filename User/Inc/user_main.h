@@ -14,14 +14,17 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-#include "FreeRTOS.h"     /* FreeRTOS kernal */
-#include "event_groups.h" /* FreeRTOS event group functions */
-#include "task.h"         /* FreeRTOS task functions */
-#include "queue.h"        /* FreeRTOS queue functions */
-#include "semphr.h"       /* FreeRTOS semaphore functions */
-#include "main.h"         /* Hal and Object Handles */
-#include "util.h"         /* Print Functions */
+#include "FreeRTOS.h"       /* FreeRTOS kernal */
+#include "event_groups.h"   /* FreeRTOS event group functions */
+#include "task.h"           /* FreeRTOS task functions */
+#include "queue.h"          /* FreeRTOS queue functions */
+#include "semphr.h"         /* FreeRTOS semaphore functions */
+#include "stream_buffer.h"  /* FreeRTOS stream buffer functions */
+#include "message_buffer.h" /* FreeRTOS message buffer functions */
+#include "main.h"           /* Hal and Object Handles */
+#include "util.h"           /* Print Functions */
 
 void user_main(void);
+void Print_Task_Stacks(void);
 
 #endif /* USER_MAIN_H */
\ No newline at end of file
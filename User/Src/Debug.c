@@ -2,6 +2,9 @@
  * @file Debug.c
  *
  * @brief Debug task implementations.
+ *
+ * Each task is built and started only when its DEBUGn switch is defined. Their
+ * stacks are static, so enabling one never eats into the FreeRTOS heap budget.
  */
 
 /* Module Header */
@@ -12,52 +15,72 @@
 
 /* User Libraries */
 #include "user_main.h"
+#include "Log.h"
 #include "L2/Comm_Datalink.h"
 #include "L1/PWM_Driver.h"
+#include "L1/Ultrasonic_Driver.h"
+#include "L2/Sensor_Filter.h"
+#include "L2/Rank_Filter.h"
+#include "L1/Cycle_Counter.h"
 
 extern QueueHandle_t Command_Queue;
 extern QueueHandle_t PWM_Queue;
-extern QueueHandle_t Raw_Ultrasonic_Queue;
 extern QueueHandle_t Filtered_Ultrasonic_Queue;
 
 // #define DEBUG1
 // #define DEBUG2
 // #define DEBUG3
 // #define DEBUG4
+// #define DEBUG5
+
+#define DEBUG_TASK_STACK_SIZE (configMINIMAL_STACK_SIZE + 100)
+
+/* Declares the static stack and TCB of one debug task and starts it */
+#define CREATE_DEBUG_TASK(function)                                                                                    \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        static StackType_t function##_stack[DEBUG_TASK_STACK_SIZE];                                                    \
+        static StaticTask_t function##_tcb;                                                                            \
+        TaskHandle_t handle = xTaskCreateStatic(function, #function, DEBUG_TASK_STACK_SIZE, NULL,                      \
+                                                tskIDLE_PRIORITY + 1, function##_stack, &function##_tcb);              \
+        configASSERT(handle != NULL);                                                                                  \
+        UNUSED(handle);                                                                                                \
+    } while (0)
 
 #ifdef DEBUG1
 /**
  * @brief Debug task to print received commands and arguments.  Will not work if higher priority task reading from Command_Queue.
  */
-void Debug_Task1(void *pvParameters)
+static void Debug_Task1(void *pvParameters)
 {
     char main_string[256];
-    Message_t received_message;
+    Message_t *received_message;
     while (1)
     {
         xQueueReceive(Command_Queue, &received_message, portMAX_DELAY);
-        for (uint8_t i = 0; i < received_message.arg_count + 1; i++)
+        if (received_message->format == MESSAGE_FORMAT_BINARY)
         {
-            if (i == 0)
-            {
-                sprintf(main_string, "Command: %s\r\n", received_message.command);
-                print_str(main_string);
-            }
-            else
+            sprintf(main_string, "Opcode: 0x%02X, Payload: %d bytes\r\n", received_message->opcode,
+                    received_message->payload_length);
+            print_str(main_string);
+        }
+        else
+        {
+            for (uint8_t i = 0; i < received_message->arg_count + 1; i++)
             {
-                sprintf(main_string, "Arg %d: %s\r\n", i, received_message.arguments[i - 1]);
-                print_str(main_string);
+                if (i == 0)
+                {
+                    sprintf(main_string, "Command: %s\r\n", received_message->command);
+                    print_str(main_string);
+                }
+                else
+                {
+                    sprintf(main_string, "Arg %d: %s\r\n", i, received_message->arguments[i - 1]);
+                    print_str(main_string);
+                }
             }
         }
-    }
-    UNUSED(pvParameters);
-}
-#else
-void Debug_Task1(void *pvParameters)
-{
-    while (1)
-    {
-        vTaskDelay(portMAX_DELAY);
+        Message_Release(received_message);
     }
     UNUSED(pvParameters);
 }
@@ -67,7 +90,7 @@ void Debug_Task1(void *pvParameters)
 /**
  * @brief Debug task to ramp PWM duty cycle for testing
  */
-void Debug_Task2(void *pvParameters)
+static void Debug_Task2(void *pvParameters)
 {
     int pulse_width = 0;
     int inc = 1;
@@ -89,15 +112,6 @@ void Debug_Task2(void *pvParameters)
     }
     UNUSED(pvParameters);
 }
-#else
-void Debug_Task2(void *pvParameters)
-{
-    while (1)
-    {
-        vTaskDelay(portMAX_DELAY);
-    }
-    UNUSED(pvParameters);
-}
 #endif
 
 #ifdef DEBUG3
@@ -105,33 +119,26 @@ void Debug_Task2(void *pvParameters)
 /**
  * @brief Debug task to read raw ultrasonic sensor distances and print them.
  */
-void Debug_Task3(void *pvParameters)
+static void Debug_Task3(void *pvParameters)
 {
-    uint32_t distance_mm;
-    char debug_string[64];
+    Ultrasonic_Sample_t sample;
+    uint32_t last_sequence = 0;
 
     while (1)
     {
-        /* Read distance from Ultrasonic Queue */
-        if (xQueueReceive(Raw_Ultrasonic_Queue, &distance_mm, portMAX_DELAY) == pdTRUE)
+        /* Poll the latest sample mailbox */
+        if (Ultrasonic_Read_Latest(ULTRASONIC_VERTICAL, &sample) && sample.sequence != last_sequence)
         {
-            /* Print the distance */
-            sprintf(debug_string, "Ultrasonic Distance: %lu mm\r\n", (unsigned long)distance_mm);
-            print_str(debug_string);
+            last_sequence = sample.sequence;
+            /* Log the distance */
+            LOG("Ultrasonic Distance: %lu mm, echo %lu us, flags 0x%02x", sample.distance_mm, sample.echo_us,
+                sample.flags);
         }
+        vTaskDelay(pdMS_TO_TICKS(30));
     }
 
     UNUSED(pvParameters);
 }
-#else
-void Debug_Task3(void *pvParameters)
-{
-    while (1)
-    {
-        vTaskDelay(portMAX_DELAY);
-    }
-    UNUSED(pvParameters);
-}
 #endif
 
 #ifdef DEBUG4
@@ -139,52 +146,98 @@ void Debug_Task3(void *pvParameters)
 /**
  * @brief Debug task to read filtered ultrasonic sensor distances and print them.
  */
-void Debug_Task4(void *pvParameters)
+static void Debug_Task4(void *pvParameters)
 {
-    uint32_t distance_mm;
-    char debug_string[64];
+    Filtered_Sample_t sample;
 
     while (1)
     {
         /* Read distance from Ultrasonic Queue */
-        if (xQueueReceive(Filtered_Ultrasonic_Queue, &distance_mm, portMAX_DELAY) == pdTRUE)
+        if (xQueueReceive(Filtered_Ultrasonic_Queue, &sample, portMAX_DELAY) == pdTRUE)
         {
-            /* Print the distance */
-            sprintf(debug_string, "Ultrasonic Distance: %lu mm\r\n", (unsigned long)distance_mm);
-            print_str(debug_string);
+            /* Log the distance */
+            LOG("Filtered Ultrasonic Distance: %lu mm, sequence %lu, flags 0x%02x", sample.distance_mm,
+                sample.sequence, sample.flags);
         }
     }
 
     UNUSED(pvParameters);
 }
-#else
-void Debug_Task4(void *pvParameters)
-{
-    while (1)
-    {
-        vTaskDelay(portMAX_DELAY);
-    }
-    UNUSED(pvParameters);
-}
 #endif
 
 #ifdef DEBUG5
 
+#define RANK_BENCHMARK_SAMPLES 1000
+
 /**
- * @brief Debug task
+ * @brief Debug task to benchmark the rank filters in cycles per sample and print the results.
+ *
+ * Runs once, with the scheduler suspended around each timed batch.
  */
-void Debug_Task5(void *pvParameters)
+static void Debug_Task5(void *pvParameters)
 {
+    static uint32_t samples[RANK_BENCHMARK_SAMPLES + RANK_FILTER_MAX_WINDOW];
+    volatile uint32_t sink = 0;
+    uint32_t seed = 12345;
+    uint32_t median_cycles;
+    uint32_t trimmed_cycles;
+    uint32_t start;
+
+    /* Distances with occasional spikes */
+    for (uint32_t i = 0; i < RANK_BENCHMARK_SAMPLES + RANK_FILTER_MAX_WINDOW; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        samples[i] = (seed >> 24) < 16 ? 4000 : 50 + ((seed >> 16) & 0x3F);
+    }
+
+    for (uint8_t window = 3; window <= RANK_FILTER_MAX_WINDOW; window += 2)
+    {
+        vTaskSuspendAll();
+        start = Cycle_Counter_Now();
+        for (uint32_t i = 0; i < RANK_BENCHMARK_SAMPLES; i++)
+        {
+            sink += Rank_Filter_Median(&samples[i], window);
+        }
+        median_cycles = Cycle_Counter_Now() - start;
+
+        start = Cycle_Counter_Now();
+        for (uint32_t i = 0; i < RANK_BENCHMARK_SAMPLES; i++)
+        {
+            sink += Rank_Filter_Trimmed_Mean(&samples[i], window, 1);
+        }
+        trimmed_cycles = Cycle_Counter_Now() - start;
+        xTaskResumeAll();
+
+        LOG("Rank window %u: median %lu, trimmed mean %lu cycles/sample", window,
+            median_cycles / RANK_BENCHMARK_SAMPLES, trimmed_cycles / RANK_BENCHMARK_SAMPLES);
+    }
 
-    UNUSED(pvParameters);
-}
-#else
-void Debug_Task5(void *pvParameters)
-{
     while (1)
     {
         vTaskDelay(portMAX_DELAY);
     }
     UNUSED(pvParameters);
 }
-#endif
\ No newline at end of file
+#endif
+
+/**
+ * @brief Start the debug tasks whose switches are defined.
+ */
+void Debug_Create_Tasks(void)
+{
+#ifdef DEBUG1
+    CREATE_DEBUG_TASK(Debug_Task1);
+#endif
+#ifdef DEBUG2
+    CREATE_DEBUG_TASK(Debug_Task2);
+#endif
+#ifdef DEBUG3
+    CREATE_DEBUG_TASK(Debug_Task3);
+#endif
+#ifdef DEBUG4
+    CREATE_DEBUG_TASK(Debug_Task4);
+#endif
+#ifdef DEBUG5
+    CREATE_DEBUG_TASK(Debug_Task5);
+#endif
+}
@@ -0,0 +1,115 @@
+/**
+ * @file Control_Timer.c
+ *
+ * @brief Paces the control loop from a hardware timer.
+ *
+ * TIM4 is not used by the CubeMX configuration and is set up here. Its update
+ * interrupt timestamps the tick with the DWT cycle counter and gives the
+ * control task a direct-to-task notification. Ticks the task has not taken yet
+ * accumulate in its notification count, which is how overruns are detected.
+ *
+ * The auto-reload register is preloaded, so a rate change takes effect at the
+ * next tick without a short or long period in between.
+ */
+
+/* Module Header */
+#include "L1/Control_Timer.h"
+
+/* Standard Libraries */
+
+/* User Libraries */
+#include "user_main.h"
+#include "L1/Cycle_Counter.h"
+
+#define CONTROL_TIMER_COUNTER_HZ 1000000 /* 1 us resolution; 1000 Hz to 20 Hz fits in 16 bits */
+
+static TIM_HandleTypeDef htim4;
+static TaskHandle_t control_task = NULL;
+static volatile uint32_t control_rate_hz = 0;
+static volatile uint32_t last_tick_cycles = 0;
+
+/**
+ * @brief Start the control tick.
+ *
+ * @param rate_hz Tick rate, CONTROL_TIMER_MIN_RATE_HZ to CONTROL_TIMER_MAX_RATE_HZ
+ * @param task Task notified on every tick
+ * @return false if the rate is out of range or the timer failed to start
+ */
+bool Control_Timer_Start(uint32_t rate_hz, TaskHandle_t task)
+{
+    if (rate_hz < CONTROL_TIMER_MIN_RATE_HZ || rate_hz > CONTROL_TIMER_MAX_RATE_HZ)
+    {
+        return false;
+    }
+    control_task = task;
+    control_rate_hz = rate_hz;
+
+    /* TIM4 is clocked from APB1 timers @ 84 MHz; APB1 is divided by 2 so timers run at HCLK */
+    __HAL_RCC_TIM4_CLK_ENABLE();
+    htim4.Instance = TIM4;
+    htim4.Init.Prescaler = (SystemCoreClock / CONTROL_TIMER_COUNTER_HZ) - 1;
+    htim4.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim4.Init.Period = (CONTROL_TIMER_COUNTER_HZ / rate_hz) - 1;
+    htim4.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    htim4.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    if (HAL_TIM_Base_Init(&htim4) != HAL_OK)
+    {
+        return false;
+    }
+
+    /* Same priority as the capture interrupts, within the FreeRTOS API limit */
+    HAL_NVIC_SetPriority(TIM4_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(TIM4_IRQn);
+    return HAL_TIM_Base_Start_IT(&htim4) == HAL_OK;
+}
+
+/**
+ * @brief Change the control tick rate from the next tick.
+ *
+ * @param rate_hz Tick rate, CONTROL_TIMER_MIN_RATE_HZ to CONTROL_TIMER_MAX_RATE_HZ
+ * @return false if the rate is out of range or the timer is not running
+ */
+bool Control_Timer_Set_Rate(uint32_t rate_hz)
+{
+    if (htim4.Instance == NULL || rate_hz < CONTROL_TIMER_MIN_RATE_HZ || rate_hz > CONTROL_TIMER_MAX_RATE_HZ)
+    {
+        return false;
+    }
+    __HAL_TIM_SET_AUTORELOAD(&htim4, (CONTROL_TIMER_COUNTER_HZ / rate_hz) - 1);
+    control_rate_hz = rate_hz;
+    return true;
+}
+
+/**
+ * @brief Current control tick rate in Hz.
+ */
+uint32_t Control_Timer_Rate(void)
+{
+    return control_rate_hz;
+}
+
+/**
+ * @brief DWT cycle count taken in the interrupt of the most recent tick.
+ */
+uint32_t Control_Timer_Last_Tick(void)
+{
+    return last_tick_cycles;
+}
+
+/**
+ * @brief TIM4 global interrupt.
+ *
+ * Handled directly rather than through HAL_TIM_IRQHandler to keep the tick short.
+ */
+void TIM4_IRQHandler(void)
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    if (__HAL_TIM_GET_FLAG(&htim4, TIM_FLAG_UPDATE) != RESET)
+    {
+        __HAL_TIM_CLEAR_IT(&htim4, TIM_IT_UPDATE);
+        last_tick_cycles = Cycle_Counter_Now();
+        vTaskNotifyGiveFromISR(control_task, &xHigherPriorityTaskWoken);
+    }
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
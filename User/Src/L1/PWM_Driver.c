@@ -85,14 +85,7 @@ void PWM_Timer_Task(void *pvParameters)
     {
         if (xQueueReceive(PWM_Queue, &cmd, portMAX_DELAY) == pdTRUE)
         {
-            if (cmd.channel == HORIZONTAL_SERVO_PWM)
-            {
-                Set_Servo_Drive(&servo_horizontal, cmd.direction, cmd.duty_cycle);
-            }
-            else if (cmd.channel == VERTICAL_SERVO_PWM)
-            {
-                Set_Servo_Drive(&servo_vertical, cmd.direction, cmd.duty_cycle);
-            }
+            PWM_Set_Drive(&cmd);
         }
     }
 
@@ -185,6 +178,29 @@ void Set_Servo_Drive(Servo_t *servo, PWM_Direction_t direction, uint16_t duty_cy
     }
 }
 
+/**
+ * @brief Apply a servo drive command at once, without going through PWM_Queue
+ *
+ * For callers that must never wait on the PWM task, such as the control loop.
+ * Takes effect from the next PWM frame; the frame interrupt reads the servo
+ * state, so it is updated with interrupts masked.
+ *
+ * @param cmd Channel, direction and duty cycle
+ */
+void PWM_Set_Drive(const PWM_Duty_Cycle_t *cmd)
+{
+    taskENTER_CRITICAL();
+    if (cmd->channel == HORIZONTAL_SERVO_PWM)
+    {
+        Set_Servo_Drive(&servo_horizontal, cmd->direction, cmd->duty_cycle);
+    }
+    else if (cmd->channel == VERTICAL_SERVO_PWM)
+    {
+        Set_Servo_Drive(&servo_vertical, cmd->direction, cmd->duty_cycle);
+    }
+    taskEXIT_CRITICAL();
+}
+
 /**
  * @brief Timer period elapsed callback
  *
@@ -219,4 +235,33 @@ void PWM_Disable_All(void)
 {
     HAL_TIM_PWM_Stop(&htim1, TIM_CHANNEL_1);
     HAL_TIM_PWM_Stop(&htim1, TIM_CHANNEL_2);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Request a signed servo speed without blocking
+ *
+ * @param channel Servo to drive
+ * @param speed Signed duty cycle, positive for clockwise
+ * @return false if the PWM queue is full
+ */
+bool PWM_Request_Speed(PWM_Channel_t channel, int32_t speed)
+{
+    PWM_Duty_Cycle_t pwm_msg;
+
+    pwm_msg.channel = channel;
+    if (speed > 0)
+    {
+        pwm_msg.direction = DIRECTION_CLOCKWISE;
+    }
+    else if (speed < 0)
+    {
+        pwm_msg.direction = DIRECTION_COUNTERCLOCKWISE;
+        speed = -speed; /* Make speed positive for duty cycle */
+    }
+    else
+    {
+        pwm_msg.direction = DIRECTION_IDLE;
+    }
+    pwm_msg.duty_cycle = (int16_t)speed;
+    return xQueueSend(PWM_Queue, &pwm_msg, 0) == pdTRUE;
+}
@@ -3,6 +3,23 @@
  *
  *  Created on: Oct. 21, 2022
  *      Author: Andre Hendricks / Dr. JF Bousquet
+ *
+ * Host PC reception runs on a circular DMA ring with USART idle-line detection.
+ * Every idle line, half-transfer or transfer-complete event hands the newly
+ * received span to the datalink layer as a single chunk.
+ *
+ * Host PC transmission goes through a lock-free multi-producer ring drained by
+ * TX DMA. Producers claim space with a compare-and-swap, copy their bytes, then
+ * publish once every earlier claim has been committed. The DMA completion
+ * interrupt starts the next transfer, so callers never wait on the wire.
+ *
+ * In Modbus link mode the received spans are gathered into one frame until the
+ * line has been silent for t3.5, and each complete frame is handed over as a
+ * single message. The USART only flags one character of idle line, so the idle
+ * event starts TIM5 for the rest of t3.5; if the DMA has not moved when it
+ * expires, the frame is complete. TIM5 is not used by the CubeMX configuration.
+ * Only the Modbus server may transmit in that mode, so console output, logs and
+ * telemetry cannot corrupt its replies.
  */
 
 /* Module Header */
@@ -14,46 +31,519 @@
 /* User Libraries */
 #include "user_main.h"
 
-#define MAX_RX_BUFFER_LENGTH 40
+#define RX_DMA_BUFFER_LENGTH 256 /* Circular DMA ring, ~22 ms of data at 115200 baud */
+#define TX_RING_LENGTH 1024      /* Must be a power of two */
+#define TX_RING_MASK (TX_RING_LENGTH - 1)
+#define TX_BLOCK_TIMEOUT_MS 50 /* Longest a blocking producer waits for ring space */
+#define RX_FRAME_LENGTH 256    /* Largest Modbus RTU ADU */
+#define BAUD_RATE_MIN 9600
+#define BAUD_RATE_TOLERANCE_PERCENT 2 /* Largest divider error accepted for a requested rate */
+#define FRAME_TIMER_COUNTER_HZ 1000000 /* 1 us resolution */
+#define MODBUS_CHARACTER_BITS 11       /* Start, 8 data, parity or second stop, stop */
+#define MODBUS_FIXED_T35_BAUD 19200    /* Above this rate t3.5 is fixed */
+#define MODBUS_FIXED_T35_US 1750
+
+static uint8_t rx_dma_buffer_hostPC[RX_DMA_BUFFER_LENGTH];
+static uint16_t rx_dma_read_index = 0;       /* Next ring index not yet handed to the datalink */
+static volatile uint32_t rx_dropped_bytes = 0; /* Bytes lost to a full stream buffer */
+static uint8_t rx_frame[RX_FRAME_LENGTH];      /* Frame being gathered in Modbus mode */
+static uint16_t rx_frame_length = 0;
+static bool rx_frame_overflow = false;
+static volatile HostPC_Link_Mode_t link_mode = HOSTPC_LINK_CONSOLE;
+static TIM_HandleTypeDef htim5;
+static uint32_t frame_gap_us;     /* Silence after the idle event that completes t3.5 */
+static uint16_t frame_idle_index; /* DMA write position at the last idle event */
 
-uint8_t rx_buffer_extern[MAX_RX_BUFFER_LENGTH];
-uint8_t rx_buffer_hostPC[MAX_RX_BUFFER_LENGTH];
+/* TX ring indices are free-running byte counts, masked on access */
+static uint8_t tx_ring[TX_RING_LENGTH];
+static volatile uint32_t tx_reserve_index = 0; /* End of space claimed by producers */
+static volatile uint32_t tx_commit_count = 0;  /* Bytes fully copied in by producers */
+static volatile uint32_t tx_publish_index = 0; /* End of data released to the DMA */
+static volatile uint32_t tx_read_index = 0;    /* End of data already sent */
+static volatile uint16_t tx_dma_length = 0;    /* Length of the transfer in flight, 0 if idle */
+static volatile bool tx_paused = false;        /* Hold new transfers while the baud rate changes */
+static volatile TX_Overflow_Policy_t tx_policy = TX_POLICY_DROP;
+static HostPC_TX_Stats_t tx_stats;
+static SemaphoreHandle_t TX_Space_Semaphore;
 
 extern UART_HandleTypeDef huart2;
-QueueHandle_t Queue_hostPC_UART;
+StreamBufferHandle_t Stream_hostPC_UART;
+MessageBufferHandle_t Message_hostPC_Frames;
+
+static void Forward_RX_Chunk(uint16_t start, uint16_t end, BaseType_t *pxHigherPriorityTaskWoken);
+static void Forward_RX_Frame(BaseType_t *pxHigherPriorityTaskWoken);
+static void Frame_Timer_Init(void);
+static void Frame_Timer_Set_Baud_Rate(uint32_t baud);
+static bool TX_Enqueue(const uint8_t *data, size_t length);
+static bool TX_Reserve(uint32_t length, uint32_t *start);
+static void TX_Commit(uint32_t length);
+static void TX_Kick(void);
 
 /**
- * @brief Starts UART receive interrupt for Host PC UART
+ * @brief Starts circular DMA reception with idle-line detection for Host PC UART
  */
 void request_hostPC_read(void)
 {
-	HAL_UART_Receive_IT(&huart2, rx_buffer_hostPC, 1); /* Read 1 byte in interrupt mode */
+	rx_dma_read_index = 0;
+	HAL_UARTEx_ReceiveToIdle_DMA(&huart2, rx_dma_buffer_hostPC, RX_DMA_BUFFER_LENGTH);
 }
 
 /**
- * @brief UART RX Complete Callback
+ * @brief Forward a span of the DMA ring to the datalink stream buffer
+ *
+ * @param start First ring index of the span
+ * @param end One past the last ring index of the span
+ * @param pxHigherPriorityTaskWoken Set if the datalink task should run on ISR exit
  */
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+static void Forward_RX_Chunk(uint16_t start, uint16_t end, BaseType_t *pxHigherPriorityTaskWoken)
 {
-	BaseType_t xStatus = pdFAIL; /* status from queue operation */
+	size_t length = end - start;
+	size_t sent;
+
+	if (link_mode == HOSTPC_LINK_MODBUS)
+	{
+		/* Gather until the line goes idle */
+		if (rx_frame_length + length > RX_FRAME_LENGTH)
+		{
+			rx_frame_overflow = true;
+			return;
+		}
+		memcpy(&rx_frame[rx_frame_length], &rx_dma_buffer_hostPC[start], length);
+		rx_frame_length += length;
+		return;
+	}
 
-	/* Toggle onboard LED */
-	HAL_GPIO_TogglePin(LD2_GPIO_Port, LD2_Pin);
+	sent = xStreamBufferSendFromISR(Stream_hostPC_UART, &rx_dma_buffer_hostPC[start], length,
+										   pxHigherPriorityTaskWoken);
 
-	if (huart == &huart2)
+	if (sent < length)
+	{
+		/* Toggle onboard LED to indicate dropped RX data */
+		rx_dropped_bytes += length - sent;
+		HAL_GPIO_TogglePin(LD2_GPIO_Port, LD2_Pin);
+	}
+}
+
+/**
+ * @brief Hand the gathered frame to the Modbus server
+ *
+ * @param pxHigherPriorityTaskWoken Set if the Modbus task should run on ISR exit
+ */
+static void Forward_RX_Frame(BaseType_t *pxHigherPriorityTaskWoken)
+{
+	if (rx_frame_length > 0 && !rx_frame_overflow &&
+		xMessageBufferSendFromISR(Message_hostPC_Frames, rx_frame, rx_frame_length, pxHigherPriorityTaskWoken) == 0)
+	{
+		rx_dropped_bytes += rx_frame_length;
+	}
+	rx_frame_length = 0;
+	rx_frame_overflow = false;
+}
+
+/**
+ * @brief UART RX Event Callback
+ *
+ * Called on idle line, half transfer and transfer complete.
+ * Size is the current DMA write position within the ring.
+ */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	if (huart == &huart2 && Size != rx_dma_read_index)
 	{
-		/* Fill the queue one character at a time */
-		xStatus = xQueueSendToBackFromISR(Queue_hostPC_UART, rx_buffer_hostPC, 0);
+		if (Size > rx_dma_read_index)
+		{
+			/* Contiguous span */
+			Forward_RX_Chunk(rx_dma_read_index, Size, &xHigherPriorityTaskWoken);
+		}
+		else
+		{
+			/* Span wrapped around the end of the ring */
+			Forward_RX_Chunk(rx_dma_read_index, RX_DMA_BUFFER_LENGTH, &xHigherPriorityTaskWoken);
+			Forward_RX_Chunk(0, Size, &xHigherPriorityTaskWoken);
+		}
+
+		rx_dma_read_index = (Size == RX_DMA_BUFFER_LENGTH) ? 0 : Size;
+	}
+
+	/* An idle line may end a Modbus frame; time the rest of t3.5 */
+	if (huart == &huart2 && link_mode == HOSTPC_LINK_MODBUS && HAL_UARTEx_GetRxEventType(huart) == HAL_UART_RXEVENT_IDLE)
+	{
+		frame_idle_index = rx_dma_read_index;
+		__HAL_TIM_SET_AUTORELOAD(&htim5, frame_gap_us - 1);
+		__HAL_TIM_SET_COUNTER(&htim5, 0);
+		__HAL_TIM_ENABLE(&htim5);
+	}
+
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
 
-		/* Request next character */
+/**
+ * @brief UART Error Callback
+ *
+ * Overrun and DMA errors abort the reception, so restart it.
+ * Non-blocking errors (noise, framing) leave the DMA running.
+ */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+	if (huart == &huart2 && huart->RxState == HAL_UART_STATE_READY)
+	{
 		request_hostPC_read();
 	}
+}
+
+/**
+ * @brief Number of received bytes dropped because the datalink fell behind
+ */
+uint32_t HostPC_RX_Dropped_Bytes(void)
+{
+	return rx_dropped_bytes;
+}
+
+/**
+ * @brief Select how the Host PC link is used
+ *
+ * @param mode HOSTPC_LINK_CONSOLE for the console and binary command stream,
+ *             HOSTPC_LINK_MODBUS for Modbus RTU frames delimited by t3.5 of silence
+ */
+void HostPC_Set_Link_Mode(HostPC_Link_Mode_t mode)
+{
+	taskENTER_CRITICAL();
+	rx_frame_length = 0;
+	rx_frame_overflow = false;
+	link_mode = mode;
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Get the current Host PC link mode
+ */
+HostPC_Link_Mode_t HostPC_Get_Link_Mode(void)
+{
+	return link_mode;
+}
+
+/**
+ * @brief Create the kernel objects used by the Host PC transmit path
+ */
+void HostPC_TX_Init(void)
+{
+	TX_Space_Semaphore = xSemaphoreCreateBinary();
+}
+
+/**
+ * @brief Select what happens when the TX ring is full
+ *
+ * @param policy TX_POLICY_DROP discards the message, TX_POLICY_BLOCK waits up to
+ *               TX_BLOCK_TIMEOUT_MS for space (task context only)
+ */
+void HostPC_Set_TX_Policy(TX_Overflow_Policy_t policy)
+{
+	tx_policy = policy;
+}
+
+/**
+ * @brief Copy out the Host PC transmit counters
+ *
+ * Task context only; the counters are also updated from ISRs.
+ */
+void HostPC_Get_TX_Stats(HostPC_TX_Stats_t *stats)
+{
+	taskENTER_CRITICAL();
+	*stats = tx_stats;
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Queue bytes for transmission to the Host PC
+ *
+ * Safe from any task or ISR. Messages are either queued whole or dropped.
+ * Everything is dropped while the link is in Modbus mode.
+ *
+ * @param data Bytes to send
+ * @param length Number of bytes
+ * @return true if queued, false if dropped
+ */
+bool HostPC_Transmit(const uint8_t *data, size_t length)
+{
+	if (link_mode != HOSTPC_LINK_CONSOLE)
+	{
+		__atomic_add_fetch(&tx_stats.bytes_dropped, length, __ATOMIC_RELAXED);
+		return false;
+	}
+	return TX_Enqueue(data, length);
+}
 
-	if (xStatus == pdPASS)
+/**
+ * @brief Queue a Modbus reply for transmission to the Host PC
+ *
+ * @param data ADU to send
+ * @param length Number of bytes
+ * @return true if queued, false if dropped or not in Modbus mode
+ */
+bool HostPC_Transmit_Modbus(const uint8_t *data, size_t length)
+{
+	if (link_mode != HOSTPC_LINK_MODBUS)
 	{
-		/* Toggle onboard LED to indicate successful RX */
-		HAL_GPIO_TogglePin(LD2_GPIO_Port, LD2_Pin);
+		return false;
 	}
+	return TX_Enqueue(data, length);
+}
+
+/**
+ * @brief Copy bytes into the TX ring and start the DMA if idle
+ */
+static bool TX_Enqueue(const uint8_t *data, size_t length)
+{
+	uint32_t start;
+	uint32_t offset;
+	uint32_t first;
+
+	if (length == 0)
+	{
+		return true;
+	}
+
+	while (length > TX_RING_LENGTH || !TX_Reserve(length, &start))
+	{
+		/* Only tasks may wait, and only for a message that can ever fit */
+		if (length > TX_RING_LENGTH || tx_policy != TX_POLICY_BLOCK || xPortIsInsideInterrupt() ||
+			xTaskGetSchedulerState() != taskSCHEDULER_RUNNING ||
+			xSemaphoreTake(TX_Space_Semaphore, pdMS_TO_TICKS(TX_BLOCK_TIMEOUT_MS)) != pdTRUE)
+		{
+			__atomic_add_fetch(&tx_stats.bytes_dropped, length, __ATOMIC_RELAXED);
+			__atomic_add_fetch(&tx_stats.overflow_events, 1, __ATOMIC_RELAXED);
+			return false;
+		}
+	}
+
+	/* Copy into the claimed region, splitting at the end of the ring */
+	offset = start & TX_RING_MASK;
+	first = TX_RING_LENGTH - offset;
+	if (first >= length)
+	{
+		memcpy(&tx_ring[offset], data, length);
+	}
+	else
+	{
+		memcpy(&tx_ring[offset], data, first);
+		memcpy(tx_ring, data + first, length - first);
+	}
+
+	TX_Commit(length);
+	return true;
+}
+
+/**
+ * @brief Claim length bytes of ring space
+ *
+ * @param length Bytes to claim
+ * @param start Set to the free-running index of the claimed region
+ * @return false if the ring does not have enough free space
+ */
+static bool TX_Reserve(uint32_t length, uint32_t *start)
+{
+	uint32_t head = __atomic_load_n(&tx_reserve_index, __ATOMIC_RELAXED);
+	uint32_t used;
+
+	do
+	{
+		used = head - __atomic_load_n(&tx_read_index, __ATOMIC_ACQUIRE);
+		if (used + length > TX_RING_LENGTH)
+		{
+			return false;
+		}
+	} while (!__atomic_compare_exchange_n(&tx_reserve_index, &head, head + length, true,
+										  __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+	if (used + length > tx_stats.high_water)
+	{
+		tx_stats.high_water = used + length; /* Racy but monotonic enough for a statistic */
+	}
+	*start = head;
+	return true;
+}
+
+/**
+ * @brief Mark length bytes as written and publish them once all earlier claims are complete
+ */
+static void TX_Commit(uint32_t length)
+{
+	uint32_t committed = __atomic_add_fetch(&tx_commit_count, length, __ATOMIC_RELEASE);
+	uint32_t published;
+
+	__atomic_add_fetch(&tx_stats.bytes_queued, length, __ATOMIC_RELAXED);
+
+	/* Commits can finish out of order; only the producer that completes every
+	 * outstanding claim may move the publish index forward. */
+	if (committed != __atomic_load_n(&tx_reserve_index, __ATOMIC_ACQUIRE))
+	{
+		return;
+	}
+
+	published = __atomic_load_n(&tx_publish_index, __ATOMIC_RELAXED);
+	while ((int32_t)(committed - published) > 0 &&
+		   !__atomic_compare_exchange_n(&tx_publish_index, &published, committed, true,
+										__ATOMIC_RELEASE, __ATOMIC_RELAXED))
+	{
+	}
+
+	TX_Kick();
+}
+
+/**
+ * @brief Start a DMA transfer of published data if the channel is idle
+ *
+ * Runs from both task and ISR context, so the check-and-start is masked
+ * against the DMA completion interrupt.
+ */
+static void TX_Kick(void)
+{
+	UBaseType_t saved_mask = taskENTER_CRITICAL_FROM_ISR();
+
+	if (tx_dma_length == 0 && !tx_paused)
+	{
+		uint32_t read = tx_read_index;
+		uint32_t pending = tx_publish_index - read;
+		uint32_t offset = read & TX_RING_MASK;
+
+		if (pending > 0)
+		{
+			/* Send up to the end of the ring; the remainder follows on completion */
+			if (pending > TX_RING_LENGTH - offset)
+			{
+				pending = TX_RING_LENGTH - offset;
+			}
+			tx_dma_length = pending;
+			if (HAL_UART_Transmit_DMA(&huart2, &tx_ring[offset], pending) != HAL_OK)
+			{
+				tx_dma_length = 0;
+			}
+		}
+	}
+
+	taskEXIT_CRITICAL_FROM_ISR(saved_mask);
+}
+
+/**
+ * @brief UART TX Complete Callback
+ *
+ * Releases the sent region and chains the next transfer.
+ */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	if (huart == &huart2)
+	{
+		__atomic_add_fetch(&tx_read_index, tx_dma_length, __ATOMIC_RELEASE);
+		tx_dma_length = 0;
+		TX_Kick();
+
+		if (TX_Space_Semaphore != NULL)
+		{
+			xSemaphoreGiveFromISR(TX_Space_Semaphore, &xHigherPriorityTaskWoken);
+		}
+	}
+
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/**
+ * @brief Check that every queued byte has left the wire
+ */
+bool HostPC_TX_Idle(void)
+{
+	return tx_dma_length == 0 && tx_read_index == tx_publish_index && __HAL_UART_GET_FLAG(&huart2, UART_FLAG_TC);
+}
+
+/**
+ * @brief Highest baud rate the Host PC UART can generate from its kernel clock
+ */
+uint32_t HostPC_Max_Baud_Rate(void)
+{
+	uint32_t oversampling = (huart2.Init.OverSampling == UART_OVERSAMPLING_8) ? 8 : 16;
+	return HAL_RCC_GetPCLK1Freq() / oversampling;
+}
+
+/**
+ * @brief Check that a baud rate can be generated within tolerance
+ *
+ * @param baud Requested rate
+ * @return true if the divider error is within BAUD_RATE_TOLERANCE_PERCENT
+ */
+bool HostPC_Baud_Rate_Valid(uint32_t baud)
+{
+	uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+	uint32_t brr;
+	uint32_t divider;
+	uint32_t actual;
+
+	if (baud < BAUD_RATE_MIN || baud > HostPC_Max_Baud_Rate())
+	{
+		return false;
+	}
+
+	/* Same divider the HAL will program, as PCLK1 cycles per bit */
+	if (huart2.Init.OverSampling == UART_OVERSAMPLING_8)
+	{
+		brr = UART_BRR_SAMPLING8(pclk, baud);
+		divider = ((brr >> 4) << 3) | (brr & 0x7);
+	}
+	else
+	{
+		divider = UART_BRR_SAMPLING16(pclk, baud);
+	}
+	actual = pclk / divider;
+
+	return ((actual > baud) ? actual - baud : baud - actual) * 100ULL <= (uint64_t)baud * BAUD_RATE_TOLERANCE_PERCENT;
+}
+
+/**
+ * @brief Reprogram the Host PC UART baud rate
+ *
+ * Waits for the transfer in flight and the last stop bit, holds further
+ * transmissions, reinitialises the UART and restarts reception. Bytes still
+ * queued go out at the new rate. Task context only.
+ *
+ * @param baud New rate, checked with HostPC_Baud_Rate_Valid
+ * @return false if the HAL rejected the configuration
+ */
+bool HostPC_Set_Baud_Rate(uint32_t baud)
+{
+	bool paused = false;
+	bool ok;
+
+	/* Pause at a point where no DMA transfer is running */
+	while (!paused)
+	{
+		taskENTER_CRITICAL();
+		if (tx_dma_length == 0)
+		{
+			tx_paused = true;
+			paused = true;
+		}
+		taskEXIT_CRITICAL();
+		if (!paused)
+		{
+			vTaskDelay(1);
+		}
+	}
+	while (!__HAL_UART_GET_FLAG(&huart2, UART_FLAG_TC))
+	{
+		/* At most one character time */
+	}
+
+	HAL_UART_AbortReceive(&huart2);
+	huart2.Init.BaudRate = baud;
+	ok = (HAL_UART_Init(&huart2) == HAL_OK);
+	Frame_Timer_Set_Baud_Rate(baud);
+	request_hostPC_read();
+
+	tx_paused = false;
+	TX_Kick();
+	return ok;
 }
 
 /*
@@ -61,8 +551,71 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
  */
 void HostPC_RX_Task(void *pvParameters)
 {
-
+	Frame_Timer_Init();
 	request_hostPC_read(); /* Start the first read */
 	vTaskDelete(NULL);	   /* Delete this task as it is no longer needed */
 	UNUSED(pvParameters);
 }
+
+/**
+ * @brief Set up TIM5 as a one-shot timer for the end of Modbus frames
+ */
+static void Frame_Timer_Init(void)
+{
+	HAL_StatusTypeDef status;
+
+	/* TIM5 is clocked from APB1 timers @ 84 MHz; APB1 is divided by 2 so timers run at HCLK */
+	__HAL_RCC_TIM5_CLK_ENABLE();
+	htim5.Instance = TIM5;
+	htim5.Init.Prescaler = (SystemCoreClock / FRAME_TIMER_COUNTER_HZ) - 1;
+	htim5.Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim5.Init.Period = MODBUS_FIXED_T35_US - 1;
+	htim5.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+	htim5.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+	status = HAL_TIM_OnePulse_Init(&htim5, TIM_OPMODE_SINGLE);
+	configASSERT(status == HAL_OK);
+	Frame_Timer_Set_Baud_Rate(huart2.Init.BaudRate);
+
+	/* Same priority as the USART and its DMA, so the frame is never touched from two interrupts at once */
+	__HAL_TIM_CLEAR_FLAG(&htim5, TIM_FLAG_UPDATE);
+	__HAL_TIM_ENABLE_IT(&htim5, TIM_IT_UPDATE);
+	HAL_NVIC_SetPriority(TIM5_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, 0);
+	HAL_NVIC_EnableIRQ(TIM5_IRQn);
+}
+
+/**
+ * @brief Work out the silence that must follow the idle event to make up t3.5
+ *
+ * t3.5 is 3.5 character times up to MODBUS_FIXED_T35_BAUD and 1750 us above it.
+ * The idle event itself comes one character time into the silence.
+ */
+static void Frame_Timer_Set_Baud_Rate(uint32_t baud)
+{
+	uint32_t character_us = (MODBUS_CHARACTER_BITS * FRAME_TIMER_COUNTER_HZ + baud - 1) / baud;
+	uint32_t t35_us = (baud > MODBUS_FIXED_T35_BAUD) ? MODBUS_FIXED_T35_US : (7 * character_us + 1) / 2;
+
+	frame_gap_us = t35_us - character_us;
+}
+
+/**
+ * @brief TIM5 global interrupt, t3.5 after the last received character
+ *
+ * Bytes received since the idle event mean the frame is still arriving; its
+ * next idle event restarts the timer.
+ */
+void TIM5_IRQHandler(void)
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+	uint16_t write_index;
+
+	if (__HAL_TIM_GET_FLAG(&htim5, TIM_FLAG_UPDATE) != RESET)
+	{
+		__HAL_TIM_CLEAR_IT(&htim5, TIM_IT_UPDATE);
+		write_index = (RX_DMA_BUFFER_LENGTH - __HAL_DMA_GET_COUNTER(huart2.hdmarx)) % RX_DMA_BUFFER_LENGTH;
+		if (link_mode == HOSTPC_LINK_MODBUS && write_index == frame_idle_index)
+		{
+			Forward_RX_Frame(&xHigherPriorityTaskWoken);
+		}
+	}
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
@@ -1,97 +1,341 @@
 /**
  * @file Ultrasonic_Driver.c
  *
- * @brief Sends periodic trigger pulses to ultrasonic sensors and measures echo pulse durations.
+ * @brief Sends trigger pulses to ultrasonic sensors and measures echo pulse durations.
+ *
+ * Sensors are described by a static table of trigger and capture timer channels.
+ * Each capture timer resets on the echo's rising edge, so the falling edge capture
+ * is the pulse width. Sensors are pinged in groups: sensors in the same group
+ * cannot hear each other and ping together, and groups take turns so that
+ * sensors which could hear each other never ping at once.
+ *
+ * The echo capture interrupt converts the pulse width to a distance itself and
+ * publishes it, with the DWT cycle count of the falling edge, to the sensor's
+ * mailbox guarded by a sequence counter (odd while being written). Readers copy
+ * the freshest sample without blocking and retry if a write overlapped their
+ * copy. A ping that gets no echo publishes a sample flagged as a timeout, so
+ * missed samples are visible to consumers. One task per sensor may register to
+ * be notified of each new sample.
+ *
+ * Pings are paced by the echoes: each group is pinged a short, range-dependent
+ * guard time after the previous group's echoes, rather than on a fixed period.
  */
 
 /* Module Header */
 #include "L1/Ultrasonic_Driver.h"
 
 /* Standard Libraries */
-#include <stdio.h>
 
 /* User Libraries */
 #include "user_main.h"
+#include "L1/Cycle_Counter.h"
 
-#define ULTRASONIC_READ_TIMEOUT_MS 60
-#define ULTRASONIC_SENSOR_PERIOD_MS 30
+#define ULTRASONIC_SENSOR_PERIOD_MS 30 /* Echo timeout, and the ping period when no echo returns */
+#define ULTRASONIC_GUARD_MIN_MS 4      /* Settling time after the shortest echoes */
+#define ULTRASONIC_GUARD_ROUND_TRIPS 10 /* Reverberations allowed to die away after an echo */
 #define SPEED_OF_SOUND_UM_PER_US 343
 #define UM_PER_MM 1000
+#define US_PER_S 1000000
 
 extern TIM_HandleTypeDef htim2;
 extern TIM_HandleTypeDef htim3;
-QueueHandle_t Raw_Ultrasonic_Queue;
-static SemaphoreHandle_t Ultrasonic_Echo_Semaphore;
+
+typedef struct
+{
+    TIM_HandleTypeDef *trigger_timer; /* One-pulse timer driving the trigger pin */
+    uint32_t trigger_channel;
+    TIM_HandleTypeDef *capture_timer; /* Slave reset on the echo's rising edge */
+    uint32_t rising_channel;          /* Direct capture of the echo input */
+    uint32_t falling_channel;         /* Indirect capture, holds the pulse width */
+    HAL_TIM_ActiveChannel falling_active_channel;
+    uint8_t group; /* Below ULTRASONIC_SENSOR_COUNT; sensors in a group ping together, groups take turns */
+} Ultrasonic_Sensor_Config_t;
+
+/* Latest-sample mailbox, written by the capture interrupt, or by the read task with it masked */
+typedef struct
+{
+    volatile uint32_t sequence;
+    volatile uint32_t distance_mm;
+    volatile uint32_t timestamp_cycles;
+    volatile uint32_t round_trip_us;
+    volatile uint8_t flags;
+} Ultrasonic_Mailbox_t;
+
+static const Ultrasonic_Sensor_Config_t sensor_table[ULTRASONIC_SENSOR_COUNT] = {
+    [ULTRASONIC_VERTICAL] = {
+        .trigger_timer = &htim2,
+        .trigger_channel = TIM_CHANNEL_1,
+        .capture_timer = &htim3,
+        .rising_channel = TIM_CHANNEL_1,
+        .falling_channel = TIM_CHANNEL_2,
+        .falling_active_channel = HAL_TIM_ACTIVE_CHANNEL_2,
+        .group = 0,
+    },
+};
+
+_Static_assert(ULTRASONIC_SENSOR_COUNT <= 32, "Group masks hold one bit per sensor");
+
+static Ultrasonic_Mailbox_t mailboxes[ULTRASONIC_SENSOR_COUNT];
+static TaskHandle_t sample_consumers[ULTRASONIC_SENSOR_COUNT];
+static volatile uint32_t echo_timeouts[ULTRASONIC_SENSOR_COUNT];
+static TaskHandle_t read_task = NULL;
+
+static uint32_t Ping_Group(uint32_t group_mask);
+static TickType_t Guard_Time(uint32_t round_trip_us);
+static void Mailbox_Publish(Ultrasonic_Mailbox_t *mailbox, uint32_t round_trip_us, uint32_t timestamp_cycles,
+                            uint8_t flags);
 
 /**
- * @brief Task to send trigger pulses and measure echo durations from ultrasonic sensors.
+ * @brief Task to send trigger pulses to the ultrasonic sensors.
  *
- * Sends a trigger pulse every 100 ms and measures the echo pulse duration using input capture.
- * The measured duration is sent to a queue for further processing.
+ * Each group is pinged as soon as the previous group's echoes have been
+ * captured and a guard time has passed for their reverberations to die away.
+ * The guard grows with the longest echo round trip in the group. A sensor whose
+ * echo does not arrive within ULTRASONIC_SENSOR_PERIOD_MS is stopped and
+ * counted as a timeout, and the next group follows straight away.
  */
 void Ultrasonic_Read_Task(void *pvParameters)
 {
-    uint32_t pulse_width_us;
-    uint32_t distance_mm;
+    uint32_t group_masks[ULTRASONIC_SENSOR_COUNT] = {0};
+    uint32_t echoed;
+    uint32_t round_trip_us;
 
-    /* Create semaphore for echo pulse synchronization */
-    Ultrasonic_Echo_Semaphore = xSemaphoreCreateBinary();
+    read_task = xTaskGetCurrentTaskHandle();
 
-    /* Prepare Trigger Timer */
-    HAL_TIM_PWM_Start(&htim2, TIM_CHANNEL_1);
+    for (uint8_t sensor = 0; sensor < ULTRASONIC_SENSOR_COUNT; sensor++)
+    {
+        /* At most one group per sensor, so group numbers index group_masks */
+        configASSERT(sensor_table[sensor].group < ULTRASONIC_SENSOR_COUNT);
+        group_masks[sensor_table[sensor].group] |= 1u << sensor;
+
+        /* Prepare Trigger Timer */
+        HAL_TIM_PWM_Start(sensor_table[sensor].trigger_timer, sensor_table[sensor].trigger_channel);
+    }
 
     while (true)
     {
-        /* Get Wake Time */
-        TickType_t xLastWakeTime = xTaskGetTickCount();
-        xSemaphoreTake(Ultrasonic_Echo_Semaphore, 0); /* Clear Semaphore */
-        /* Reset Echo Timer */
-        HAL_TIM_PWM_Start_IT(&htim3, TIM_CHANNEL_1);
-        HAL_TIM_IC_Start_IT(&htim3, TIM_CHANNEL_2);
-
-        /* Generate trigger pulse */
-        __HAL_TIM_ENABLE(&htim2);
-
-        /* Wait for echo pulse to be captured - 60 ms timeout */
-        if (xSemaphoreTake(Ultrasonic_Echo_Semaphore, pdMS_TO_TICKS(ULTRASONIC_READ_TIMEOUT_MS)) == pdTRUE)
+        for (uint8_t group = 0; group < ULTRASONIC_SENSOR_COUNT; group++)
         {
-            /* Read captured pulse width in timer ticks (1 tick = 1 us) */
-            pulse_width_us = HAL_TIM_ReadCapturedValue(&htim3, TIM_CHANNEL_2);
+            if (group_masks[group] == 0)
+            {
+                continue;
+            }
 
-            /* Convert pulse width to distance in mm using integer math */
-            /* distance_mm = pulse_width_us * speed_of_sound_mm_per_us / 2 */
-            /* speed_of_sound ≈ 0.343 mm/us → multiply by 343 and divide by 1000 for mm */
-            distance_mm = (pulse_width_us * SPEED_OF_SOUND_UM_PER_US) / UM_PER_MM / 2; /* Divide by 2 for round trip */
+            echoed = Ping_Group(group_masks[group]);
 
-            /* Send distance to queue */
-            xQueueSend(Raw_Ultrasonic_Queue, &distance_mm, portMAX_DELAY);
+            round_trip_us = 0;
+            for (uint8_t sensor = 0; sensor < ULTRASONIC_SENSOR_COUNT; sensor++)
+            {
+                if ((echoed & (1u << sensor)) && mailboxes[sensor].round_trip_us > round_trip_us)
+                {
+                    round_trip_us = mailboxes[sensor].round_trip_us;
+                }
+            }
+            if (echoed != 0)
+            {
+                vTaskDelay(Guard_Time(round_trip_us));
+            }
         }
-        else
+    }
+    UNUSED(pvParameters);
+}
+
+/**
+ * @brief Ping every sensor in a group and wait for their echoes.
+ *
+ * @param group_mask Bit per sensor to ping
+ * @return Bit per sensor whose echo was captured
+ */
+static uint32_t Ping_Group(uint32_t group_mask)
+{
+    const TickType_t start = xTaskGetTickCount();
+    const TickType_t timeout = pdMS_TO_TICKS(ULTRASONIC_SENSOR_PERIOD_MS);
+    uint32_t echoed = 0;
+    uint32_t notified;
+    TickType_t elapsed;
+
+    /* Discard echo notifications that arrived after their timeout */
+    xTaskNotifyWait(0, UINT32_MAX, NULL, 0);
+
+    for (uint8_t sensor = 0; sensor < ULTRASONIC_SENSOR_COUNT; sensor++)
+    {
+        const Ultrasonic_Sensor_Config_t *config = &sensor_table[sensor];
+
+        if (group_mask & (1u << sensor))
+        {
+            /* Reset Echo Timer */
+            HAL_TIM_IC_Start(config->capture_timer, config->rising_channel);
+            HAL_TIM_IC_Start_IT(config->capture_timer, config->falling_channel);
+
+            /* Generate trigger pulse */
+            __HAL_TIM_ENABLE(config->trigger_timer);
+        }
+    }
+
+    while (echoed != group_mask)
+    {
+        elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout || xTaskNotifyWait(0, UINT32_MAX, &notified, timeout - elapsed) != pdTRUE)
+        {
+            break;
+        }
+        echoed |= notified & group_mask;
+    }
+
+    for (uint8_t sensor = 0; sensor < ULTRASONIC_SENSOR_COUNT; sensor++)
+    {
+        const Ultrasonic_Sensor_Config_t *config = &sensor_table[sensor];
+
+        if ((group_mask & ~echoed) & (1u << sensor))
         {
             /* Timeout waiting for echo pulse */
-            HAL_TIM_IC_Stop_IT(&htim3, TIM_CHANNEL_1);
-            HAL_TIM_IC_Stop_IT(&htim3, TIM_CHANNEL_2);
+            HAL_TIM_IC_Stop(config->capture_timer, config->rising_channel);
+            HAL_TIM_IC_Stop_IT(config->capture_timer, config->falling_channel);
+            echo_timeouts[sensor]++;
+
+            /* Masking the capture interrupt keeps the mailbox single-writer */
+            taskENTER_CRITICAL();
+            Mailbox_Publish(&mailboxes[sensor], 0, Cycle_Counter_Now(), ULTRASONIC_SAMPLE_TIMEOUT);
+            taskEXIT_CRITICAL();
+            if (sample_consumers[sensor] != NULL)
+            {
+                xTaskNotifyGive(sample_consumers[sensor]);
+            }
         }
+    }
+    return echoed;
+}
 
-        /* Wait for next sample period */
-        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(ULTRASONIC_SENSOR_PERIOD_MS));
-        UNUSED(pvParameters);
+/**
+ * @brief Copy the freshest sample from a sensor without blocking.
+ *
+ * @param sensor Sensor to read
+ * @param sample Filled with the latest sample
+ * @return false if no ping has completed yet
+ */
+bool Ultrasonic_Read_Latest(Ultrasonic_Sensor_t sensor, Ultrasonic_Sample_t *sample)
+{
+    const Ultrasonic_Mailbox_t *mailbox = &mailboxes[sensor];
+    uint32_t before;
+    uint32_t after;
+
+    do
+    {
+        before = mailbox->sequence;
+        __DMB();
+        sample->distance_mm = mailbox->distance_mm;
+        sample->timestamp_cycles = mailbox->timestamp_cycles;
+        sample->echo_us = mailbox->round_trip_us;
+        sample->flags = mailbox->flags;
+        __DMB();
+        after = mailbox->sequence;
+    } while (before != after || (before & 1));
+
+    sample->sequence = before / 2;
+    return before != 0;
+}
+
+/**
+ * @brief Register the task to notify of each new sample from a sensor.
+ *
+ * @param sensor Sensor to follow
+ * @param task Task woken with a notification give, NULL for none
+ */
+void Ultrasonic_Set_Consumer(Ultrasonic_Sensor_t sensor, TaskHandle_t task)
+{
+    sample_consumers[sensor] = task;
+}
+
+/**
+ * @brief Number of trigger pulses to a sensor that got no echo in time
+ */
+uint32_t Ultrasonic_Echo_Timeouts(Ultrasonic_Sensor_t sensor)
+{
+    return echo_timeouts[sensor];
+}
+
+/**
+ * @brief Time to wait after an echo before the next ping.
+ *
+ * @param round_trip_us Echo pulse width of the last ping
+ * @return Guard time in ticks, at most ULTRASONIC_SENSOR_PERIOD_MS
+ */
+static TickType_t Guard_Time(uint32_t round_trip_us)
+{
+    uint32_t guard_ms = (round_trip_us * ULTRASONIC_GUARD_ROUND_TRIPS + 999) / 1000;
+
+    if (guard_ms < ULTRASONIC_GUARD_MIN_MS)
+    {
+        guard_ms = ULTRASONIC_GUARD_MIN_MS;
     }
+    else if (guard_ms > ULTRASONIC_SENSOR_PERIOD_MS)
+    {
+        guard_ms = ULTRASONIC_SENSOR_PERIOD_MS;
+    }
+    return pdMS_TO_TICKS(guard_ms);
+}
+
+/**
+ * @brief Publish a sample to a mailbox. Capture interrupt, or with it masked.
+ */
+static void Mailbox_Publish(Ultrasonic_Mailbox_t *mailbox, uint32_t round_trip_us, uint32_t timestamp_cycles,
+                            uint8_t flags)
+{
+    uint32_t sequence = mailbox->sequence;
+
+    mailbox->sequence = sequence + 1; /* Odd: write in progress */
+    __DMB();
+    /* Convert pulse width to distance in mm using integer math */
+    /* speed_of_sound ≈ 0.343 mm/us → multiply by 343 and divide by 1000 for mm */
+    mailbox->distance_mm = (round_trip_us * SPEED_OF_SOUND_UM_PER_US) / UM_PER_MM / 2; /* Divide by 2 for round trip */
+    mailbox->timestamp_cycles = timestamp_cycles;
+    mailbox->round_trip_us = round_trip_us;
+    mailbox->flags = flags;
+    __DMB();
+    mailbox->sequence = sequence + 2;
 }
 
 /**
  * @brief Callback for input capture event on echo pulse.
  *
- * This function is called by the HAL library when an input capture event occurs.
- * It gives the semaphore to unblock the ultrasonic read task.
+ * The counter is reset on the rising edge, so the falling edge capture is the
+ * echo pulse width in microseconds. The counter has run on since the falling
+ * edge, which dates the edge against the cycle counter despite interrupt latency.
  *
  * @param htim Pointer to the TIM handle.
  */
 void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim)
 {
-    if (htim->Instance == TIM3)
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint32_t now_cycles = Cycle_Counter_Now();
+    uint32_t pulse_width_us;
+    uint32_t since_edge_us;
+
+    for (uint8_t sensor = 0; sensor < ULTRASONIC_SENSOR_COUNT; sensor++)
     {
-        /* Give semaphore to unblock ultrasonic read task */
-        xSemaphoreGiveFromISR(Ultrasonic_Echo_Semaphore, NULL);
+        const Ultrasonic_Sensor_Config_t *config = &sensor_table[sensor];
+
+        if (htim->Instance != config->capture_timer->Instance || htim->Channel != config->falling_active_channel)
+        {
+            continue;
+        }
+
+        /* Read captured pulse width in timer ticks (1 tick = 1 us) */
+        pulse_width_us = HAL_TIM_ReadCapturedValue(htim, config->falling_channel);
+        since_edge_us = __HAL_TIM_GET_COUNTER(htim) - pulse_width_us;
+
+        Mailbox_Publish(&mailboxes[sensor], pulse_width_us,
+                        now_cycles - since_edge_us * (SystemCoreClock / US_PER_S), ULTRASONIC_SAMPLE_VALID);
+
+        if (read_task != NULL)
+        {
+            xTaskNotifyFromISR(read_task, 1u << sensor, eSetBits, &xHigherPriorityTaskWoken);
+        }
+        if (sample_consumers[sensor] != NULL)
+        {
+            vTaskNotifyGiveFromISR(sample_consumers[sensor], &xHigherPriorityTaskWoken);
+        }
     }
-}
\ No newline at end of file
+
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
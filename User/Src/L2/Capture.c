@@ -0,0 +1,223 @@
+/**
+ * @file Capture.c
+ *
+ * @brief Records every control cycle into RAM for offline tuning on the Host PC.
+ *
+ * While armed, the control loop's records run through a ring holding the last
+ * CAPTURE_PRETRIGGER cycles. The trigger event fills the rest of the buffer and
+ * then stops recording, so a step response is held from just before the step to
+ * several seconds after it at the full sample rate.
+ *
+ * A dump sends a Capture_Header_t frame followed by the records, oldest first,
+ * in frames of CAPTURE_RECORDS_PER_FRAME behind a uint16 index of the first. The
+ * task waits for space on the TX ring rather than dropping frames.
+ */
+
+/* Module Header */
+#include "L2/Capture.h"
+
+/* Standard Libraries */
+#include <string.h>
+
+/* User Libraries */
+#include "user_main.h"
+#include "L2/Comm_Datalink.h"
+
+#define CAPTURE_RECORDS_PER_FRAME ((DATALINK_MAX_PAYLOAD - sizeof(uint16_t)) / sizeof(Capture_Record_t))
+#define CAPTURE_TX_RETRY_MS 2
+
+typedef enum
+{
+    CAPTURE_IDLE, /* Holding the last capture, if any */
+    CAPTURE_ARMED,
+    CAPTURE_RECORDING,
+    CAPTURE_DUMPING
+} Capture_State_t;
+
+typedef struct __attribute__((packed))
+{
+    uint16_t first_index;
+    Capture_Record_t records[CAPTURE_RECORDS_PER_FRAME];
+} Capture_Frame_t;
+
+_Static_assert(CAPTURE_PRETRIGGER < CAPTURE_LENGTH, "Pre-trigger must leave room after the trigger");
+_Static_assert(CAPTURE_LENGTH < CAPTURE_NOT_TRIGGERED, "Capture length exceeds the header index");
+_Static_assert(sizeof(Capture_Frame_t) <= DATALINK_MAX_PAYLOAD, "Capture frame exceeds frame payload");
+
+static Capture_Record_t capture_buffer[CAPTURE_LENGTH];
+static uint16_t capture_head = 0;  /* Next record written */
+static uint16_t capture_count = 0; /* Records held */
+static uint16_t capture_after_trigger = 0;
+static uint16_t capture_remaining = 0; /* Records still to record after the trigger */
+static bool capture_triggered = false;
+static Capture_Trigger_t capture_trigger = CAPTURE_TRIGGER_OFF;
+static volatile Capture_State_t capture_state = CAPTURE_IDLE;
+static TaskHandle_t capture_task = NULL;
+
+static void Send_Frame_Waiting(uint8_t opcode, const void *payload, size_t length);
+
+/**
+ * @brief Task to dump the capture buffer to the Host PC on request.
+ */
+void Capture_Task(void *pvParameters)
+{
+    Capture_Header_t header;
+    Capture_Frame_t frame;
+    uint16_t oldest;
+    uint16_t count;
+
+    capture_task = xTaskGetCurrentTaskHandle();
+
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        /* Recording is stopped while dumping, so the buffer is stable */
+        count = capture_count;
+        oldest = (uint16_t)((capture_head + CAPTURE_LENGTH - count) % CAPTURE_LENGTH);
+
+        header.record_count = count;
+        header.trigger_index = capture_triggered ? (uint16_t)(count - capture_after_trigger) : CAPTURE_NOT_TRIGGERED;
+        header.cycles_per_second = SystemCoreClock;
+        header.record_size = sizeof(Capture_Record_t);
+        Send_Frame_Waiting(CAPTURE_OPCODE_HEADER, &header, sizeof(header));
+
+        for (uint16_t index = 0; index < count; index += CAPTURE_RECORDS_PER_FRAME)
+        {
+            uint16_t records = count - index;
+
+            if (records > CAPTURE_RECORDS_PER_FRAME)
+            {
+                records = CAPTURE_RECORDS_PER_FRAME;
+            }
+            frame.first_index = index;
+            for (uint16_t i = 0; i < records; i++)
+            {
+                frame.records[i] = capture_buffer[(oldest + index + i) % CAPTURE_LENGTH];
+            }
+            Send_Frame_Waiting(CAPTURE_OPCODE_RECORDS, &frame,
+                               sizeof(frame.first_index) + records * sizeof(Capture_Record_t));
+        }
+
+        capture_state = CAPTURE_IDLE;
+    }
+    UNUSED(pvParameters);
+}
+
+/**
+ * @brief Frame a message to the Host PC, waiting while the TX ring is full.
+ */
+static void Send_Frame_Waiting(uint8_t opcode, const void *payload, size_t length)
+{
+    while (!Datalink_Send_Frame(opcode, payload, length))
+    {
+        vTaskDelay(pdMS_TO_TICKS(CAPTURE_TX_RETRY_MS));
+    }
+}
+
+/**
+ * @brief Add a control cycle to the capture if one is armed or recording.
+ *
+ * Called by the control loop every cycle; never blocks.
+ *
+ * @param record Record for the current control cycle
+ */
+void Capture_Record(const Capture_Record_t *record)
+{
+    taskENTER_CRITICAL();
+    if (capture_state == CAPTURE_ARMED || capture_state == CAPTURE_RECORDING)
+    {
+        capture_buffer[capture_head] = *record;
+        capture_head = (uint16_t)((capture_head + 1) % CAPTURE_LENGTH);
+        if (capture_count < CAPTURE_LENGTH)
+        {
+            capture_count++;
+        }
+
+        if (capture_state == CAPTURE_RECORDING)
+        {
+            capture_after_trigger++;
+            if (--capture_remaining == 0)
+            {
+                capture_state = CAPTURE_IDLE;
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Start a new capture, discarding the last one.
+ *
+ * @param trigger Event that starts recording; CAPTURE_TRIGGER_OFF stops the
+ *                current capture and keeps what it holds
+ */
+void Capture_Arm(Capture_Trigger_t trigger)
+{
+    taskENTER_CRITICAL();
+    if (capture_state != CAPTURE_DUMPING)
+    {
+        if (trigger == CAPTURE_TRIGGER_OFF)
+        {
+            capture_state = CAPTURE_IDLE;
+        }
+        else
+        {
+            capture_head = 0;
+            capture_count = 0;
+            capture_after_trigger = 0;
+            capture_triggered = false;
+            capture_trigger = trigger;
+            capture_state = CAPTURE_ARMED;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    if (trigger == CAPTURE_TRIGGER_NOW)
+    {
+        Capture_Trigger(CAPTURE_TRIGGER_NOW);
+    }
+}
+
+/**
+ * @brief Report an event that may start an armed capture.
+ *
+ * @param event Event that occurred
+ */
+void Capture_Trigger(Capture_Trigger_t event)
+{
+    taskENTER_CRITICAL();
+    if (capture_state == CAPTURE_ARMED && event == capture_trigger)
+    {
+        uint16_t before = (capture_count < CAPTURE_PRETRIGGER) ? capture_count : CAPTURE_PRETRIGGER;
+
+        capture_remaining = CAPTURE_LENGTH - before;
+        capture_triggered = true;
+        capture_state = CAPTURE_RECORDING;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Send the held capture to the Host PC.
+ *
+ * @return false if a capture is armed, recording or already being sent
+ */
+bool Capture_Start_Dump(void)
+{
+    bool started = false;
+
+    taskENTER_CRITICAL();
+    if (capture_state == CAPTURE_IDLE && capture_task != NULL)
+    {
+        capture_state = CAPTURE_DUMPING;
+        started = true;
+    }
+    taskEXIT_CRITICAL();
+
+    if (started)
+    {
+        xTaskNotifyGive(capture_task);
+    }
+    return started;
+}
@@ -2,7 +2,20 @@
  * @file Comm_Datalink.c
  *
  * @brief Tokenizes incoming UART data from Host PC into commands and arguments.
- * TODO: Packages system data into strings for transmission back to Host PC.
+ * Frames outgoing binary data for transmission back to Host PC.
+ *
+ * Received bytes are read straight from the RX stream buffer into the line buffer
+ * of a pooled message. Tokens are split in place and referenced by pointer, and
+ * the message itself is passed to the dispatcher by pointer and returned to the
+ * pool once handled.
+ *
+ * The same link also accepts binary frames: COBS-encoded, 0x00-delimited, with an
+ * opcode, fixed-width little-endian payload and CRC-16/CCITT-FALSE trailer.
+ * Outgoing frames use the same layout, with opcodes 0x80 and above.
+ *
+ * Either format may carry a sequence number for the dispatcher to acknowledge:
+ * a leading "#<n>" token on a console line, or FRAME_SEQUENCE_FLAG on the opcode
+ * followed by a uint16 on a binary frame.
  */
 
 /* Module Header */
@@ -11,80 +24,379 @@
 /* Standard Libraries */
 #include <string.h>
 #include <ctype.h>
+#include <stdlib.h>
 
 /* User Libraries */
 #include "user_main.h"
 #include "L1/USART_Driver.h"
 
+#define FRAME_DELIMITER 0x00
+#define FRAME_MIN_LENGTH 3 /* Opcode and CRC */
+#define SEQUENCE_PREFIX '#'
+
 QueueHandle_t Command_Queue;
-extern QueueHandle_t Queue_hostPC_UART;
+QueueHandle_t Message_Pool_Queue;
+extern StreamBufferHandle_t Stream_hostPC_UART;
+
+static Message_t message_pool[MESSAGE_POOL_SIZE];
+
+static Message_t *Message_Acquire(void);
+static void Submit_Message(Message_t **message, size_t *received, size_t *read);
+static bool Decode_Frame(Message_t *message, size_t length);
+static void Split_Tokens(Message_t *message);
 
 /**
  * @brief Task to tokenize incoming UART data from Host PC into commands and arguments.
+ *
+ * A 0x00 byte switches the link into binary mode for one COBS frame; the next
+ * 0x00 closes the frame and returns to ASCII mode. Repeated 0x00 bytes between
+ * frames are ignored, so frames may be sent as 0x00 <frame> 0x00.
  */
 void Tokenize_Task(void *pvParameters)
 {
-    uint8_t counter = 0; // Index for received data
-    uint8_t argument_counter = 0;
-    char parse_storage[32]; // Storage for parsed data
+    Message_t *message;
+    size_t length = 0;       /* Edited line length held in message->line */
+    size_t received;         /* Raw bytes held in message->line */
+    size_t read;             /* Next raw byte to process */
+    bool discarding = false; /* Line overflowed, drop it up to the next terminator */
+    bool binary_mode = false;
     char value;
 
-    Message_t System_Next_State;
+    /* Fill the message pool */
+    for (uint8_t i = 0; i < MESSAGE_POOL_SIZE; i++)
+    {
+        Message_Release(&message_pool[i]);
+    }
+    message = Message_Acquire();
 
     while (1)
     {
-        if (xQueueReceive(Queue_hostPC_UART, &value, portMAX_DELAY) == pdTRUE)
+        if (length >= MESSAGE_LINE_LENGTH - 1)
         {
+            discarding = true; /* No terminator within the line buffer */
+            length = 0;
+        }
+
+        /* Receive directly behind the current line; editing only ever moves data backwards */
+        received = length + xStreamBufferReceive(Stream_hostPC_UART, &message->line[length],
+                                                 MESSAGE_LINE_LENGTH - 1 - length, portMAX_DELAY);
+        read = length;
+
+        while (read < received)
+        {
+            value = message->line[read++];
+
+            if (binary_mode)
+            {
+                if (value != FRAME_DELIMITER)
+                {
+                    message->line[length++] = value; /* Frame bytes are stored raw */
+                }
+                else if (length > 0)
+                {
+                    /* Closing delimiter */
+                    binary_mode = false;
+                    if (!discarding && Decode_Frame(message, length))
+                    {
+                        Submit_Message(&message, &received, &read);
+                    }
+                    discarding = false;
+                    length = 0;
+                }
+                continue;
+            }
 
             switch (value)
             {
 
+            case FRAME_DELIMITER:
+                /* Start of a binary frame; drop any partial ASCII line */
+                binary_mode = true;
+                discarding = false;
+                length = 0;
+                break;
+
             case '\177':
-                if (counter > 0)
+                if (length > 0)
                 {
-                    counter--; // Move back the counter
+                    length--; // Move back the counter
                 }
                 break;
 
-            case ' ':
-                parse_storage[counter] = '\0'; // Null-terminate
-                if (argument_counter == 0)
-                { // user command
-                    strcpy(System_Next_State.command, parse_storage);
-                }
-                else
-                {
-                    strcpy(System_Next_State.arguments[argument_counter - 1], parse_storage);
-                }
-                argument_counter += 1; // increment argument counter
-                counter = 0;           // reset counter and overwrite parse storage
+            case '\n':
                 break;
 
-            case '\r':                         // end of user statement
-                parse_storage[counter] = '\0'; // Null-terminate the string here
-                if (argument_counter == 0)
-                { // user command
-                    strcpy(System_Next_State.command, parse_storage);
-                }
-                else
+            case '\r': // end of user statement
+                message->line[length] = '\0';
+                if (!discarding)
                 {
-                    strcpy(System_Next_State.arguments[argument_counter - 1], parse_storage);
+                    Split_Tokens(message);
+                    Submit_Message(&message, &received, &read);
                 }
-                System_Next_State.arg_count = argument_counter;
-                xQueueSend(Command_Queue, &System_Next_State, portMAX_DELAY);
-                argument_counter = 0; // Send the new system state to the Command Queue
-                counter = 0;
+                discarding = false;
+                length = 0;
                 break;
 
             default:
-                parse_storage[counter] = tolower(value); // Store received character as lowercase
-                counter += 1;
+                message->line[length++] = tolower(value); // Store received character as lowercase
             }
         }
-        else
+    }
+    UNUSED(pvParameters);
+}
+
+/**
+ * @brief Send a completed message to the dispatcher and continue in a fresh one.
+ *
+ * Any bytes already received behind the completed message belong to the next
+ * line or frame and are carried over to the start of the new message.
+ *
+ * @param message Current message, replaced by the new one
+ * @param received Raw bytes held in the message buffer, updated for the new one
+ * @param read Next raw byte to process, updated for the new one
+ */
+static void Submit_Message(Message_t **message, size_t *received, size_t *read)
+{
+    Message_t *next_message = Message_Acquire();
+
+    memcpy(next_message->line, &(*message)->line[*read], *received - *read);
+    *received -= *read;
+    *read = 0;
+
+    xQueueSend(Command_Queue, message, portMAX_DELAY);
+    *message = next_message;
+}
+
+/**
+ * @brief Decode a binary frame held in the message buffer.
+ *
+ * Frame layout after COBS decoding: opcode (1 byte), sequence (2 bytes, if flagged),
+ * payload, CRC-16 (2 bytes, little-endian) computed over everything before it.
+ *
+ * @param message Message holding the COBS-encoded frame, without delimiters
+ * @param length Encoded frame length
+ * @return true if the frame decoded and its CRC matched
+ */
+static bool Decode_Frame(Message_t *message, size_t length)
+{
+    uint8_t *frame = (uint8_t *)message->line;
+    size_t decoded = Cobs_Decode(frame, length);
+    uint16_t crc;
+
+    if (decoded < FRAME_MIN_LENGTH)
+    {
+        return false;
+    }
+
+    crc = (uint16_t)frame[decoded - 2] | ((uint16_t)frame[decoded - 1] << 8);
+    if (crc != Crc16_Ccitt(frame, decoded - 2))
+    {
+        return false;
+    }
+
+    message->format = MESSAGE_FORMAT_BINARY;
+    message->command = NULL;
+    message->arg_count = 0;
+    message->opcode = frame[0] & ~FRAME_SEQUENCE_FLAG;
+    message->has_sequence = (frame[0] & FRAME_SEQUENCE_FLAG) != 0;
+    message->payload = &frame[1];
+    message->payload_length = decoded - FRAME_MIN_LENGTH;
+
+    if (message->has_sequence)
+    {
+        if (message->payload_length < sizeof(uint16_t))
         {
-            counter = 0; // Reset counter if no data received
+            return false;
         }
+        message->sequence = (uint16_t)frame[1] | ((uint16_t)frame[2] << 8);
+        message->payload += sizeof(uint16_t);
+        message->payload_length -= sizeof(uint16_t);
     }
-    UNUSED(pvParameters);
-}
\ No newline at end of file
+    return true;
+}
+
+/**
+ * @brief Split a terminated line into space-separated tokens in place.
+ *
+ * A "#<n>" token before the command sets the sequence number.
+ *
+ * @param message Message whose line buffer holds the terminated line
+ */
+static void Split_Tokens(Message_t *message)
+{
+    char *token = message->line;
+    char *cursor = message->line;
+    bool end_of_line = false;
+    bool have_command = false;
+
+    message->format = MESSAGE_FORMAT_ASCII;
+    message->has_sequence = false;
+    message->command = message->line; /* Empty string if the line has no tokens */
+    message->arg_count = 0;
+
+    while (!end_of_line)
+    {
+        if (*cursor == ' ' || *cursor == '\0')
+        {
+            end_of_line = (*cursor == '\0');
+            *cursor = '\0';
+
+            if (cursor != token)
+            {
+                if (!have_command && !message->has_sequence && *token == SEQUENCE_PREFIX)
+                {
+                    message->has_sequence = true;
+                    message->sequence = (uint16_t)strtoul(token + 1, NULL, 10);
+                }
+                else if (!have_command)
+                {
+                    message->command = token;
+                    have_command = true;
+                }
+                else if (message->arg_count < MESSAGE_MAX_ARGUMENTS)
+                {
+                    message->arguments[message->arg_count++] = token;
+                }
+            }
+            token = cursor + 1;
+        }
+        cursor++;
+    }
+}
+
+/**
+ * @brief Take a free message from the pool, waiting for the dispatcher if none are free.
+ */
+static Message_t *Message_Acquire(void)
+{
+    Message_t *message;
+    xQueueReceive(Message_Pool_Queue, &message, portMAX_DELAY);
+    return message;
+}
+
+/**
+ * @brief Return a handled message to the pool.
+ *
+ * @param message Message received from Command_Queue
+ */
+void Message_Release(Message_t *message)
+{
+    xQueueSend(Message_Pool_Queue, &message, 0);
+}
+
+/**
+ * @brief Frame and queue a binary message to the Host PC.
+ *
+ * Sent as 0x00 COBS(opcode, payload, CRC-16) 0x00. Never blocks on the wire.
+ *
+ * @param opcode Frame opcode
+ * @param payload Fixed-layout little-endian payload
+ * @param length Payload length, at most DATALINK_MAX_PAYLOAD
+ * @return true if the frame was queued
+ */
+bool Datalink_Send_Frame(uint8_t opcode, const void *payload, size_t length)
+{
+    uint8_t frame[DATALINK_MAX_PAYLOAD + FRAME_MIN_LENGTH];
+    uint8_t encoded[COBS_ENCODED_LENGTH(sizeof(frame)) + 2];
+    size_t encoded_length;
+    uint16_t crc;
+
+    if (length > DATALINK_MAX_PAYLOAD)
+    {
+        return false;
+    }
+
+    frame[0] = opcode;
+    memcpy(&frame[1], payload, length);
+    crc = Crc16_Ccitt(frame, length + 1);
+    frame[length + 1] = (uint8_t)crc;
+    frame[length + 2] = (uint8_t)(crc >> 8);
+
+    encoded[0] = FRAME_DELIMITER;
+    encoded_length = Cobs_Encode(frame, length + FRAME_MIN_LENGTH, &encoded[1]) + 1;
+    encoded[encoded_length++] = FRAME_DELIMITER;
+
+    return HostPC_Transmit(encoded, encoded_length);
+}
+
+/**
+ * @brief Decode a COBS-encoded buffer in place.
+ *
+ * @param buffer Encoded bytes without the 0x00 delimiter; overwritten with the decoded bytes
+ * @param length Encoded length
+ * @return Decoded length, or 0 if the encoding is invalid
+ */
+size_t Cobs_Decode(uint8_t *buffer, size_t length)
+{
+    size_t read = 0;
+    size_t write = 0;
+
+    while (read < length)
+    {
+        uint8_t code = buffer[read++];
+
+        if (code == 0 || read + code - 1 > length)
+        {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++)
+        {
+            buffer[write++] = buffer[read++];
+        }
+        if (code != 0xFF && read < length)
+        {
+            buffer[write++] = 0;
+        }
+    }
+    return write;
+}
+
+/**
+ * @brief COBS-encode a buffer.
+ *
+ * @param source Bytes to encode
+ * @param length Number of bytes to encode
+ * @param destination Output, at least COBS_ENCODED_LENGTH(length) bytes; no delimiter is appended
+ * @return Encoded length
+ */
+size_t Cobs_Encode(const uint8_t *source, size_t length, uint8_t *destination)
+{
+    size_t code_index = 0;
+    size_t write = 1;
+    uint8_t code = 1;
+
+    for (size_t read = 0; read < length; read++)
+    {
+        if (source[read] != 0)
+        {
+            destination[write++] = source[read];
+            code++;
+        }
+        if (source[read] == 0 || code == 0xFF)
+        {
+            destination[code_index] = code;
+            code = 1;
+            code_index = write++;
+        }
+    }
+    destination[code_index] = code;
+    return write;
+}
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF, no reflection).
+ */
+uint16_t Crc16_Ccitt(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
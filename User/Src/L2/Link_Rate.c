@@ -0,0 +1,141 @@
+/**
+ * @file Link_Rate.c
+ *
+ * @brief Negotiates the Host PC link baud rate.
+ *
+ * Handshake:
+ * 1. Host sends "baud <rate>" at the current rate; the ack/reply leaves at that rate.
+ * 2. Once the TX ring has drained, the UART switches to the new rate.
+ * 3. Host switches too and sends "baudok" at the new rate within
+ *    LINK_RATE_CONFIRM_TIMEOUT_MS. Otherwise the link reverts to the last
+ *    confirmed rate, so a host that cannot follow never loses the link.
+ * A reset always starts at LINK_RATE_DEFAULT_BAUD.
+ */
+
+/* Module Header */
+#include "L2/Link_Rate.h"
+
+/* Standard Libraries */
+
+/* User Libraries */
+#include "user_main.h"
+#include "Log.h"
+#include "L1/USART_Driver.h"
+
+#define LINK_RATE_SWITCH_DELAY_MS 20 /* Let the reply to the request reach the TX ring */
+#define LINK_RATE_DRAIN_TIMEOUT_MS 500
+#define LINK_RATE_CONFIRM_TIMEOUT_MS 2000
+
+QueueHandle_t Link_Rate_Queue;
+SemaphoreHandle_t Link_Rate_Confirm_Semaphore;
+
+static uint32_t confirmed_baud = LINK_RATE_DEFAULT_BAUD;
+static volatile bool switch_pending = false;
+
+static void Wait_TX_Drained(void);
+static void Restore_Confirmed_Rate(void);
+
+/**
+ * @brief Task to carry out requested baud rate switches.
+ */
+void Link_Rate_Task(void *pvParameters)
+{
+    uint32_t baud;
+
+    while (1)
+    {
+        if (xQueueReceive(Link_Rate_Queue, &baud, portMAX_DELAY) == pdTRUE)
+        {
+            xSemaphoreTake(Link_Rate_Confirm_Semaphore, 0); /* Discard a stale confirmation */
+
+            vTaskDelay(pdMS_TO_TICKS(LINK_RATE_SWITCH_DELAY_MS));
+            Wait_TX_Drained();
+
+            if (!HostPC_Set_Baud_Rate(baud))
+            {
+                Restore_Confirmed_Rate();
+                LOG("Host link %lu baud failed to apply, kept %lu", baud, confirmed_baud);
+            }
+            else if (xSemaphoreTake(Link_Rate_Confirm_Semaphore, pdMS_TO_TICKS(LINK_RATE_CONFIRM_TIMEOUT_MS)) == pdTRUE)
+            {
+                confirmed_baud = baud;
+                LOG("Host link at %lu baud", baud);
+            }
+            else
+            {
+                Restore_Confirmed_Rate();
+                LOG("Host link %lu baud not confirmed, reverted to %lu", baud, confirmed_baud);
+            }
+            switch_pending = false;
+        }
+    }
+    UNUSED(pvParameters);
+}
+
+/**
+ * @brief Request a switch of the Host PC link baud rate.
+ *
+ * @param baud New rate
+ * @return false if a switch is already pending or the rate cannot be generated
+ */
+bool Link_Rate_Request(uint32_t baud)
+{
+    if (switch_pending || !HostPC_Baud_Rate_Valid(baud))
+    {
+        return false;
+    }
+    switch_pending = true;
+    xQueueOverwrite(Link_Rate_Queue, &baud);
+    return true;
+}
+
+/**
+ * @brief Confirm that the host is receiving at the new rate.
+ */
+void Link_Rate_Confirm(void)
+{
+    xSemaphoreGive(Link_Rate_Confirm_Semaphore);
+}
+
+/**
+ * @brief Check whether a switch is waiting to be applied or confirmed.
+ */
+bool Link_Rate_Switch_Pending(void)
+{
+    return switch_pending;
+}
+
+/**
+ * @brief Last confirmed baud rate.
+ */
+uint32_t Link_Rate_Current(void)
+{
+    return confirmed_baud;
+}
+
+/**
+ * @brief Wait until queued output has left at the current rate, or give up after a timeout.
+ */
+static void Wait_TX_Drained(void)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    while (!HostPC_TX_Idle() && (xTaskGetTickCount() - start) < pdMS_TO_TICKS(LINK_RATE_DRAIN_TIMEOUT_MS))
+    {
+        vTaskDelay(1);
+    }
+}
+
+/**
+ * @brief Return the UART to the last confirmed rate.
+ *
+ * That rate was running moments ago, so failing to restore it means the UART
+ * itself is broken and the link is lost.
+ */
+static void Restore_Confirmed_Rate(void)
+{
+    bool restored = HostPC_Set_Baud_Rate(confirmed_baud);
+
+    configASSERT(restored);
+    UNUSED(restored);
+}
@@ -0,0 +1,268 @@
+/**
+ * @file Modbus_PDU.c
+ *
+ * @brief Modbus RTU frame checking and request execution.
+ *
+ * Supports function codes 0x03, 0x04, 0x06 and 0x10 against a register map
+ * supplied by the caller. The module has no RTOS, HAL or driver dependencies,
+ * so the host tests drive it directly; Modbus_RTU.c feeds it frames from the
+ * Host PC link.
+ */
+
+/* Module Header */
+#include "L2/Modbus_PDU.h"
+
+/* Standard Libraries */
+#include <stdbool.h>
+
+#define MODBUS_READ_HOLDING_REGISTERS 0x03
+#define MODBUS_READ_INPUT_REGISTERS 0x04
+#define MODBUS_WRITE_SINGLE_REGISTER 0x06
+#define MODBUS_WRITE_MULTIPLE_REGISTERS 0x10
+#define MODBUS_EXCEPTION_FLAG 0x80
+
+#define MODBUS_MAX_READ_COUNT 125
+#define MODBUS_MAX_WRITE_COUNT 123
+#define MODBUS_MIN_ADU_LENGTH 4 /* Address, function and CRC */
+
+static size_t Process_PDU(const Modbus_Register_Map_t *map, const uint8_t *request, size_t length,
+                          uint8_t *response);
+static size_t Read_Registers(const Modbus_Register_Map_t *map, const uint8_t *request, size_t length,
+                             uint8_t *response, bool holding);
+static size_t Write_Single_Register(const Modbus_Register_Map_t *map, const uint8_t *request, size_t length,
+                                    uint8_t *response);
+static size_t Write_Multiple_Registers(const Modbus_Register_Map_t *map, const uint8_t *request, size_t length,
+                                       uint8_t *response);
+static size_t Exception_Response(uint8_t function, Modbus_Exception_t exception, uint8_t *response);
+
+static inline uint16_t Read_U16_BE(const uint8_t *data)
+{
+    return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+static inline void Write_U16_BE(uint8_t *data, uint16_t value)
+{
+    data[0] = (uint8_t)(value >> 8);
+    data[1] = (uint8_t)value;
+}
+
+/**
+ * @brief Process one RTU request frame.
+ *
+ * @param map Register map to serve, NULL to answer every request with a device failure
+ * @param request Received ADU: address, PDU, CRC (low byte first)
+ * @param length ADU length
+ * @param response Reply ADU, at least MODBUS_MAX_ADU_LENGTH bytes
+ * @return Reply length, or 0 if no reply is due (bad CRC, other address, broadcast)
+ */
+size_t Modbus_Process_Frame(const Modbus_Register_Map_t *map, const uint8_t *request, size_t length,
+                            uint8_t *response)
+{
+    uint16_t crc;
+    size_t pdu_length;
+
+    if (length < MODBUS_MIN_ADU_LENGTH || length > MODBUS_MAX_ADU_LENGTH)
+    {
+        return 0;
+    }
+
+    crc = (uint16_t)request[length - 2] | ((uint16_t)request[length - 1] << 8);
+    if (crc != Modbus_Crc16(request, length - 2))
+    {
+        return 0;
+    }
+
+    if (request[0] != MODBUS_SERVER_ADDRESS && request[0] != MODBUS_BROADCAST_ADDRESS)
+    {
+        return 0;
+    }
+
+    response[0] = MODBUS_SERVER_ADDRESS;
+    pdu_length = Process_PDU(map, &request[1], length - 3, &response[1]);
+    if (request[0] == MODBUS_BROADCAST_ADDRESS)
+    {
+        return 0; /* Broadcasts are executed but never answered */
+    }
+
+    crc = Modbus_Crc16(response, pdu_length + 1);
+    response[pdu_length + 1] = (uint8_t)crc;
+    response[pdu_length + 2] = (uint8_t)(crc >> 8);
+    return pdu_length + 3;
+}
+
+/**
+ * @brief CRC-16/MODBUS (reflected poly 0xA001, init 0xFFFF).
+ */
+uint16_t Modbus_Crc16(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief Execute a request PDU.
+ *
+ * @return Reply PDU length
+ */
+static size_t Process_PDU(const Modbus_Register_Map_t *map, const uint8_t *request, size_t length,
+                          uint8_t *response)
+{
+    uint8_t function = request[0];
+
+    if (map == NULL)
+    {
+        return Exception_Response(function, MODBUS_EXCEPTION_SERVER_DEVICE_FAILURE, response);
+    }
+
+    switch (function)
+    {
+    case MODBUS_READ_HOLDING_REGISTERS:
+        return Read_Registers(map, request, length, response, true);
+    case MODBUS_READ_INPUT_REGISTERS:
+        return Read_Registers(map, request, length, response, false);
+    case MODBUS_WRITE_SINGLE_REGISTER:
+        return Write_Single_Register(map, request, length, response);
+    case MODBUS_WRITE_MULTIPLE_REGISTERS:
+        return Write_Multiple_Registers(map, request, length, response);
+    default:
+        return Exception_Response(function, MODBUS_EXCEPTION_ILLEGAL_FUNCTION, response);
+    }
+}
+
+/**
+ * @brief Function codes 0x03 and 0x04.
+ */
+static size_t Read_Registers(const Modbus_Register_Map_t *map, const uint8_t *request, size_t length,
+                             uint8_t *response, bool holding)
+{
+    uint16_t start;
+    uint16_t count;
+    uint16_t limit = holding ? map->holding_count : map->input_count;
+    Modbus_Exception_t exception;
+    uint16_t value;
+
+    if (length != 5)
+    {
+        return Exception_Response(request[0], MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, response);
+    }
+    start = Read_U16_BE(&request[1]);
+    count = Read_U16_BE(&request[3]);
+
+    if (count == 0 || count > MODBUS_MAX_READ_COUNT)
+    {
+        return Exception_Response(request[0], MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, response);
+    }
+    if ((uint32_t)start + count > limit)
+    {
+        return Exception_Response(request[0], MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS, response);
+    }
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        exception = holding ? map->read_holding(start + i, &value)
+                            : map->read_input(start + i, &value);
+        if (exception != MODBUS_EXCEPTION_NONE)
+        {
+            return Exception_Response(request[0], exception, response);
+        }
+        Write_U16_BE(&response[2 + 2 * i], value);
+    }
+
+    response[0] = request[0];
+    response[1] = (uint8_t)(2 * count);
+    return 2 + 2 * count;
+}
+
+/**
+ * @brief Function code 0x06; the reply echoes the request.
+ */
+static size_t Write_Single_Register(const Modbus_Register_Map_t *map, const uint8_t *request, size_t length,
+                                    uint8_t *response)
+{
+    uint16_t address;
+    Modbus_Exception_t exception;
+
+    if (length != 5)
+    {
+        return Exception_Response(request[0], MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, response);
+    }
+    address = Read_U16_BE(&request[1]);
+
+    if (address >= map->holding_count)
+    {
+        return Exception_Response(request[0], MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS, response);
+    }
+
+    exception = map->write_holding(address, Read_U16_BE(&request[3]));
+    if (exception != MODBUS_EXCEPTION_NONE)
+    {
+        return Exception_Response(request[0], exception, response);
+    }
+
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        response[i] = request[i];
+    }
+    return 5;
+}
+
+/**
+ * @brief Function code 0x10; registers are written in ascending address order.
+ */
+static size_t Write_Multiple_Registers(const Modbus_Register_Map_t *map, const uint8_t *request, size_t length,
+                                       uint8_t *response)
+{
+    uint16_t start;
+    uint16_t count;
+    Modbus_Exception_t exception;
+
+    if (length < 6)
+    {
+        return Exception_Response(request[0], MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, response);
+    }
+    start = Read_U16_BE(&request[1]);
+    count = Read_U16_BE(&request[3]);
+
+    if (count == 0 || count > MODBUS_MAX_WRITE_COUNT || request[5] != 2 * count || length != 6u + 2u * count)
+    {
+        return Exception_Response(request[0], MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, response);
+    }
+    if ((uint32_t)start + count > map->holding_count)
+    {
+        return Exception_Response(request[0], MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS, response);
+    }
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        exception = map->write_holding(start + i, Read_U16_BE(&request[6 + 2 * i]));
+        if (exception != MODBUS_EXCEPTION_NONE)
+        {
+            return Exception_Response(request[0], exception, response);
+        }
+    }
+
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        response[i] = request[i];
+    }
+    return 5;
+}
+
+/**
+ * @brief Build an exception reply PDU.
+ */
+static size_t Exception_Response(uint8_t function, Modbus_Exception_t exception, uint8_t *response)
+{
+    response[0] = function | MODBUS_EXCEPTION_FLAG;
+    response[1] = (uint8_t)exception;
+    return 2;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file Modbus_RTU.c
+ *
+ * @brief Modbus RTU server for the Host PC link.
+ *
+ * Frames arrive whole from the USART driver, delimited by t3.5 of line
+ * silence, while the link is in Modbus mode. Each is checked and executed by
+ * L2/Modbus_PDU.c against the register map registered by the application.
+ */
+
+/* Module Header */
+#include "L2/Modbus_RTU.h"
+
+/* Standard Libraries */
+#include <stdbool.h>
+
+/* User Libraries */
+#include "user_main.h"
+#include "L1/USART_Driver.h"
+
+extern MessageBufferHandle_t Message_hostPC_Frames;
+
+static const Modbus_Register_Map_t *register_map = NULL;
+static volatile bool exit_requested = false;
+static uint8_t request_adu[MODBUS_MAX_ADU_LENGTH];
+static uint8_t response_adu[MODBUS_MAX_ADU_LENGTH];
+
+/**
+ * @brief Task to serve Modbus requests while the Host PC link is in Modbus mode.
+ */
+void Modbus_Task(void *pvParameters)
+{
+    size_t length;
+
+    while (1)
+    {
+        length = xMessageBufferReceive(Message_hostPC_Frames, request_adu, sizeof(request_adu), portMAX_DELAY);
+        length = Modbus_Process_Frame(register_map, request_adu, length, response_adu);
+        if (length > 0)
+        {
+            HostPC_Transmit_Modbus(response_adu, length);
+        }
+
+        /* Leave Modbus mode only once the reply is queued */
+        if (exit_requested)
+        {
+            exit_requested = false;
+            HostPC_Set_Link_Mode(HOSTPC_LINK_CONSOLE);
+        }
+    }
+    UNUSED(pvParameters);
+}
+
+/**
+ * @brief Register the application's register map.
+ */
+void Modbus_Set_Register_Map(const Modbus_Register_Map_t *map)
+{
+    register_map = map;
+}
+
+/**
+ * @brief Return the link to console mode after the current reply is sent.
+ */
+void Modbus_Request_Exit(void)
+{
+    exit_requested = true;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file Position_Estimator.c
+ *
+ * @brief Constant-velocity Kalman filter estimating position and velocity from distance samples.
+ *
+ * The state is position and velocity, driven by white-noise acceleration.
+ * Predict advances the state by any interval, so it can run between samples;
+ * Update corrects it with a measurement. A measurement whose innovation falls
+ * outside the gate is rejected as an outlier; after several rejections in a row
+ * the filter assumes it has lost track and restarts on the measurement.
+ */
+
+/* Module Header */
+#include "L2/Position_Estimator.h"
+
+/* Standard Libraries */
+
+/* User Libraries */
+
+#define MEASUREMENT_VARIANCE_MM2 4.0f       /* Ultrasonic noise, ~2 mm standard deviation */
+#define ACCELERATION_VARIANCE_MM2_S4 2.5e5f /* ~500 mm/s^2 standard deviation */
+#define INITIAL_VELOCITY_VARIANCE 1.0e4f    /* ~100 mm/s standard deviation */
+#define INNOVATION_GATE_SIGMA 4.0f
+#define MAX_REJECTED_IN_ROW 3
+
+/**
+ * @brief Restart the estimate at rest on a position.
+ *
+ * @param estimator Estimator to reset
+ * @param position_mm Starting position
+ */
+void Position_Estimator_Reset(Position_Estimator_t *estimator, float position_mm)
+{
+    estimator->position_mm = position_mm;
+    estimator->velocity_mm_s = 0.0f;
+    estimator->covariance[0][0] = MEASUREMENT_VARIANCE_MM2;
+    estimator->covariance[0][1] = 0.0f;
+    estimator->covariance[1][0] = 0.0f;
+    estimator->covariance[1][1] = INITIAL_VELOCITY_VARIANCE;
+    estimator->innovation_mm = 0.0f;
+    estimator->rejected_in_row = 0;
+}
+
+/**
+ * @brief Advance the estimate by a time step.
+ *
+ * @param estimator Estimator to advance
+ * @param dt Time step in seconds
+ */
+void Position_Estimator_Predict(Position_Estimator_t *estimator, float dt)
+{
+    float (*P)[2] = estimator->covariance;
+    float dt2 = dt * dt;
+
+    estimator->position_mm += estimator->velocity_mm_s * dt;
+
+    /* P = F P F' + Q, with Q from a constant acceleration over the step */
+    P[0][0] += dt * (P[0][1] + P[1][0] + dt * P[1][1]) + ACCELERATION_VARIANCE_MM2_S4 * dt2 * dt2 / 4.0f;
+    P[0][1] += dt * P[1][1] + ACCELERATION_VARIANCE_MM2_S4 * dt2 * dt / 2.0f;
+    P[1][0] = P[0][1];
+    P[1][1] += ACCELERATION_VARIANCE_MM2_S4 * dt2;
+}
+
+/**
+ * @brief Correct the estimate with a position measurement.
+ *
+ * @param estimator Estimator to correct, already predicted to the measurement time
+ * @param measurement_mm Measured position
+ * @return false if the measurement was rejected as an outlier
+ */
+bool Position_Estimator_Update(Position_Estimator_t *estimator, float measurement_mm)
+{
+    float (*P)[2] = estimator->covariance;
+    float innovation = measurement_mm - estimator->position_mm;
+    float innovation_variance = P[0][0] + MEASUREMENT_VARIANCE_MM2;
+    float position_gain;
+    float velocity_gain;
+
+    estimator->innovation_mm = innovation;
+
+    if (innovation * innovation > INNOVATION_GATE_SIGMA * INNOVATION_GATE_SIGMA * innovation_variance)
+    {
+        if (++estimator->rejected_in_row < MAX_REJECTED_IN_ROW)
+        {
+            return false;
+        }
+        /* Consistently far off, so the track is lost rather than the samples being spikes */
+        Position_Estimator_Reset(estimator, measurement_mm);
+        return true;
+    }
+    estimator->rejected_in_row = 0;
+
+    position_gain = P[0][0] / innovation_variance;
+    velocity_gain = P[1][0] / innovation_variance;
+
+    estimator->position_mm += position_gain * innovation;
+    estimator->velocity_mm_s += velocity_gain * innovation;
+
+    /* P = (I - K H) P */
+    P[1][1] -= velocity_gain * P[0][1];
+    P[0][1] -= position_gain * P[0][1];
+    P[0][0] -= position_gain * P[0][0];
+    P[1][0] = P[0][1];
+    return true;
+}
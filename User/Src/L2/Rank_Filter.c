@@ -0,0 +1,151 @@
+/**
+ * @file Rank_Filter.c
+ *
+ * @brief Median and trimmed-mean filters over windows of 3, 5, 7 or 9 samples.
+ *
+ * Windows are sorted by fixed sorting networks, listed below as compare-exchange
+ * pairs and expanded into straight-line min/max code, so the cost does not
+ * depend on the data. When only the median is read, the compiler drops the
+ * compare-exchanges that cannot reach the middle element.
+ */
+
+/* Module Header */
+#include "L2/Rank_Filter.h"
+
+/* Standard Libraries */
+#include <string.h>
+
+/* User Libraries */
+
+/* Optimal sorting networks, as (i, j) compare-exchange pairs leaving v[i] <= v[j] */
+#define SORT_NETWORK_3(X) X(0, 2) X(0, 1) X(1, 2)
+#define SORT_NETWORK_5(X) \
+    X(0, 3) X(1, 4) X(0, 2) X(1, 3) X(0, 1) X(2, 4) X(1, 2) X(3, 4) X(2, 3)
+#define SORT_NETWORK_7(X)                                                    \
+    X(0, 6) X(2, 3) X(4, 5) X(0, 2) X(1, 4) X(3, 6) X(0, 1) X(2, 5) X(3, 4) \
+    X(1, 2) X(4, 6) X(2, 3) X(4, 5) X(1, 2) X(3, 4) X(5, 6)
+#define SORT_NETWORK_9(X)                                                    \
+    X(0, 3) X(1, 7) X(2, 5) X(4, 8) X(0, 7) X(2, 4) X(3, 8) X(5, 6) X(0, 2) \
+    X(1, 3) X(4, 5) X(7, 8) X(1, 4) X(3, 6) X(5, 7) X(0, 1) X(2, 4) X(3, 5) \
+    X(6, 8) X(2, 3) X(4, 5) X(6, 7) X(1, 2) X(3, 4) X(5, 6)
+
+/* Branch-free compare-exchange; min/max compile to conditional selects */
+#define COMPARE_EXCHANGE(i, j)                     \
+    {                                              \
+        uint32_t low = v[i] < v[j] ? v[i] : v[j];  \
+        uint32_t high = v[i] < v[j] ? v[j] : v[i]; \
+        v[i] = low;                                \
+        v[j] = high;                               \
+    }
+
+#define DEFINE_SORT(size)                                      \
+    static inline void Sort_##size(uint32_t v[size])           \
+    {                                                          \
+        SORT_NETWORK_##size(COMPARE_EXCHANGE)                  \
+    }
+
+DEFINE_SORT(3)
+DEFINE_SORT(5)
+DEFINE_SORT(7)
+DEFINE_SORT(9)
+
+/**
+ * @brief Sort a copy of a window of samples.
+ *
+ * @param samples Window, in any order
+ * @param window Window size, validated by the caller
+ * @param sorted Receives the sorted copy
+ */
+static inline void Sort_Window(const uint32_t *samples, uint8_t window, uint32_t *sorted)
+{
+    switch (window)
+    {
+    case 3:
+        memcpy(sorted, samples, 3 * sizeof(uint32_t));
+        Sort_3(sorted);
+        break;
+    case 5:
+        memcpy(sorted, samples, 5 * sizeof(uint32_t));
+        Sort_5(sorted);
+        break;
+    case 7:
+        memcpy(sorted, samples, 7 * sizeof(uint32_t));
+        Sort_7(sorted);
+        break;
+    default:
+        memcpy(sorted, samples, 9 * sizeof(uint32_t));
+        Sort_9(sorted);
+        break;
+    }
+}
+
+/**
+ * @brief Check that a window size has a sorting network.
+ */
+bool Rank_Filter_Window_Valid(uint8_t window)
+{
+    return window == 3 || window == 5 || window == 7 || window == 9;
+}
+
+/**
+ * @brief Median of a window of samples.
+ *
+ * Each case sorts and reads only the middle element, so each network is pruned
+ * to the compare-exchanges the median depends on.
+ *
+ * @param samples Window, in any order
+ * @param window 3, 5, 7 or 9
+ * @return Median sample
+ */
+uint32_t Rank_Filter_Median(const uint32_t *samples, uint8_t window)
+{
+    uint32_t v[RANK_FILTER_MAX_WINDOW];
+
+    switch (window)
+    {
+    case 3:
+        memcpy(v, samples, 3 * sizeof(uint32_t));
+        Sort_3(v);
+        return v[1];
+    case 5:
+        memcpy(v, samples, 5 * sizeof(uint32_t));
+        Sort_5(v);
+        return v[2];
+    case 7:
+        memcpy(v, samples, 7 * sizeof(uint32_t));
+        Sort_7(v);
+        return v[3];
+    default:
+        memcpy(v, samples, 9 * sizeof(uint32_t));
+        Sort_9(v);
+        return v[4];
+    }
+}
+
+/**
+ * @brief Mean of a window of samples after dropping the extremes.
+ *
+ * @param samples Window, in any order
+ * @param window 3, 5, 7 or 9
+ * @param trim Samples dropped from each end; (window - 1) / 2 gives the median
+ * @return Rounded mean of the remaining samples
+ */
+uint32_t Rank_Filter_Trimmed_Mean(const uint32_t *samples, uint8_t window, uint8_t trim)
+{
+    uint32_t sorted[RANK_FILTER_MAX_WINDOW];
+    uint32_t count;
+    uint64_t sum = 0; /* Full-width samples */
+
+    if (2 * trim >= window)
+    {
+        trim = (window - 1) / 2;
+    }
+    count = window - 2 * trim;
+
+    Sort_Window(samples, window, sorted);
+    for (uint8_t i = trim; i < window - trim; i++)
+    {
+        sum += sorted[i];
+    }
+    return (uint32_t)((sum + count / 2) / count);
+}
@@ -2,107 +2,473 @@
  * @file Sensor_Filter.c
  *
  * @brief Implements filtering for raw sensor data.
+ *
+ * Each sample passes through a pipeline of stages: a median or trimmed mean
+ * over the last 3 to 9 samples against spikes, a fixed-point first-order
+ * low-pass, a CMSIS-DSP biquad cascade low-pass, and a CMSIS-DSP FIR decimator.
+ * Each stage can be bypassed. A profile selects the stages and their
+ * coefficients, and may be switched at runtime to trade latency against noise
+ * rejection. The pipeline restarts from the current sample on a switch.
+ *
+ * The ping rate follows the measured distance, so the biquad is specified by
+ * its cutoff and designed against the measured sample rate. It is redesigned
+ * in place whenever the rate drifts by more than FILTER_REDESIGN_TOLERANCE;
+ * the direct form I state is past inputs and outputs, so it carries over.
+ *
+ * Every sample also updates a constant-velocity Kalman estimator, which rejects
+ * outliers and supplies velocity to the controller. The estimator profile uses
+ * its position in place of the other stages.
  */
 
 /* Module Header */
 #include "L2/Sensor_Filter.h"
 
 /* Standard Libraries */
+#include <math.h>
 
 /* User Libraries */
 #include "user_main.h"
+#include "arm_math.h"
+#include "Log.h"
+#include "Fixed_Point.h"
+#include "L1/Ultrasonic_Driver.h"
+#include "L1/Cycle_Counter.h"
+#include "L2/Position_Estimator.h"
+#include "L2/Rank_Filter.h"
+#include "L2/Sensor_Health.h"
+
+#define FILTER_MAX_BIQUAD_STAGES 2
+#define FILTER_MAX_FIR_TAPS 16
+#define FILTER_MAX_DECIMATION 4
+#define BIQUAD_COEFFICIENTS_PER_STAGE 5
+#define BIQUAD_STATE_PER_STAGE 4
+#define FILTER_NOMINAL_RATE_HZ 150.0f   /* Assumed until the ping rate has been measured */
+#define FILTER_RATE_WEIGHT 0.0625f      /* Weight of each new interval in the sample rate average */
+#define FILTER_REDESIGN_TOLERANCE 0.05f /* Relative rate change that redesigns the biquad */
+#define FILTER_MAX_CUTOFF_RATIO 0.45f   /* Highest cutoff as a fraction of the sample rate */
+
+typedef struct
+{
+    bool estimator;                       /* Output the Kalman position; bypasses the stages below */
+    uint8_t rank_window;                  /* 0 bypasses the rank filter, else 3, 5, 7 or 9 */
+    uint8_t rank_trim;                    /* Samples dropped from each end; (window - 1) / 2 is the median */
+    Fixed_Q15_t lowpass_alpha;            /* 0 bypasses the fixed-point first-order low-pass */
+    uint8_t biquad_stages;                /* 0 bypasses the biquad cascade, else a Butterworth of twice the order */
+    float biquad_cutoff_hz;
+    uint8_t decimation;                   /* 1 bypasses the FIR decimator */
+    uint16_t fir_taps;
+    const float32_t *fir_coefficients; /* Time-reversed, as CMSIS expects */
+} Filter_Profile_t;
+
+/* 8-tap Hamming windowed-sinc, cutoff at a quarter of the input rate, for decimation by 2 */
+static const float32_t halfband_8tap[8] = {
+    -0.00516430f, -0.02288252f, 0.09675565f, 0.43129117f, 0.43129117f, 0.09675565f, -0.02288252f, -0.00516430f};
+
+static const Filter_Profile_t filter_profiles[SENSOR_FILTER_PROFILE_COUNT] = {
+    [SENSOR_FILTER_LEGACY] = {.rank_window = 3, .rank_trim = 1,
+                              .lowpass_alpha = FIXED_Q15(0.625), /* The original Q8 160/256: fc ~3.3 Hz at 30 ms sampling */
+                              .decimation = 1},
+    [SENSOR_FILTER_FAST] = {.rank_window = 3, .rank_trim = 1,
+                            .decimation = 1},
+    [SENSOR_FILTER_SMOOTH] = {.rank_window = 3, .rank_trim = 1,
+                              .biquad_stages = 1, .biquad_cutoff_hz = 10.0f,
+                              .decimation = 1},
+    [SENSOR_FILTER_DECIMATE] = {.rank_window = 3, .rank_trim = 1,
+                                .decimation = 2, .fir_taps = 8, .fir_coefficients = halfband_8tap},
+    [SENSOR_FILTER_KALMAN] = {.estimator = true,
+                              .decimation = 1},
+    [SENSOR_FILTER_ROBUST] = {.rank_window = 7, .rank_trim = 2,
+                              .biquad_stages = 1, .biquad_cutoff_hz = 10.0f,
+                              .decimation = 1},
+};
+
+/* Rank filter window, filled in arrival order up to the profile's window size */
+static uint32_t rank_buffer[RANK_FILTER_MAX_WINDOW];
+static uint8_t rank_index = 0;
+
+/* Fixed-point low-pass state */
+static Fixed_IIR1_t lowpass;
 
-#define MEDIAN_WINDOW_SIZE 3
-#define ALPHA 160 /* fc = ~3.3 Hz */
-#define Q8_SCALE_FACTOR 256
+/* CMSIS-DSP stage instances and their state */
+static arm_biquad_casd_df1_inst_f32 biquad;
+static float32_t biquad_coefficients[FILTER_MAX_BIQUAD_STAGES * BIQUAD_COEFFICIENTS_PER_STAGE]; /* {b0, b1, b2, a1, a2} per stage, CMSIS feedback sign */
+static float32_t biquad_state[FILTER_MAX_BIQUAD_STAGES * BIQUAD_STATE_PER_STAGE];
+static float biquad_design_rate_hz = 0.0f; /* Sample rate the coefficients were designed for */
+static arm_fir_decimate_instance_f32 decimator;
+static float32_t decimator_state[FILTER_MAX_FIR_TAPS + FILTER_MAX_DECIMATION - 1];
+static float32_t decimator_input[FILTER_MAX_DECIMATION];
+static uint8_t decimator_fill = 0;
 
-/* Median filter buffer */
-static uint32_t median_buffer[MEDIAN_WINDOW_SIZE];
-static uint8_t median_index = 0;
+static const Filter_Profile_t *active_profile = &filter_profiles[SENSOR_FILTER_KALMAN];
+static volatile Sensor_Filter_Profile_t requested_profile = SENSOR_FILTER_KALMAN;
 
-/* Low-pass filtered value */
-static uint32_t lowpass_filtered = 0;
+/* Kalman estimate, and its velocity published for other tasks */
+static Position_Estimator_t estimator;
+static volatile float estimate_velocity_mm_s;
+static uint32_t estimate_time_cycles;
+static volatile uint32_t rejected_samples = 0;
+
+/* Average rate of consecutive echoed samples */
+static float sample_rate_hz = FILTER_NOMINAL_RATE_HZ;
+
+/* Most recent pipeline output */
+static volatile uint32_t filtered_output = 0;
+
+/* Most recent unfiltered sample */
+static volatile uint32_t last_raw_sample = 0;
 
 QueueHandle_t Filtered_Ultrasonic_Queue;
-extern QueueHandle_t Raw_Ultrasonic_Queue;
+
+static bool Wait_For_Sample(Ultrasonic_Sample_t *sample);
+static bool Estimate(const Ultrasonic_Sample_t *sample);
+static void Publish_Estimate(uint32_t timestamp_cycles);
+static void Measure_Sample_Rate(uint32_t interval_cycles);
+static void Design_Biquad(float rate_hz);
+static void Pipeline_Reset(uint32_t sample);
+static bool Pipeline_Run(uint32_t sample, uint32_t *output);
 
 /**
- * @brief Compute the median of three values.
+ * @brief Task to filter raw ultrasonic sensor readings.
  *
- * Used to reduce spikes in ultrasonic sensor readings.
+ * Runs each echoed sample through the active profile's pipeline and sends the
+ * filtered record to Filtered_Ultrasonic_Queue. A decimating profile sends one
+ * record per decimation block. Timeouts and samples overwritten before they
+ * were read are not sent, but flag the next record sent. Every new sample read
+ * is graded by the sensor health monitor, once. Consecutive echoed samples
+ * measure the sample rate the biquad is designed for.
+ */
+void Sensor_Filter_Task(void *pvParameters)
+{
+    Ultrasonic_Sample_t sample;
+    Filtered_Sample_t filtered;
+    uint32_t last_sequence = UINT32_MAX; /* Sequences only reach UINT32_MAX / 2 */
+    uint32_t last_valid_sequence;
+    uint32_t last_valid_cycles;
+    uint8_t flags = 0;
+    Sensor_Filter_Profile_t profile = SENSOR_FILTER_KALMAN;
+
+    Ultrasonic_Set_Consumer(ULTRASONIC_VERTICAL, xTaskGetCurrentTaskHandle());
+
+    /* Initialize filters with first echoed sample */
+    do
+    {
+        while (!Wait_For_Sample(&sample) || sample.sequence == last_sequence)
+        {
+        }
+        last_sequence = sample.sequence;
+        Sensor_Health_Update(&sample, 0);
+    } while (!(sample.flags & ULTRASONIC_SAMPLE_VALID));
+    last_valid_sequence = sample.sequence;
+    last_valid_cycles = sample.timestamp_cycles;
+    Position_Estimator_Reset(&estimator, (float)sample.distance_mm);
+    Publish_Estimate(sample.timestamp_cycles);
+    Pipeline_Reset(sample.distance_mm);
+
+    while (1)
+    {
+        if (!Wait_For_Sample(&sample))
+        {
+            continue;
+        }
+        if (sample.sequence == last_sequence)
+        {
+            continue; /* Already read; its notification was left pending behind the read */
+        }
+
+        Sensor_Health_Update(&sample, sample.sequence - last_sequence - 1);
+        if (sample.sequence != last_sequence + 1)
+        {
+            flags |= SENSOR_SAMPLE_AFTER_MISSED;
+        }
+        last_sequence = sample.sequence;
+
+        if (!(sample.flags & ULTRASONIC_SAMPLE_VALID))
+        {
+            flags |= SENSOR_SAMPLE_AFTER_MISSED;
+            continue;
+        }
+        last_raw_sample = sample.distance_mm;
+
+        /* Only an unbroken pair of echoes spans one ping period */
+        if (sample.sequence == last_valid_sequence + 1)
+        {
+            Measure_Sample_Rate(sample.timestamp_cycles - last_valid_cycles);
+        }
+        last_valid_sequence = sample.sequence;
+        last_valid_cycles = sample.timestamp_cycles;
+
+        if (!Estimate(&sample))
+        {
+            flags |= SENSOR_SAMPLE_REJECTED;
+        }
+
+        if (requested_profile != profile)
+        {
+            profile = requested_profile;
+            active_profile = &filter_profiles[profile];
+            Pipeline_Reset(sample.distance_mm);
+            LOG("Sensor filter profile %u", profile);
+        }
+
+        if (Pipeline_Run(sample.distance_mm, &filtered.distance_mm))
+        {
+            filtered.timestamp_cycles = sample.timestamp_cycles;
+            filtered.sequence = sample.sequence;
+            filtered.raw_distance_mm = sample.distance_mm;
+            filtered.echo_us = sample.echo_us;
+            filtered.flags = flags;
+            flags = 0;
+
+            /* Send filtered value to queue */
+            xQueueSend(Filtered_Ultrasonic_Queue, &filtered, 0);
+        }
+    }
+}
+
+/**
+ * @brief Advance the Kalman estimator to a sample and correct it with the sample.
  *
- * @param a First value
- * @param b Second value
- * @param c Third value
- * @return Median value
+ * @param sample Echoed ultrasonic sample
+ * @return false if the estimator rejected the sample as an outlier
  */
-static uint32_t median_of_3(uint16_t a, uint16_t b, uint16_t c)
+static bool Estimate(const Ultrasonic_Sample_t *sample)
 {
-    if ((a > b) != (a > c))
-        return a;
-    else if ((b > a) != (b > c))
-        return b;
-    else
-        return c;
+    bool accepted;
+
+    Position_Estimator_Predict(&estimator, Cycle_Counter_To_Seconds(sample->timestamp_cycles - estimate_time_cycles));
+    accepted = Position_Estimator_Update(&estimator, (float)sample->distance_mm);
+    if (!accepted)
+    {
+        rejected_samples++;
+    }
+
+    Publish_Estimate(sample->timestamp_cycles);
+    return accepted;
 }
 
 /**
- * @brief Apply a low-pass filter to the input sample.
+ * @brief Publish the velocity estimate, and note the time the estimate applies to.
  *
- * First order IIR filter: y[n] = (alpha * x[n] + (1 - alpha) * y[n-1])
- * fc ~ alpha / (2 * pi * Ts * 256)
- * Uses Q8 fixed-point arithmetic.
+ * @param timestamp_cycles Time the estimate applies to
+ */
+static void Publish_Estimate(uint32_t timestamp_cycles)
+{
+    estimate_velocity_mm_s = estimator.velocity_mm_s;
+    estimate_time_cycles = timestamp_cycles;
+}
+
+/**
+ * @brief Fold one ping interval into the sample rate, and redesign the biquad
+ * if the rate has drifted from the one it was designed for.
  *
- * @param sample New input sample
- * @return Filtered output sample
+ * @param interval_cycles Cycles between two consecutive echoed samples
  */
-static uint32_t lowpass(uint16_t sample)
+static void Measure_Sample_Rate(uint32_t interval_cycles)
 {
-    lowpass_filtered = (ALPHA * sample + (Q8_SCALE_FACTOR - ALPHA) * lowpass_filtered) >> 8;
-    return lowpass_filtered;
+    float interval_s = Cycle_Counter_To_Seconds(interval_cycles);
+
+    if (interval_s <= 0.0f)
+    {
+        return;
+    }
+    sample_rate_hz += (1.0f / interval_s - sample_rate_hz) * FILTER_RATE_WEIGHT;
+
+    if (active_profile->biquad_stages > 0 &&
+        fabsf(sample_rate_hz - biquad_design_rate_hz) > biquad_design_rate_hz * FILTER_REDESIGN_TOLERANCE)
+    {
+        Design_Biquad(sample_rate_hz);
+    }
 }
 
 /**
- * @brief Task to filter raw ultrasonic sensor readings.
+ * @brief Design the active profile's Butterworth low-pass for a sample rate.
+ *
+ * Each stage is a bilinear-transform low-pass with the cutoff prewarped, and
+ * the stage Q values place the poles of a Butterworth of twice the stage count.
  *
- * Applies median filtering followed by low-pass filtering.
- * Sends filtered readings to Filtered_Ultrasonic_Queue.
+ * @param rate_hz Sample rate in hertz
  */
-void Sensor_Filter_Task(void *pvParameters)
+static void Design_Biquad(float rate_hz)
 {
-    uint32_t raw_sample;
-    uint32_t median_value;
-    uint32_t filtered_value;
+    const Filter_Profile_t *profile = active_profile;
+    float cutoff_hz = fminf(profile->biquad_cutoff_hz, rate_hz * FILTER_MAX_CUTOFF_RATIO);
+    float w0 = 2.0f * PI * cutoff_hz / rate_hz;
+    float cos_w0 = cosf(w0);
+    float sin_w0 = sinf(w0);
 
-    /* Initialize filters with first sample */
-    if (xQueueReceive(Raw_Ultrasonic_Queue, &raw_sample, portMAX_DELAY) == pdPASS)
+    for (uint8_t i = 0; i < profile->biquad_stages; i++)
     {
-        lowpass_filtered = raw_sample;
-        for (uint8_t i = 0; i < MEDIAN_WINDOW_SIZE; i++)
+        float32_t *stage = &biquad_coefficients[i * BIQUAD_COEFFICIENTS_PER_STAGE];
+        float q = 0.5f / cosf(PI * (float)(2 * i + 1) / (float)(4 * profile->biquad_stages));
+        float alpha = sin_w0 / (2.0f * q);
+        float a0 = 1.0f + alpha;
+
+        stage[0] = (1.0f - cos_w0) / (2.0f * a0);
+        stage[1] = 2.0f * stage[0];
+        stage[2] = stage[0];
+        stage[3] = 2.0f * cos_w0 / a0;
+        stage[4] = -(1.0f - alpha) / a0;
+    }
+    biquad_design_rate_hz = rate_hz;
+}
+
+/**
+ * @brief Restart every stage of the active profile at steady state on a sample.
+ *
+ * @param sample Distance in millimeters to settle the stages on
+ */
+static void Pipeline_Reset(uint32_t sample)
+{
+    const Filter_Profile_t *profile = active_profile;
+
+    for (uint8_t i = 0; i < RANK_FILTER_MAX_WINDOW; i++)
+    {
+        rank_buffer[i] = sample;
+    }
+    rank_index = 0;
+
+    lowpass.alpha = profile->lowpass_alpha;
+    Fixed_IIR1_Reset(&lowpass, Fixed_Q16_From_Int((int32_t)sample));
+
+    if (profile->biquad_stages > 0)
+    {
+        Design_Biquad(sample_rate_hz);
+        arm_biquad_cascade_df1_init_f32(&biquad, profile->biquad_stages, biquad_coefficients, biquad_state);
+        arm_fill_f32((float32_t)sample, biquad_state, profile->biquad_stages * BIQUAD_STATE_PER_STAGE);
+    }
+
+    if (profile->decimation > 1)
+    {
+        arm_fir_decimate_init_f32(&decimator, profile->fir_taps, profile->decimation, profile->fir_coefficients,
+                                  decimator_state, profile->decimation);
+        arm_fill_f32((float32_t)sample, decimator_state, profile->fir_taps + profile->decimation - 1);
+        decimator_fill = 0;
+    }
+
+    filtered_output = sample;
+}
+
+/**
+ * @brief Pass one sample through the active profile's stages.
+ *
+ * @param sample Raw distance in millimeters
+ * @param output Filtered distance in millimeters, when one is produced
+ * @return false while a decimator block is still filling
+ */
+static bool Pipeline_Run(uint32_t sample, uint32_t *output)
+{
+    const Filter_Profile_t *profile = active_profile;
+    float32_t value;
+
+    if (profile->estimator)
+    {
+        *output = (estimator.position_mm > 0.0f) ? (uint32_t)(estimator.position_mm + 0.5f) : 0;
+        filtered_output = *output;
+        return true;
+    }
+
+    if (profile->rank_window > 0)
+    {
+        /* Update rank window; sample order within it does not matter */
+        rank_buffer[rank_index++] = sample;
+        if (rank_index >= profile->rank_window)
+            rank_index = 0;
+
+        if (2 * profile->rank_trim + 1 == profile->rank_window)
         {
-            median_buffer[i] = raw_sample;
+            sample = Rank_Filter_Median(rank_buffer, profile->rank_window);
+        }
+        else
+        {
+            sample = Rank_Filter_Trimmed_Mean(rank_buffer, profile->rank_window, profile->rank_trim);
         }
-        /* Send initial filtered value */
-        xQueueSend(Filtered_Ultrasonic_Queue, &raw_sample, 0);
     }
+    value = (float32_t)sample;
 
-    while (1)
+    if (profile->lowpass_alpha > 0)
+    {
+        value = Fixed_Q16_To_Float(Fixed_IIR1_Step(&lowpass, Fixed_Q16_From_Int((int32_t)sample)));
+    }
+
+    if (profile->biquad_stages > 0)
+    {
+        arm_biquad_cascade_df1_f32(&biquad, &value, &value, 1);
+    }
+
+    if (profile->decimation > 1)
     {
-        if (xQueueReceive(Raw_Ultrasonic_Queue, &raw_sample, portMAX_DELAY) == pdPASS)
+        decimator_input[decimator_fill++] = value;
+        if (decimator_fill < profile->decimation)
         {
-            /* Update median buffer */
-            median_buffer[median_index++] = raw_sample;
-            if (median_index >= MEDIAN_WINDOW_SIZE)
-                median_index = 0;
+            return false;
+        }
+        decimator_fill = 0;
+        arm_fir_decimate_f32(&decimator, decimator_input, &value, profile->decimation);
+    }
 
-            /* Compute median */
-            median_value = median_of_3(median_buffer[0], median_buffer[1], median_buffer[2]);
+    *output = (value > 0.0f) ? (uint32_t)(value + 0.5f) : 0;
+    filtered_output = *output;
+    return true;
+}
 
-            /* Low-pass filter */
-            filtered_value = lowpass(median_value);
+/**
+ * @brief Wait for the ultrasonic driver to publish a new sample and read it.
+ *
+ * Samples that arrive while filtering are coalesced; only the freshest is read.
+ *
+ * @param sample Latest sample, echoed or timed out
+ * @return true if a sample was read
+ */
+static bool Wait_For_Sample(Ultrasonic_Sample_t *sample)
+{
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    return Ultrasonic_Read_Latest(ULTRASONIC_VERTICAL, sample);
+}
 
-            /* Send filtered value to queue */
-            xQueueSend(Filtered_Ultrasonic_Queue, &filtered_value, 0);
-        }
+/**
+ * @brief Select the filter profile, applied from the next sample.
+ *
+ * @param profile Profile to switch to
+ * @return false if the profile does not exist
+ */
+bool Sensor_Filter_Select_Profile(Sensor_Filter_Profile_t profile)
+{
+    if ((uint32_t)profile >= SENSOR_FILTER_PROFILE_COUNT)
+    {
+        return false;
     }
-}
\ No newline at end of file
+    requested_profile = profile;
+    return true;
+}
+
+/**
+ * @brief Most recent raw ultrasonic sample, before filtering.
+ */
+uint32_t Sensor_Filter_Last_Raw(void)
+{
+    return last_raw_sample;
+}
+
+/**
+ * @brief Most recent filtered ultrasonic distance.
+ */
+uint32_t Sensor_Filter_Last_Filtered(void)
+{
+    return filtered_output;
+}
+
+/**
+ * @brief Kalman velocity estimate in millimeters per second.
+ */
+float Sensor_Filter_Velocity(void)
+{
+    return estimate_velocity_mm_s;
+}
+
+/**
+ * @brief Number of samples the Kalman estimator rejected as outliers.
+ */
+uint32_t Sensor_Filter_Rejected_Samples(void)
+{
+    return rejected_samples;
+}
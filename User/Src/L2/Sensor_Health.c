@@ -0,0 +1,255 @@
+/**
+ * @file Sensor_Health.c
+ *
+ * @brief Tracks the quality of the ultrasonic samples and grades the sensor.
+ *
+ * Every sample read, echoed or not, is checked for:
+ * - No echo within the ping timeout
+ * - A distance outside the hoist's travel
+ * - A step from the last good echo faster than the hoist can move in the time since
+ * - A sample interval far from its running mean
+ *
+ * The first three make a sample bad. Over the last 32 samples, too many bad
+ * samples or too many jittered intervals grade the sensor DEGRADED. A run of
+ * consecutive bad samples, or no samples at all, grades it FAILED until a run of
+ * good samples shows it has recovered. The grade is updated on every sample, so
+ * the control loop sees a change within one sample period.
+ *
+ * Only good echoes become the reference for the step check, so a single spike
+ * is one bad sample rather than two. The step allowed grows with the time since
+ * the reference, so after a genuine jump the samples are accepted again once
+ * the hoist could have covered it.
+ */
+
+/* Module Header */
+#include "L2/Sensor_Health.h"
+
+/* Standard Libraries */
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* User Libraries */
+#include "user_main.h"
+#include "Log.h"
+#include "L1/Cycle_Counter.h"
+
+#define SENSOR_HEALTH_DEGRADED_COUNT 4  /* Bad or jittered samples of the last 32 for DEGRADED */
+#define SENSOR_HEALTH_FAILED_RUN 3      /* Consecutive bad samples for FAILED */
+#define SENSOR_HEALTH_RECOVERY_RUN 8    /* Consecutive good samples to leave FAILED */
+#define SENSOR_HEALTH_STALE_MS 100      /* No samples for this long is FAILED */
+#define SENSOR_HEALTH_MIN_MM 20         /* Blind zone of the transducer */
+#define SENSOR_HEALTH_MAX_MM 400        /* Beyond the hoist's travel */
+#define SENSOR_HEALTH_NOISE_MM 10       /* Step allowed on top of the hoist's speed */
+#define SENSOR_HEALTH_MAX_SPEED_MM_S 500.0f
+#define SENSOR_HEALTH_JITTER_SHIFT 3    /* Interval averages weight new intervals by 1/8 */
+#define SENSOR_HEALTH_REFERENCE_MS 1000 /* Step allowed by then exceeds the travel; also well before cycles wrap */
+#define US_PER_S 1000000
+
+static Sensor_Health_Counters_t counters = {0};
+static volatile Sensor_Health_State_t health_state = SENSOR_HEALTH_OK;
+static volatile TickType_t last_update_tick = 0;
+
+static uint32_t bad_history = 0;    /* One bit per sample, newest in bit 0 */
+static uint32_t jitter_history = 0; /* As bad_history, for jittered intervals */
+static uint8_t bad_run = 0;
+static uint8_t good_run = 0;
+
+static bool have_last_echo = false;
+static uint32_t last_echo_cycles; /* Any echo, for the interval */
+static bool have_reference = false;
+static uint32_t reference_cycles; /* Last good echo, for the step check */
+static uint32_t reference_mm;
+static TickType_t reference_tick;
+static int32_t mean_interval_cycles = 0;
+static int32_t jitter_cycles = 0; /* Smoothed absolute deviation from the mean interval */
+
+static bool Check_Echo(const Ultrasonic_Sample_t *sample, uint32_t dropped, bool *jittered);
+static bool Check_Jitter(uint32_t interval_cycles);
+static Sensor_Health_State_t Grade(void);
+
+/**
+ * @brief Check a sample read by the filter task and update the sensor's grade.
+ *
+ * @param sample Sample read, echoed or timed out
+ * @param dropped Samples overwritten since the previous one read
+ */
+void Sensor_Health_Update(const Ultrasonic_Sample_t *sample, uint32_t dropped)
+{
+    Sensor_Health_State_t state;
+    bool jittered = false;
+    bool bad;
+
+    counters.samples++;
+    counters.dropped += dropped;
+
+    if (have_reference && (xTaskGetTickCount() - reference_tick) > pdMS_TO_TICKS(SENSOR_HEALTH_REFERENCE_MS))
+    {
+        have_reference = false;
+    }
+
+    if (sample->flags & ULTRASONIC_SAMPLE_VALID)
+    {
+        bad = Check_Echo(sample, dropped, &jittered);
+    }
+    else
+    {
+        counters.timeouts++;
+        bad = true;
+        have_last_echo = false; /* The interval across a timeout is not jitter */
+    }
+
+    bad_history = (bad_history << 1) | (bad ? 1 : 0);
+    jitter_history = (jitter_history << 1) | (jittered ? 1 : 0);
+    if (bad)
+    {
+        good_run = 0;
+        bad_run = (bad_run < UINT8_MAX) ? bad_run + 1 : bad_run;
+    }
+    else
+    {
+        bad_run = 0;
+        good_run = (good_run < UINT8_MAX) ? good_run + 1 : good_run;
+    }
+
+    state = Grade();
+    if (state != health_state)
+    {
+        if (state == SENSOR_HEALTH_FAILED)
+        {
+            counters.failures++;
+        }
+        health_state = state;
+        LOG("Sensor health %u", state);
+    }
+    last_update_tick = xTaskGetTickCount();
+}
+
+/**
+ * @brief Check an echoed sample against the hoist's travel and speed.
+ *
+ * A good sample becomes the reference for the next step check; a bad one
+ * leaves the reference where it was.
+ *
+ * @param sample Echoed sample
+ * @param dropped Samples overwritten since the previous one read
+ * @param jittered Set if the interval since the previous echo was jittered
+ * @return true if the sample is bad
+ */
+static bool Check_Echo(const Ultrasonic_Sample_t *sample, uint32_t dropped, bool *jittered)
+{
+    bool bad = false;
+
+    if (sample->distance_mm < SENSOR_HEALTH_MIN_MM || sample->distance_mm > SENSOR_HEALTH_MAX_MM)
+    {
+        counters.out_of_range++;
+        bad = true;
+    }
+
+    if (have_reference)
+    {
+        uint32_t elapsed = sample->timestamp_cycles - reference_cycles;
+        float allowed_mm = SENSOR_HEALTH_NOISE_MM + SENSOR_HEALTH_MAX_SPEED_MM_S * Cycle_Counter_To_Seconds(elapsed);
+
+        if (abs((int32_t)sample->distance_mm - (int32_t)reference_mm) > allowed_mm)
+        {
+            counters.rate_violations++;
+            bad = true;
+        }
+    }
+
+    if (have_last_echo)
+    {
+        uint32_t interval = sample->timestamp_cycles - last_echo_cycles;
+
+        /* Intervals spanning dropped samples are not jitter */
+        if (dropped == 0 && Check_Jitter(interval))
+        {
+            counters.jitter_violations++;
+            *jittered = true;
+        }
+    }
+
+    last_echo_cycles = sample->timestamp_cycles;
+    have_last_echo = true;
+
+    if (!bad)
+    {
+        reference_cycles = sample->timestamp_cycles;
+        reference_mm = sample->distance_mm;
+        reference_tick = xTaskGetTickCount();
+        have_reference = true;
+    }
+    return bad;
+}
+
+/**
+ * @brief Track the mean sample interval and its deviation.
+ *
+ * The ping rate follows the echo time, so intervals are judged against their
+ * own running mean rather than a fixed period.
+ *
+ * @param interval_cycles Cycles since the previous echo
+ * @return true if the interval is more than half the mean away from the mean
+ */
+static bool Check_Jitter(uint32_t interval_cycles)
+{
+    int32_t deviation;
+
+    if (mean_interval_cycles == 0)
+    {
+        mean_interval_cycles = (int32_t)interval_cycles;
+        return false;
+    }
+
+    deviation = abs((int32_t)interval_cycles - mean_interval_cycles);
+    jitter_cycles += (deviation - jitter_cycles) >> SENSOR_HEALTH_JITTER_SHIFT;
+    counters.jitter_us = (uint32_t)((uint64_t)jitter_cycles * US_PER_S / SystemCoreClock);
+
+    mean_interval_cycles += ((int32_t)interval_cycles - mean_interval_cycles) >> SENSOR_HEALTH_JITTER_SHIFT;
+    return deviation > mean_interval_cycles / 2;
+}
+
+/**
+ * @brief Grade the sensor from the recent sample history.
+ */
+static Sensor_Health_State_t Grade(void)
+{
+    if (bad_run >= SENSOR_HEALTH_FAILED_RUN ||
+        (health_state == SENSOR_HEALTH_FAILED && good_run < SENSOR_HEALTH_RECOVERY_RUN))
+    {
+        return SENSOR_HEALTH_FAILED;
+    }
+    if (__builtin_popcount(bad_history) >= SENSOR_HEALTH_DEGRADED_COUNT ||
+        __builtin_popcount(jitter_history) >= SENSOR_HEALTH_DEGRADED_COUNT)
+    {
+        return SENSOR_HEALTH_DEGRADED;
+    }
+    return SENSOR_HEALTH_OK;
+}
+
+/**
+ * @brief Current grade of the sensor.
+ *
+ * Reports SENSOR_HEALTH_FAILED if no sample has been read recently, whatever
+ * the last sample showed.
+ */
+Sensor_Health_State_t Sensor_Health_Get_State(void)
+{
+    if ((xTaskGetTickCount() - last_update_tick) > pdMS_TO_TICKS(SENSOR_HEALTH_STALE_MS))
+    {
+        return SENSOR_HEALTH_FAILED;
+    }
+    return health_state;
+}
+
+/**
+ * @brief Copy the sample quality counters.
+ *
+ * @param copy Filled with the counters since startup
+ */
+void Sensor_Health_Get_Counters(Sensor_Health_Counters_t *copy)
+{
+    taskENTER_CRITICAL();
+    *copy = counters;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,87 @@
+/**
+ * @file Telemetry.c
+ *
+ * @brief Streams control-loop state to the Host PC as binary records.
+ *
+ * The control loop hands over a packed record every cycle without blocking or
+ * formatting. This task frames queued records onto the TX ring at low priority.
+ * The divisor selects every Nth control cycle; 0 turns the stream off.
+ */
+
+/* Module Header */
+#include "L2/Telemetry.h"
+
+/* Standard Libraries */
+
+/* User Libraries */
+#include "user_main.h"
+#include "L2/Comm_Datalink.h"
+
+QueueHandle_t Telemetry_Queue;
+
+static volatile uint32_t telemetry_divisor = 0; /* Off until requested by the Host PC */
+static uint32_t telemetry_cycle = 0;
+static volatile uint32_t telemetry_dropped = 0;
+
+_Static_assert(sizeof(Telemetry_Record_t) <= DATALINK_MAX_PAYLOAD, "Telemetry record exceeds frame payload");
+
+/**
+ * @brief Task to frame queued telemetry records for the Host PC.
+ */
+void Telemetry_Task(void *pvParameters)
+{
+    Telemetry_Record_t record;
+
+    while (1)
+    {
+        if (xQueueReceive(Telemetry_Queue, &record, portMAX_DELAY) == pdTRUE)
+        {
+            if (!Datalink_Send_Frame(TELEMETRY_OPCODE_CONTROL_RECORD, &record, sizeof(record)))
+            {
+                telemetry_dropped++;
+            }
+        }
+    }
+    UNUSED(pvParameters);
+}
+
+/**
+ * @brief Queue a control cycle record if it falls on the configured rate.
+ *
+ * Never blocks; records are dropped and counted if the queue is full.
+ *
+ * @param record Record for the current control cycle
+ */
+void Telemetry_Publish(const Telemetry_Record_t *record)
+{
+    uint32_t divisor = telemetry_divisor;
+
+    if (divisor == 0 || ++telemetry_cycle < divisor)
+    {
+        return;
+    }
+    telemetry_cycle = 0;
+
+    if (xQueueSend(Telemetry_Queue, record, 0) != pdTRUE)
+    {
+        telemetry_dropped++;
+    }
+}
+
+/**
+ * @brief Set the telemetry rate.
+ *
+ * @param divisor Send every Nth control cycle, 0 to stop
+ */
+void Telemetry_Set_Divisor(uint32_t divisor)
+{
+    telemetry_divisor = divisor;
+}
+
+/**
+ * @brief Number of records lost to a full queue or TX ring
+ */
+uint32_t Telemetry_Dropped_Records(void)
+{
+    return telemetry_dropped;
+}
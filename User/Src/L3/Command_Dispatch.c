@@ -2,6 +2,15 @@
  * @file Command_Dispatch.c
  *
  * @brief Task for handling PC commands and dispatching them to appropriate modules.
+ *
+ * Console lines are matched by command string and binary frames by opcode. Both
+ * are decoded against the command's argument format before the handler runs:
+ *   'i' int32, 'f' float32, 'b' uint8 (binary) or keyword (console).
+ * Binary payload fields are fixed-width little-endian, 4 bytes for 'i' and 'f'.
+ *
+ * Handlers never block, so up to MESSAGE_POOL_SIZE commands can be in flight.
+ * Commands carrying a sequence number are answered with a Command_Ack_t frame
+ * once executed, letting the Host PC pipeline commands instead of waiting.
  */
 
 /* Module Header */
@@ -10,68 +19,126 @@
 /* Standard Libraries */
 #include <string.h>
 #include <stdlib.h>
+#include <stdbool.h>
 
 /* User Defined Libraries */
 #include "user_main.h"
 #include "L2/Comm_Datalink.h"
+#include "L3/Command_Hash.h"
 #include "L3/Control_Loop.h"
+#include "L3/Gain_Schedule.h"
+#include "L3/PID_Controller.h"
 #include "L5/Mode_Control.h"
+#include "L4/Calibrate_Mode.h"
 #include "L1/PWM_Driver.h"
+#include "L1/USART_Driver.h"
+#include "L2/Telemetry.h"
+#include "L2/Link_Rate.h"
+#include "L2/Sensor_Filter.h"
+#include "L2/Capture.h"
+#include "L2/Sensor_Health.h"
+#include "Log.h"
 
 extern QueueHandle_t Command_Queue;
-extern QueueHandle_t PWM_Queue;
-
-static void change_mode_handler(char arguments[6][16], uint8_t arg_count);
-static void set_setpoint_handler(char arguments[6][16], uint8_t arg_count);
-static void set_horizontal_speed_handler(char arguments[6][16], uint8_t arg_count);
-static void set_vertical_speed_handler(char arguments[6][16], uint8_t arg_count);
-static void toggle_pid_control_handler(char arguments[6][16], uint8_t arg_count);
-static void set_pid_proportional_gain_handler(char arguments[6][16], uint8_t arg_count);
-static void set_pid_integral_gain_handler(char arguments[6][16], uint8_t arg_count);
-static void set_pid_derivative_gain_handler(char arguments[6][16], uint8_t arg_count);
-static void get_pid_gains_handler(char arguments[6][16], uint8_t arg_count);
+
+#define COMMAND_SLOT_EMPTY COMMAND_HASH_EMPTY
+
+/* Handler prototypes */
+#define COMMAND(name, opcode, arg_format, handler) static Command_Status_t handler(const Command_Args_t *args);
+#include "L3/Command_Table.def"
+#undef COMMAND
 
 /* Command Entry Structure */
 typedef struct COMMAND_ENTRY
 {
-    char command_string[16];
-    void (*handler_function)(char arguments[6][16], uint8_t arg_count);
+    const char *command_string;
+    uint8_t opcode;
+    const char *arg_format; /* One character per required argument */
+    Command_Status_t (*handler_function)(const Command_Args_t *args);
 } Command_Entry_t;
 
 /* Command Table */
-Command_Entry_t Command_Table[] = {
-    {"chmd", change_mode_handler},
-    {"spt", set_setpoint_handler},
-    {"hvel", set_horizontal_speed_handler},
-    {"vvel", set_vertical_speed_handler},
-    {"pid", toggle_pid_control_handler},
-    {"pidp", set_pid_proportional_gain_handler},
-    {"pidi", set_pid_integral_gain_handler},
-    {"pidd", set_pid_derivative_gain_handler},
-    {"gpid", get_pid_gains_handler},
+#define COMMAND(name, opcode, arg_format, handler) {#name, opcode, arg_format, handler},
+static const Command_Entry_t Command_Table[] = {
+#include "L3/Command_Table.def"
 };
+#undef COMMAND
+
+enum
+{
+#define COMMAND(name, opcode, arg_format, handler) COMMAND_INDEX_##name,
+#include "L3/Command_Table.def"
+#undef COMMAND
+    COMMAND_COUNT
+};
+
+#define COMMAND(name, opcode, arg_format, handler) \
+    _Static_assert(sizeof(#name) <= COMMAND_KEY_LENGTH + 1, "Command name " #name " is too long");
+#include "L3/Command_Table.def"
+#undef COMMAND
+_Static_assert(COMMAND_COUNT <= COMMAND_HASH_MAX_COMMANDS, "Command indices no longer fit the hash slots");
+
+/* Lookup tables, built once from Command_Table when the task starts */
+static uint64_t command_keys[COMMAND_COUNT];
+static uint8_t command_displacements[COMMAND_HASH_BUCKETS(COMMAND_COUNT)];
+static uint8_t command_slots[COMMAND_HASH_SLOTS(COMMAND_COUNT)]; /* Hash slot to table index */
+static Command_Hash_t command_hash = {.displacements = command_displacements, .slots = command_slots};
+static uint8_t opcode_slots[256];                 /* Opcode to table index */
+
+static const char *const mode_keywords[] = {"manual", "calibrate", "auto"}; /* Control_Mode_t order */
+static const char *const pid_keywords[] = {"off", "on"};
+static const char *const profile_keywords[] = {"legacy", "fast", "smooth", "decimate", "kalman", "robust"}; /* Sensor_Filter_Profile_t order */
+static const char *const capture_keywords[] = {"off", "now", "setpoint", "mode"}; /* Capture_Trigger_t order */
+static const char *const direction_keywords[] = {"up", "down"}; /* Gain_Direction_t order */
+static const char *const tuning_keywords[] = {"off", "zn", "znpi", "tl", "nos"}; /* Autotune_Rule_t order */
+static const char *const tx_policy_keywords[] = {"drop", "block"}; /* TX_Overflow_Policy_t order */
+
+static void Build_Command_Lookup(void);
+static const Command_Entry_t *Find_Command(const Message_t *message);
+static void Send_Ack(const Message_t *message, const Command_Entry_t *entry, Command_Status_t status);
+static bool Decode_Arguments(const Command_Entry_t *entry, const Message_t *message, Command_Args_t *args);
+static int32_t Keyword_Argument(const Command_Args_t *args, uint8_t index, const char *const keywords[],
+                                uint8_t keyword_count);
 
 /**
  * @brief Task to handle PC commands and dispatch them to appropriate modules.
  */
 void Command_Dispatch_Task(void *pvParameters)
 {
-    Message_t Received_Command;
+    Message_t *Received_Command;
+    const Command_Entry_t *entry;
+    Command_Args_t args;
+    Command_Status_t status;
+
+    Build_Command_Lookup();
 
     while (1)
     {
         if (xQueueReceive(Command_Queue, &Received_Command, portMAX_DELAY) == pdTRUE)
         {
             /* Dispatch command to appropriate handler */
-            for (size_t i = 0; i < sizeof(Command_Table) / sizeof(Command_Entry_t); i++)
+            entry = Find_Command(Received_Command);
+            if (entry == NULL)
+            {
+                status = COMMAND_UNKNOWN;
+            }
+            else if (!Decode_Arguments(entry, Received_Command, &args))
+            {
+                status = COMMAND_INVALID_ARGUMENTS;
+            }
+            else
             {
-                if (strcmp(Received_Command.command, Command_Table[i].command_string) == 0)
-                {
-                    /* Call the handler function and pass arguments */
-                    Command_Table[i].handler_function(Received_Command.arguments, Received_Command.arg_count);
-                    break;
-                }
+                /* Call the handler function and pass arguments */
+                status = entry->handler_function(&args);
             }
+
+            if (Received_Command->has_sequence)
+            {
+                Send_Ack(Received_Command, entry, status);
+            }
+
+            /* Arguments reference the message buffer, so release it only once handled */
+            Message_Release(Received_Command);
         }
     }
 
@@ -79,125 +146,246 @@ void Command_Dispatch_Task(void *pvParameters)
 }
 
 /**
- * @brief Handler for the "set_setpoint" command.
+ * @brief Report the outcome of a sequenced command to the Host PC.
  *
- * Sets the vertical position setpoint for the motor control loop.
- * @param arguments Array of argument strings.
- * @param arg_count Number of arguments provided.
+ * @param message Executed message
+ * @param entry Matching table entry, NULL if the command was unknown
+ * @param status Outcome, COMMAND_OK for an ack and anything else for a nack
  */
-static void set_setpoint_handler(char arguments[6][16], uint8_t arg_count)
+static void Send_Ack(const Message_t *message, const Command_Entry_t *entry, Command_Status_t status)
 {
-    if (arg_count < 1)
+    Command_Ack_t ack = {
+        .sequence = message->sequence,
+        .opcode = (entry != NULL) ? entry->opcode : message->opcode,
+        .status = (uint8_t)status,
+        .timestamp_ms = xTaskGetTickCount() * portTICK_PERIOD_MS,
+    };
+
+    if (entry == NULL && message->format == MESSAGE_FORMAT_ASCII)
     {
-        return;
+        ack.opcode = 0; /* Unknown console command has no opcode */
     }
-
-    int32_t new_setpoint = atoi(arguments[0]);
-    Set_Setpoint(new_setpoint);
+    Datalink_Send_Frame(COMMAND_OPCODE_ACK, &ack, sizeof(ack));
 }
 
 /**
- * @brief Handler for the "change_mode" command.
+ * @brief Build the opcode table and the command hash index.
  *
- * Changes the operational mode of the system based on the provided argument.
- *
- * @param arguments Array of argument strings.
- * @param arg_count Number of arguments provided.
+ * The host tests build the index from Command_Table.def with the same code,
+ * so a failure here means they were not run after adding a command.
  */
-static void change_mode_handler(char arguments[6][16], uint8_t arg_count)
+static void Build_Command_Lookup(void)
 {
-    if (arg_count < 1)
+    bool built;
+
+    memset(opcode_slots, COMMAND_SLOT_EMPTY, sizeof(opcode_slots));
+    for (uint8_t i = 0; i < COMMAND_COUNT; i++)
     {
-        return;
+        Command_Pack_Key(Command_Table[i].command_string, &command_keys[i]);
+        configASSERT(opcode_slots[Command_Table[i].opcode] == COMMAND_SLOT_EMPTY); /* Duplicate opcode */
+        opcode_slots[Command_Table[i].opcode] = i;
     }
 
-    if (strcmp(arguments[0], "auto") == 0)
+    built = Command_Hash_Build(&command_hash, command_keys, COMMAND_COUNT);
+    configASSERT(built); /* Duplicate command name */
+    UNUSED(built);
+}
+
+/**
+ * @brief Look up the table entry for a console command string or binary opcode.
+ *
+ * @return Matching entry, or NULL if the command is unknown
+ */
+static const Command_Entry_t *Find_Command(const Message_t *message)
+{
+    uint8_t index;
+    uint64_t key;
+
+    if (message->format == MESSAGE_FORMAT_BINARY)
     {
-        print_str("Changing to AUTO mode.\r\n");
-        Transition_Mode(MODE_AUTOMATIC);
+        index = opcode_slots[message->opcode];
     }
-    else if (strcmp(arguments[0], "manual") == 0)
+    else if (Command_Pack_Key(message->command, &key))
     {
-        print_str("Changing to MANUAL mode.\r\n");
-        Transition_Mode(MODE_MANUAL);
+        index = Command_Hash_Find(&command_hash, key);
+        if (index != COMMAND_SLOT_EMPTY && command_keys[index] != key)
+        {
+            index = COMMAND_SLOT_EMPTY;
+        }
     }
-    else if (strcmp(arguments[0], "calibrate") == 0)
+    else
     {
-        print_str("Changing to CALIBRATION mode.\r\n");
-        Transition_Mode(MODE_CALIBRATION);
+        index = COMMAND_SLOT_EMPTY;
     }
+
+    return (index == COMMAND_SLOT_EMPTY) ? NULL : &Command_Table[index];
 }
 
 /**
- * @brief Handler for the "hv" command.
+ * @brief Decode message arguments against the entry's argument format.
  *
- * Sets the horizontal servo speed.
+ * Console commands need at least as many tokens as the format lists; binary
+ * payloads must match the format's total width exactly.
  *
- * @param arguments Array of argument strings.
- * @param arg_count Number of arguments provided.
+ * @param entry Command table entry
+ * @param message Received message
+ * @param args Decoded arguments
+ * @return true if the arguments match the format
  */
-static void set_horizontal_speed_handler(char arguments[6][16], uint8_t arg_count)
+static bool Decode_Arguments(const Command_Entry_t *entry, const Message_t *message, Command_Args_t *args)
 {
-    if (arg_count < 1)
-    {
-        return;
-    }
-
-    int32_t new_speed = atoi(arguments[0]);
+    size_t count = strlen(entry->arg_format);
+    const uint8_t *cursor = message->payload;
+    uint32_t raw;
 
-    PWM_Duty_Cycle_t pwm_msg;
-    pwm_msg.channel = HORIZONTAL_SERVO_PWM;
-    if (new_speed > 0)
+    if (message->format == MESSAGE_FORMAT_ASCII && message->arg_count < count)
     {
-        pwm_msg.direction = DIRECTION_CLOCKWISE;
+        return false;
     }
-    else if (new_speed < 0)
+
+    for (size_t i = 0; i < count; i++)
     {
-        pwm_msg.direction = DIRECTION_COUNTERCLOCKWISE;
-        new_speed = -new_speed; /* Make speed positive for duty cycle */
+        char type = entry->arg_format[i];
+
+        if (message->format == MESSAGE_FORMAT_ASCII)
+        {
+            args->text[i] = message->arguments[i];
+            if (type == 'f')
+            {
+                args->value[i].f = strtof(message->arguments[i], NULL);
+            }
+            else
+            {
+                args->value[i].i = strtol(message->arguments[i], NULL, 10);
+            }
+            continue;
+        }
+
+        args->text[i] = NULL;
+        if (type == 'b')
+        {
+            if (cursor + 1 > message->payload + message->payload_length)
+            {
+                return false;
+            }
+            args->value[i].i = *cursor++;
+            continue;
+        }
+
+        if (cursor + 4 > message->payload + message->payload_length)
+        {
+            return false;
+        }
+        raw = (uint32_t)cursor[0] | ((uint32_t)cursor[1] << 8) | ((uint32_t)cursor[2] << 16) | ((uint32_t)cursor[3] << 24);
+        cursor += 4;
+        if (type == 'f')
+        {
+            memcpy(&args->value[i].f, &raw, sizeof(float));
+        }
+        else
+        {
+            args->value[i].i = (int32_t)raw;
+        }
     }
-    else
+
+    if (message->format == MESSAGE_FORMAT_BINARY && cursor != message->payload + message->payload_length)
     {
-        pwm_msg.direction = DIRECTION_IDLE;
+        return false;
     }
-    pwm_msg.duty_cycle = (int16_t)new_speed;
-    xQueueSend(PWM_Queue, &pwm_msg, portMAX_DELAY);
+
+    args->count = count;
+    return true;
 }
 
 /**
- * @brief Handler for the "vvel" command.
+ * @brief Resolve a keyword argument to its index.
  *
- * Sets the vertical servo speed.
+ * Console commands give the keyword itself; binary frames give the index directly.
  *
- * @param arguments Array of argument strings.
- * @param arg_count Number of arguments provided.
+ * @return Index into keywords, or -1 if not recognised
  */
-static void set_vertical_speed_handler(char arguments[6][16], uint8_t arg_count)
+static int32_t Keyword_Argument(const Command_Args_t *args, uint8_t index, const char *const keywords[],
+                                uint8_t keyword_count)
 {
-    if (arg_count < 1)
+    if (args->text[index] == NULL)
     {
-        return;
+        return ((uint32_t)args->value[index].i < keyword_count) ? args->value[index].i : -1;
     }
 
-    int32_t new_speed = atoi(arguments[0]);
-
-    PWM_Duty_Cycle_t pwm_msg;
-    pwm_msg.channel = VERTICAL_SERVO_PWM;
-    if (new_speed > 0)
-    {
-        pwm_msg.direction = DIRECTION_CLOCKWISE;
-    }
-    else if (new_speed < 0)
+    for (uint8_t k = 0; k < keyword_count; k++)
     {
-        pwm_msg.direction = DIRECTION_COUNTERCLOCKWISE;
-        new_speed = -new_speed; /* Make speed positive for duty cycle */
+        if (strcmp(args->text[index], keywords[k]) == 0)
+        {
+            return k;
+        }
     }
-    else
+    return -1;
+}
+
+/**
+ * @brief Handler for the "set_setpoint" command.
+ *
+ * Sets the vertical position setpoint for the motor control loop.
+ * @param args Decoded arguments.
+ */
+static Command_Status_t set_setpoint_handler(const Command_Args_t *args)
+{
+    int32_t new_setpoint = args->value[0].i;
+    Set_Setpoint(new_setpoint);
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "change_mode" command.
+ *
+ * Changes the operational mode of the system based on the provided argument.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t change_mode_handler(const Command_Args_t *args)
+{
+    switch (Keyword_Argument(args, 0, mode_keywords, 3))
     {
-        pwm_msg.direction = DIRECTION_IDLE;
+    case MODE_AUTOMATIC:
+        print_str("Changing to AUTO mode.\r\n");
+        Transition_Mode(MODE_AUTOMATIC);
+        break;
+    case MODE_MANUAL:
+        print_str("Changing to MANUAL mode.\r\n");
+        Transition_Mode(MODE_MANUAL);
+        break;
+    case MODE_CALIBRATION:
+        print_str("Changing to CALIBRATION mode.\r\n");
+        Transition_Mode(MODE_CALIBRATION);
+        break;
+    default:
+        return COMMAND_INVALID_ARGUMENTS;
     }
-    pwm_msg.duty_cycle = (int16_t)new_speed;
-    xQueueSend(PWM_Queue, &pwm_msg, portMAX_DELAY);
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "hv" command.
+ *
+ * Sets the horizontal servo speed.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t set_horizontal_speed_handler(const Command_Args_t *args)
+{
+    return PWM_Request_Speed(HORIZONTAL_SERVO_PWM, args->value[0].i) ? COMMAND_OK : COMMAND_BUSY;
+}
+
+/**
+ * @brief Handler for the "vvel" command.
+ *
+ * Sets the vertical servo speed.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t set_vertical_speed_handler(const Command_Args_t *args)
+{
+    return PWM_Request_Speed(VERTICAL_SERVO_PWM, args->value[0].i) ? COMMAND_OK : COMMAND_BUSY;
 }
 
 /**
@@ -205,26 +393,27 @@ static void set_vertical_speed_handler(char arguments[6][16], uint8_t arg_count)
  *
  * Enables or disables the PID control loop.
  *
- * @param arguments Array of argument strings.
- * @param arg_count Number of arguments provided.
+ * @param args Decoded arguments.
  */
-static void toggle_pid_control_handler(char arguments[6][16], uint8_t arg_count)
+static Command_Status_t toggle_pid_control_handler(const Command_Args_t *args)
 {
-    if (arg_count < 1)
-    {
-        return;
-    }
+    int32_t state = Keyword_Argument(args, 0, pid_keywords, 2);
 
-    if (strcmp(arguments[0], "on") == 0)
+    if (state == 1)
     {
         Toggle_PID_Control(true);
         print_str("PID control enabled.\r\n");
     }
-    else if (strcmp(arguments[0], "off") == 0)
+    else if (state == 0)
     {
         Toggle_PID_Control(false);
         print_str("PID control disabled.\r\n");
     }
+    else
+    {
+        return COMMAND_INVALID_ARGUMENTS;
+    }
+    return COMMAND_OK;
 }
 
 /**
@@ -232,19 +421,17 @@ static void toggle_pid_control_handler(char arguments[6][16], uint8_t arg_count)
  *
  * Sets the proportional gain for the PID controller.
  *
- * @param arguments Array of argument strings.
- * @param arg_count Number of arguments provided.
+ * @param args Decoded arguments.
  */
-static void set_pid_proportional_gain_handler(char arguments[6][16], uint8_t arg_count)
+static Command_Status_t set_pid_proportional_gain_handler(const Command_Args_t *args)
 {
-    if (arg_count < 1)
+    float Kp = args->value[0].f;
+    if (!Set_Proportional_Gain(Kp))
     {
-        return;
+        return COMMAND_INVALID_ARGUMENTS;
     }
-
-    float Kp = atof(arguments[0]);
-    Set_Proportional_Gain(Kp);
     print_str("PID proportional gain updated.\r\n");
+    return COMMAND_OK;
 }
 
 /**
@@ -252,19 +439,17 @@ static void set_pid_proportional_gain_handler(char arguments[6][16], uint8_t arg
  *
  * Sets the integral gain for the PID controller.
  *
- * @param arguments Array of argument strings.
- * @param arg_count Number of arguments provided.
+ * @param args Decoded arguments.
  */
-static void set_pid_integral_gain_handler(char arguments[6][16], uint8_t arg_count)
+static Command_Status_t set_pid_integral_gain_handler(const Command_Args_t *args)
 {
-    if (arg_count < 1)
+    float Ki = args->value[0].f;
+    if (!Set_Integral_Gain(Ki))
     {
-        return;
+        return COMMAND_INVALID_ARGUMENTS;
     }
-
-    float Ki = atof(arguments[0]);
-    Set_Integral_Gain(Ki);
     print_str("PID integral gain updated.\r\n");
+    return COMMAND_OK;
 }
 
 /**
@@ -272,19 +457,17 @@ static void set_pid_integral_gain_handler(char arguments[6][16], uint8_t arg_cou
  *
  * Sets the derivative gain for the PID controller.
  *
- * @param arguments Array of argument strings.
- * @param arg_count Number of arguments provided.
+ * @param args Decoded arguments.
  */
-static void set_pid_derivative_gain_handler(char arguments[6][16], uint8_t arg_count)
+static Command_Status_t set_pid_derivative_gain_handler(const Command_Args_t *args)
 {
-    if (arg_count < 1)
+    float Kd = args->value[0].f;
+    if (!Set_Derivative_Gain(Kd))
     {
-        return;
+        return COMMAND_INVALID_ARGUMENTS;
     }
-
-    float Kd = atof(arguments[0]);
-    Set_Derivative_Gain(Kd);
     print_str("PID derivative gain updated.\r\n");
+    return COMMAND_OK;
 }
 
 /**
@@ -292,10 +475,410 @@ static void set_pid_derivative_gain_handler(char arguments[6][16], uint8_t arg_c
  *
  * Retrieves and prints the current PID gains.
  *
- * @param arguments Array of argument strings.
- * @param arg_count Number of arguments provided.
+ * @param args Decoded arguments.
  */
-static void get_pid_gains_handler(char arguments[6][16], uint8_t arg_count)
+static Command_Status_t get_pid_gains_handler(const Command_Args_t *args)
 {
     Print_PID_Gains();
-}
\ No newline at end of file
+    UNUSED(args);
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "tlm" command.
+ *
+ * Sets the telemetry rate as every Nth control cycle, or 0 to stop.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t set_telemetry_rate_handler(const Command_Args_t *args)
+{
+    Telemetry_Set_Divisor(args->value[0].i < 0 ? 0 : (uint32_t)args->value[0].i);
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "mbus" command.
+ *
+ * Hands the Host PC link to the Modbus RTU server. Writing 0 to the link mode
+ * holding register returns it to the console. No ack is sent once switched.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t enter_modbus_handler(const Command_Args_t *args)
+{
+    print_str("Switching to Modbus RTU.\r\n");
+    HostPC_Set_Link_Mode(HOSTPC_LINK_MODBUS);
+    UNUSED(args);
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "baud" command.
+ *
+ * Starts a baud rate switch, confirmed by "baudok" at the new rate. A rate of 0
+ * reports the current and highest rates instead.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t set_baud_rate_handler(const Command_Args_t *args)
+{
+    if (args->value[0].i == 0)
+    {
+        LOG("Host link at %lu baud, limit %lu", Link_Rate_Current(), HostPC_Max_Baud_Rate());
+        return COMMAND_OK;
+    }
+    if (Link_Rate_Switch_Pending())
+    {
+        return COMMAND_BUSY;
+    }
+    return Link_Rate_Request((uint32_t)args->value[0].i) ? COMMAND_OK : COMMAND_INVALID_ARGUMENTS;
+}
+
+/**
+ * @brief Handler for the "baudok" command.
+ *
+ * Keeps the new baud rate; without it the link reverts after a timeout.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t confirm_baud_rate_handler(const Command_Args_t *args)
+{
+    Link_Rate_Confirm();
+    UNUSED(args);
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "filt" command.
+ *
+ * Selects the sensor filter pipeline, by name or Sensor_Filter_Profile_t value.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t set_filter_profile_handler(const Command_Args_t *args)
+{
+    int32_t profile = Keyword_Argument(args, 0, profile_keywords, SENSOR_FILTER_PROFILE_COUNT);
+
+    if (profile < 0)
+    {
+        return COMMAND_INVALID_ARGUMENTS;
+    }
+    Sensor_Filter_Select_Profile((Sensor_Filter_Profile_t)profile);
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "cap" command.
+ *
+ * Arms the capture recorder to start on the given event, or stops it with "off".
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t arm_capture_handler(const Command_Args_t *args)
+{
+    int32_t trigger = Keyword_Argument(args, 0, capture_keywords, CAPTURE_TRIGGER_COUNT);
+
+    if (trigger < 0)
+    {
+        return COMMAND_INVALID_ARGUMENTS;
+    }
+    Capture_Arm((Capture_Trigger_t)trigger);
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "capdump" command.
+ *
+ * Sends the held capture to the Host PC as binary frames.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t dump_capture_handler(const Command_Args_t *args)
+{
+    UNUSED(args);
+    return Capture_Start_Dump() ? COMMAND_OK : COMMAND_BUSY;
+}
+
+/**
+ * @brief Handler for the "health" command.
+ *
+ * Logs the sensor's grade and sample quality counters since startup.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t get_sensor_health_handler(const Command_Args_t *args)
+{
+    Sensor_Health_Counters_t counters;
+
+    Sensor_Health_Get_Counters(&counters);
+    LOG("Sensor health %u, %lu failures, %lu samples, %lu dropped", Sensor_Health_Get_State(), counters.failures,
+        counters.samples, counters.dropped);
+    LOG("Timeouts %lu, out of range %lu, rate violations %lu", counters.timeouts, counters.out_of_range,
+        counters.rate_violations);
+    LOG("Jitter violations %lu, jitter %lu us", counters.jitter_violations, counters.jitter_us);
+    UNUSED(args);
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "ctlhz" command.
+ *
+ * Sets the fixed rate of the control loop, from the next tick.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t set_control_rate_handler(const Command_Args_t *args)
+{
+    if (args->value[0].i < 0 || !Control_Loop_Set_Rate((uint32_t)args->value[0].i))
+    {
+        return COMMAND_INVALID_ARGUMENTS;
+    }
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "ctlstat" command.
+ *
+ * Logs the control loop timing since the previous "ctlstat" and restarts it.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t get_control_stats_handler(const Command_Args_t *args)
+{
+    Control_Loop_Stats_t stats;
+
+    Control_Loop_Take_Stats(&stats);
+    LOG("Control loop %lu Hz, %lu cycles, %lu overruns", stats.rate_hz, stats.cycles, stats.overruns);
+    LOG("Period %lu to %lu us, latency max %lu us, execution max %lu us", stats.period_min_us, stats.period_max_us,
+        stats.latency_max_us, stats.execution_max_us);
+    UNUSED(args);
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "traj" command.
+ *
+ * Sets the velocity, acceleration and jerk limits of vertical moves.
+ * A velocity of 0 steps straight to each setpoint.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t set_trajectory_handler(const Command_Args_t *args)
+{
+    if (!Set_Trajectory_Limits(args->value[0].f, args->value[1].f, args->value[2].f))
+    {
+        return COMMAND_INVALID_ARGUMENTS;
+    }
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "pidf" command.
+ *
+ * Sets the feedforward gain on the trajectory velocity.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t set_pid_feedforward_gain_handler(const Command_Args_t *args)
+{
+    float Kff = args->value[0].f;
+    if (!Set_Feedforward_Gain(Kff))
+    {
+        return COMMAND_INVALID_ARGUMENTS;
+    }
+    print_str("PID feedforward gain updated.\r\n");
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "gain" command.
+ *
+ * Sets Kp, Ki and Kd at one gain schedule point for one direction of travel.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t set_gains_handler(const Command_Args_t *args)
+{
+    int32_t direction = Keyword_Argument(args, 0, direction_keywords, GAIN_DIRECTION_COUNT);
+    Gain_Set_t gains;
+
+    if (direction < 0 || (uint32_t)args->value[1].i >= GAIN_SCHEDULE_POINTS)
+    {
+        return COMMAND_INVALID_ARGUMENTS;
+    }
+    Gain_Schedule_Get_Entry((Gain_Direction_t)direction, (uint8_t)args->value[1].i, &gains);
+    gains.Kp = args->value[2].f;
+    gains.Ki = args->value[3].f;
+    gains.Kd = args->value[4].f;
+    if (!Gain_Schedule_Set_Entry((Gain_Direction_t)direction, (uint8_t)args->value[1].i, &gains))
+    {
+        return COMMAND_INVALID_ARGUMENTS;
+    }
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "gainff" command.
+ *
+ * Sets the velocity feedforward gain and constant output offset at one gain
+ * schedule point for one direction of travel.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t set_gain_feedforward_handler(const Command_Args_t *args)
+{
+    int32_t direction = Keyword_Argument(args, 0, direction_keywords, GAIN_DIRECTION_COUNT);
+    Gain_Set_t gains;
+
+    if (direction < 0 || (uint32_t)args->value[1].i >= GAIN_SCHEDULE_POINTS)
+    {
+        return COMMAND_INVALID_ARGUMENTS;
+    }
+    Gain_Schedule_Get_Entry((Gain_Direction_t)direction, (uint8_t)args->value[1].i, &gains);
+    gains.Kff = args->value[2].f;
+    gains.offset = args->value[3].f;
+    if (!Gain_Schedule_Set_Entry((Gain_Direction_t)direction, (uint8_t)args->value[1].i, &gains))
+    {
+        return COMMAND_INVALID_ARGUMENTS;
+    }
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "gainpt" command.
+ *
+ * Moves one gain schedule point. Points must stay in increasing order.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t set_gain_point_handler(const Command_Args_t *args)
+{
+    if ((uint32_t)args->value[0].i >= GAIN_SCHEDULE_POINTS || !Gain_Schedule_Set_Point((uint8_t)args->value[0].i, args->value[1].f))
+    {
+        return COMMAND_INVALID_ARGUMENTS;
+    }
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "gains" command.
+ *
+ * Logs the position and gains of one gain schedule point.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t get_gain_point_handler(const Command_Args_t *args)
+{
+    uint8_t point = (uint8_t)args->value[0].i;
+    Gain_Set_t gains;
+    float position_mm;
+
+    if ((uint32_t)args->value[0].i >= GAIN_SCHEDULE_POINTS)
+    {
+        return COMMAND_INVALID_ARGUMENTS;
+    }
+    Gain_Schedule_Get_Point(point, &position_mm);
+
+    LOG("Gain point %lu at %.1f mm", (uint32_t)point, position_mm);
+    for (uint8_t direction = 0; direction < GAIN_DIRECTION_COUNT; direction++)
+    {
+        Gain_Schedule_Get_Entry((Gain_Direction_t)direction, point, &gains);
+        LOG("Direction %lu Kp %.2f Ki %.2f Kd %.2f", (uint32_t)direction, gains.Kp, gains.Ki, gains.Kd);
+        LOG("Direction %lu Kff %.3f offset %.2f", (uint32_t)direction, gains.Kff, gains.offset);
+    }
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "tune" command.
+ *
+ * Selects the tuning rule for a relay autotune at the start of the next
+ * calibration, or "off" to calibrate with the current gains.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t set_autotune_handler(const Command_Args_t *args)
+{
+    int32_t rule = Keyword_Argument(args, 0, tuning_keywords, AUTOTUNE_RULE_COUNT);
+
+    if (rule < 0)
+    {
+        return COMMAND_INVALID_ARGUMENTS;
+    }
+    Set_Autotune_Rule((Autotune_Rule_t)rule);
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "pidbench" command.
+ *
+ * Logs the cycles per step of the PID controller against the original
+ * PID_Compute it replaced.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t benchmark_pid_handler(const Command_Args_t *args)
+{
+    uint32_t reference_cycles;
+    uint32_t cmsis_cycles;
+
+    PID_Controller_Benchmark(&reference_cycles, &cmsis_cycles);
+    LOG("PID step: original %lu cycles, CMSIS %lu cycles", reference_cycles, cmsis_cycles);
+    UNUSED(args);
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "txpol" command.
+ *
+ * Selects whether messages that do not fit the host link's TX ring are dropped
+ * or wait for space.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t set_tx_policy_handler(const Command_Args_t *args)
+{
+    int32_t policy = Keyword_Argument(args, 0, tx_policy_keywords, 2);
+
+    if (policy < 0)
+    {
+        return COMMAND_INVALID_ARGUMENTS;
+    }
+    HostPC_Set_TX_Policy((TX_Overflow_Policy_t)policy);
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "linkstat" command.
+ *
+ * Logs the host link's transmit counters and the received bytes dropped
+ * because the datalink fell behind.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t get_link_stats_handler(const Command_Args_t *args)
+{
+    HostPC_TX_Stats_t tx_stats;
+
+    HostPC_Get_TX_Stats(&tx_stats);
+    LOG("Link TX %lu bytes queued, %lu dropped in %lu overflows, high water %lu bytes", tx_stats.bytes_queued,
+        tx_stats.bytes_dropped, tx_stats.overflow_events, tx_stats.high_water);
+    LOG("Link RX %lu bytes dropped", HostPC_RX_Dropped_Bytes());
+    UNUSED(args);
+    return COMMAND_OK;
+}
+
+/**
+ * @brief Handler for the "stacks" command.
+ *
+ * Prints the unused stack of every startup task, to size the stacks from.
+ *
+ * @param args Decoded arguments.
+ */
+static Command_Status_t get_task_stacks_handler(const Command_Args_t *args)
+{
+    Print_Task_Stacks();
+    UNUSED(args);
+    return COMMAND_OK;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file Command_Hash.c
+ *
+ * @brief Builds the hash and displace command index.
+ *
+ * Buckets are placed largest first, while most slots are still free, each
+ * taking the first displacement that puts every one of its keys in an empty
+ * slot. The build has no RTOS or HAL dependencies, so the host tests run it on
+ * the registered table and on synthetic tables of other sizes.
+ */
+
+/* Module Header */
+#include "L3/Command_Hash.h"
+
+/* Standard Libraries */
+#include <string.h>
+
+#define COMMAND_HASH_DISPLACEMENTS 256 /* Every value of a uint8_t */
+
+static uint8_t Bucket_Size(const uint64_t *keys, uint8_t count, uint32_t bucket, uint8_t slot_bits);
+static bool Place_Bucket(Command_Hash_t *hash, const uint64_t *keys, uint8_t count, uint32_t bucket);
+
+/**
+ * @brief Build a collision-free index of packed command keys.
+ *
+ * @param hash Index to fill; displacements and slots must hold
+ *             COMMAND_HASH_BUCKETS(count) and COMMAND_HASH_SLOTS(count) entries
+ * @param keys Packed keys, all different
+ * @param count Number of keys, at most COMMAND_HASH_MAX_COMMANDS
+ * @return false if some bucket could not be placed, or the keys repeat
+ */
+bool Command_Hash_Build(Command_Hash_t *hash, const uint64_t *keys, uint8_t count)
+{
+    uint8_t slot_bits = COMMAND_HASH_BITS(count);
+    uint32_t buckets = 1u << (slot_bits - 2);
+    uint8_t largest = 0;
+    uint8_t size;
+
+    if (count > COMMAND_HASH_MAX_COMMANDS)
+    {
+        return false;
+    }
+    hash->slot_bits = slot_bits;
+    memset(hash->displacements, 0, buckets);
+    memset(hash->slots, COMMAND_HASH_EMPTY, 1u << slot_bits);
+
+    for (uint32_t bucket = 0; bucket < buckets; bucket++)
+    {
+        size = Bucket_Size(keys, count, bucket, slot_bits);
+        largest = (size > largest) ? size : largest;
+    }
+
+    for (size = largest; size > 0; size--)
+    {
+        for (uint32_t bucket = 0; bucket < buckets; bucket++)
+        {
+            if (Bucket_Size(keys, count, bucket, slot_bits) == size && !Place_Bucket(hash, keys, count, bucket))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Number of keys hashing to a bucket.
+ */
+static uint8_t Bucket_Size(const uint64_t *keys, uint8_t count, uint32_t bucket, uint8_t slot_bits)
+{
+    uint8_t size = 0;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        size += (Command_Hash_Bucket(Command_Hash_Fold(keys[i]), slot_bits) == bucket);
+    }
+    return size;
+}
+
+/**
+ * @brief Find a displacement that puts every key of a bucket in an empty slot.
+ *
+ * @return false if no displacement fits
+ */
+static bool Place_Bucket(Command_Hash_t *hash, const uint64_t *keys, uint8_t count, uint32_t bucket)
+{
+    for (uint32_t displacement = 0; displacement < COMMAND_HASH_DISPLACEMENTS; displacement++)
+    {
+        uint8_t placed = 0;
+
+        while (placed < count)
+        {
+            uint32_t folded = Command_Hash_Fold(keys[placed]);
+            uint32_t slot;
+
+            if (Command_Hash_Bucket(folded, hash->slot_bits) == bucket)
+            {
+                slot = Command_Hash_Slot(folded, (uint8_t)displacement, hash->slot_bits);
+                if (hash->slots[slot] != COMMAND_HASH_EMPTY)
+                {
+                    break;
+                }
+                hash->slots[slot] = placed;
+            }
+            placed++;
+        }
+
+        if (placed == count)
+        {
+            hash->displacements[bucket] = (uint8_t)displacement;
+            return true;
+        }
+
+        /* Take this bucket's keys back out before the next displacement */
+        for (uint8_t i = 0; i < placed; i++)
+        {
+            uint32_t folded = Command_Hash_Fold(keys[i]);
+
+            if (Command_Hash_Bucket(folded, hash->slot_bits) == bucket)
+            {
+                hash->slots[Command_Hash_Slot(folded, (uint8_t)displacement, hash->slot_bits)] = COMMAND_HASH_EMPTY;
+            }
+        }
+    }
+    return false;
+}
@@ -3,8 +3,14 @@
  *
  * @brief Implements closed-loop control for the automated warehouse crane.
  * Takes sensor inputs and adjusts motor outputs to maintain desired positions.
- * Uses PID control algorithms for precise movement.
+ * Uses PID control algorithms for precise movement, see PID_Controller.c.
  * Clamps motor commands to required safety limits.
+ * Runs at a fixed rate paced by a hardware timer, and tracks its own period,
+ * latency, execution time and overruns.
+ * Setpoint changes are followed along a jerk-limited trajectory, with the
+ * reference velocity fed forward to the output.
+ * Gains are scheduled on the reference position and direction of travel.
+ * During a relay autotune experiment the relay drives the hoist instead.
  */
 
 /* Module Header */
@@ -12,48 +18,82 @@
 
 /* Standard Libraries */
 #include <math.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 
 /* User Libraries */
 #include "user_main.h"
+#include "Log.h"
 #include "L1/PWM_Driver.h"
+#include "L1/Cycle_Counter.h"
+#include "L1/Control_Timer.h"
+#include "L2/Sensor_Filter.h"
+#include "L2/Telemetry.h"
+#include "L2/Capture.h"
+#include "L2/Sensor_Health.h"
+#include "L3/Trajectory.h"
+#include "L3/Gain_Schedule.h"
+#include "L3/Relay_Autotune.h"
+#include "L3/PID_Controller.h"
+#include "L5/Mode_Control.h"
 #include "Control_Loop.h"
 
-#define PWM_MAX 35.0f  /* Max pulse width adjustment for PWM */
-#define PWM_MIN -35.0f /* Min pulse width adjustment for PWM */
+#define PWM_MAX 35.0f /* Max pulse width adjustment for PWM */
 #define SETPOINT_MIN_MM 30.0f
 #define SETPOINT_MAX_MM 140.0f
 
-#define PID_ANTI_WINDUP_LIMIT 50.0f
+#define PID_DERIVATIVE_FILTER_S 0.02f /* Smooths the steps in estimated velocity as each new sample lands */
+#define PWM_DEGRADED_LIMIT 15.0f /* Pulse width adjustment limit while the sensor is degraded */
 #define DEADZONE_MM 4.0f
+#define DIRECTION_VELOCITY_MM_S 1.0f /* Reference speed that decides the direction of travel */
 
-#define GRAVITY_COMPENSATION 0.7f
-
-#define ULTRASONIC_SAMPLE_RATE_MS 30
+#define CONTROL_LOOP_DEFAULT_RATE_HZ 200
+#define MAX_EXTRAPOLATION_S 0.1f /* Longest extrapolation past the last sample */
 #define STARTUP_SETPOINT_MM 100
-
-typedef struct
-{
-    float Kp;
-    float Ki;
-    float Kd;
-    float previous_error;
-    float integral;
-    float output_limit;
-} PID_Controller_t;
+#define GAIN_PRINT_LIMIT 1000000.0f /* Largest gain printed as a number; its hundredths fit a long */
 
 extern QueueHandle_t Filtered_Ultrasonic_Queue;
-extern QueueHandle_t PWM_Queue;
 QueueHandle_t Motor_Setpoint_Queue;
 EventGroupHandle_t Motor_Event_Group;
 
 static int32_t vertical_position_setpoint_mm = STARTUP_SETPOINT_MM;
 static volatile bool control_loop_enabled = false;
+static volatile uint32_t missed_samples = 0;
+static float peak_output = 0.0f; /* Largest output magnitude since last taken */
 
-PID_Controller_t vertical_pid = {
-    .Kp = 10.0f, .Ki = 0.0f, .Kd = 0.0f, .previous_error = 0.0f, .integral = 0.0f}; /* Proportional only due to non-linearities */
-
-static float PID_Compute(PID_Controller_t *pid, float error, float dT);
+/* Cycle timing, in DWT cycles */
+static struct
+{
+    uint32_t cycles;
+    uint32_t overruns;
+    uint32_t period_min;
+    uint32_t period_max;
+    uint32_t latency_max;
+    uint32_t execution_max;
+} timing;
+static uint32_t last_start_cycles;
+static bool have_last_start = false;
+
+static PID_Controller_t vertical_pid;
+
+static Trajectory_t vertical_trajectory = {.max_velocity_mm_s = 80.0f,
+                                           .max_acceleration_mm_s2 = 300.0f,
+                                           .max_jerk_mm_s3 = 3000.0f,
+                                           .position_mm = STARTUP_SETPOINT_MM};
+static Gain_Direction_t vertical_direction = GAIN_DIRECTION_DOWN;
+
+static void Control_Cycle(const Filtered_Sample_t *sample, bool fresh, Sensor_Health_State_t health);
+static float Track_Setpoint(float setpoint_mm, float position_mm, float velocity_mm_s, float dT);
+static Gain_Direction_t Travel_Direction(float reference_velocity, float error);
+static bool Set_Scheduled_Gain(size_t term, float value);
+static size_t Format_Gain(char *buffer, size_t size, size_t length, const char *name, float gain);
+static void Record_Tick(uint32_t ticks, uint32_t start_cycles);
+static void Record_Execution(uint32_t start_cycles);
+static void Reset_Timing_Stats(void);
+static void Publish_Telemetry(const Filtered_Sample_t *sample, const PWM_Duty_Cycle_t *pwm_msg);
+static void Record_Capture(const Filtered_Sample_t *sample, const PWM_Duty_Cycle_t *pwm_msg);
+static void Stop_Vertical_Motor(bool *stopped);
 
 /**
  * @brief Task to update desired motor setpoint from queue.
@@ -65,6 +105,10 @@ void Update_Motor_Setpoint_Task(void *pvParameters)
     {
         if (xQueueReceive(Motor_Setpoint_Queue, &new_setpoint, portMAX_DELAY) == pdTRUE)
         {
+            if ((int32_t)new_setpoint != vertical_position_setpoint_mm)
+            {
+                Capture_Trigger(CAPTURE_TRIGGER_SETPOINT);
+            }
             vertical_position_setpoint_mm = new_setpoint;
         }
     }
@@ -73,101 +117,366 @@ void Update_Motor_Setpoint_Task(void *pvParameters)
 
 /**
  * @brief Control loop task to maintain crane position using PID control.
+ *
+ * Runs once per control timer tick at a fixed rate, independent of the sensor.
+ * The latest filtered sample is taken without waiting; between samples the
+ * position is extrapolated along the estimated velocity. The trajectory restarts
+ * from the measured position whenever control resumes.
  */
 void Control_Loop_Task(void *pvParameters)
 {
+    Filtered_Sample_t sample;
+    uint32_t ticks;
+    uint32_t start_cycles;
+    Sensor_Health_State_t health;
+    bool fresh;
+    bool have_sample = false;
+    bool stopped = false;
+    bool tracking = false; /* Trajectory follows on from the previous cycle */
+    bool started;
+
     Motor_Event_Group = xEventGroupCreate();
+    PID_Controller_Init(&vertical_pid, PWM_MAX, PID_DERIVATIVE_FILTER_S);
+    Reset_Timing_Stats();
+    started = Control_Timer_Start(CONTROL_LOOP_DEFAULT_RATE_HZ, xTaskGetCurrentTaskHandle());
+    configASSERT(started); /* Without the tick the loop would never run */
+
     while (1)
     {
-        int32_t current_position_mm;
+        /* One notification per tick; a count above one means ticks were missed */
+        ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        start_cycles = Cycle_Counter_Now();
+        Record_Tick(ticks, start_cycles);
+
+        /* Always drain the queue, so the first sample after enabling is fresh */
+        fresh = (xQueueReceive(Filtered_Ultrasonic_Queue, &sample, 0) == pdTRUE);
 
         if (!control_loop_enabled)
         {
-            vTaskDelay(pdMS_TO_TICKS(10));
+            have_sample = false;
+            stopped = false;
+            tracking = false;
             continue;
         }
 
-        /* Read filtered ultrasonic distance */
-        if (xQueueReceive(Filtered_Ultrasonic_Queue, &current_position_mm, pdMS_TO_TICKS(ULTRASONIC_SAMPLE_RATE_MS)) == pdTRUE)
+        if (fresh)
         {
-            float error = (float)(vertical_position_setpoint_mm - current_position_mm);
-            float control_output = PID_Compute(&vertical_pid, error, ULTRASONIC_SAMPLE_RATE_MS / 1000.0f);
-            control_output = -control_output; /* Invert control output for motor direction */
-
-            /* Signal Setpoint Reached */
-            if (fabsf(error) < DEADZONE_MM)
+            have_sample = true;
+            if (sample.flags & SENSOR_SAMPLE_AFTER_MISSED)
             {
-                xEventGroupSetBits(Motor_Event_Group, MOTOR_EVENT_BIT);
+                missed_samples++;
             }
+        }
 
-            /* Prepare PWM message */
-            PWM_Duty_Cycle_t pwm_msg;
-            if (control_output < 0)
-            {
-                pwm_msg.direction = DIRECTION_COUNTERCLOCKWISE;
-                control_output = -control_output; /* Make positive for duty cycle */
-            }
-            else if (control_output > 0)
-            {
-                pwm_msg.direction = DIRECTION_CLOCKWISE;
-            }
-            else
+        /* Never drive on a failed sensor, including when no samples arrive at all */
+        health = Sensor_Health_Get_State();
+        if (health == SENSOR_HEALTH_FAILED)
+        {
+            Stop_Vertical_Motor(&stopped);
+            tracking = false;
+        }
+        else if (have_sample)
+        {
+            if (!tracking)
             {
-                pwm_msg.direction = DIRECTION_IDLE;
+                PID_Controller_Reset(&vertical_pid);
+                Trajectory_Reset(&vertical_trajectory, (float)sample.distance_mm);
+                tracking = true;
             }
-            pwm_msg.channel = VERTICAL_SERVO_PWM;
-            pwm_msg.duty_cycle = (int16_t)control_output; /* Control output directly maps to pulse width adjustment */
-            /* Send PWM command */
-            xQueueSend(PWM_Queue, &pwm_msg, portMAX_DELAY);
+            Control_Cycle(&sample, fresh, health);
+            stopped = false;
         }
+
+        Record_Execution(start_cycles);
     }
 
     UNUSED(pvParameters);
 }
 
 /**
- * @brief Calculate PID control output.
- * @param pid Pointer to PID controller structure
- * @param setpoint Desired target value
- * @param measured Current measured value
- * @return Control output
+ * @brief Run the PID controller, or the autotune relay, once and command the vertical servo.
+ *
+ * @param sample Latest filtered sample
+ * @param fresh true if the sample arrived since the previous cycle
+ * @param health Current sensor grade, not SENSOR_HEALTH_FAILED
  */
-static float PID_Compute(PID_Controller_t *pid, float error, float dT)
+static void Control_Cycle(const Filtered_Sample_t *sample, bool fresh, Sensor_Health_State_t health)
 {
-    float proportional;
-    float derivative;
-    float output;
+    float dT = 1.0f / (float)Control_Timer_Rate();
+    /* Extrapolates the selected profile's output rather than the Kalman position, so the profile choice holds */
+    float velocity = Sensor_Filter_Velocity();
+    float age = fminf(Cycle_Counter_To_Seconds(Cycle_Counter_Now() - sample->timestamp_cycles), MAX_EXTRAPOLATION_S);
+    float position_mm = (float)sample->distance_mm + velocity * age;
+
+    float setpoint_mm = (float)vertical_position_setpoint_mm;
+    float control_output;
+
+    if (Relay_Autotune_Running())
+    {
+        /* The PID resumes at rest on the setpoint once the experiment ends */
+        control_output = Relay_Autotune_Step(setpoint_mm - position_mm, dT);
+        Trajectory_Reset(&vertical_trajectory, setpoint_mm);
+        PID_Controller_Reset(&vertical_pid);
+    }
+    else
+    {
+        control_output = Track_Setpoint(setpoint_mm, position_mm, velocity, dT);
+    }
+
+    if (health == SENSOR_HEALTH_DEGRADED)
+    {
+        /* A degraded sensor only drives slowly */
+        control_output = fmaxf(-PWM_DEGRADED_LIMIT, fminf(PWM_DEGRADED_LIMIT, control_output));
+    }
+    taskENTER_CRITICAL();
+    peak_output = fmaxf(peak_output, fabsf(control_output));
+    taskEXIT_CRITICAL();
+    control_output = -control_output; /* Invert control output for motor direction */
+
+    /* Prepare PWM message */
+    PWM_Duty_Cycle_t pwm_msg;
+    if (control_output < 0)
+    {
+        pwm_msg.direction = DIRECTION_COUNTERCLOCKWISE;
+        control_output = -control_output; /* Make positive for duty cycle */
+    }
+    else if (control_output > 0)
+    {
+        pwm_msg.direction = DIRECTION_CLOCKWISE;
+    }
+    else
+    {
+        pwm_msg.direction = DIRECTION_IDLE;
+    }
+    pwm_msg.channel = VERTICAL_SERVO_PWM;
+    pwm_msg.duty_cycle = (int16_t)control_output; /* Control output directly maps to pulse width adjustment */
+    /* Straight to the servo; the loop never waits on the PWM task */
+    PWM_Set_Drive(&pwm_msg);
+
+    /* Records follow the sensor, one per sample */
+    if (fresh)
+    {
+        Publish_Telemetry(sample, &pwm_msg);
+        Record_Capture(sample, &pwm_msg);
+    }
+}
+
+/**
+ * @brief Advance the trajectory towards the setpoint and run the PID controller on it.
+ *
+ * Signals setpoint reached once the move has finished.
+ *
+ * @param setpoint_mm Final setpoint
+ * @param position_mm Measured position
+ * @param velocity_mm_s Estimated velocity, for the derivative term
+ * @param dT Time since the last cycle in seconds
+ * @return Control output, before inversion for the motor direction
+ */
+static float Track_Setpoint(float setpoint_mm, float position_mm, float velocity_mm_s, float dT)
+{
+    Gain_Set_t gains;
+    float error;
+
+    taskENTER_CRITICAL(); /* Limits may be changed from the command task */
+    Trajectory_Step(&vertical_trajectory, setpoint_mm, dT);
+    taskEXIT_CRITICAL();
+
+    /* Track the reference, not the final setpoint */
+    error = vertical_trajectory.position_mm - position_mm;
+    vertical_direction = Travel_Direction(vertical_trajectory.velocity_mm_s, error);
+    Gain_Schedule_Lookup(vertical_direction, vertical_trajectory.position_mm, &gains);
+    PID_Controller_Set_Gains(&vertical_pid, &gains, dT);
+
+    /* Signal Setpoint Reached once the move has finished */
+    if (Trajectory_Done(&vertical_trajectory, setpoint_mm) && fabsf(setpoint_mm - position_mm) < DEADZONE_MM)
+    {
+        xEventGroupSetBits(Motor_Event_Group, MOTOR_EVENT_BIT);
+    }
 
     /* Apply Deadzone */
-    float effective_error = (fabsf(error) < DEADZONE_MM) ? 0.0f : error;
+    if (fabsf(error) < DEADZONE_MM)
+    {
+        error = 0.0f;
+    }
+    return PID_Controller_Step(&vertical_pid, error, velocity_mm_s, vertical_trajectory.velocity_mm_s);
+}
 
-    /* Proportional Term */
-    proportional = pid->Kp * effective_error;
+/**
+ * @brief Update the period, latency and overrun statistics for a tick.
+ *
+ * @param ticks Ticks counted since the previous cycle started
+ * @param start_cycles DWT cycle count at the start of this cycle
+ */
+static void Record_Tick(uint32_t ticks, uint32_t start_cycles)
+{
+    uint32_t latency = start_cycles - Control_Timer_Last_Tick();
+    uint32_t period = start_cycles - last_start_cycles;
 
-    /* Accumulate Error term*/
-    pid->integral += pid->Ki * effective_error * dT;
+    taskENTER_CRITICAL();
+    timing.cycles++;
+    timing.overruns += ticks - 1;
+    if (latency > timing.latency_max)
+    {
+        timing.latency_max = latency;
+    }
+    /* A period spanning missed ticks is counted as an overrun, not as jitter */
+    if (have_last_start && ticks == 1)
+    {
+        timing.period_min = (period < timing.period_min) ? period : timing.period_min;
+        timing.period_max = (period > timing.period_max) ? period : timing.period_max;
+    }
+    taskEXIT_CRITICAL();
 
-    /* Anti-windup clamp */
-    pid->integral = fmaxf(-PID_ANTI_WINDUP_LIMIT, fminf(PID_ANTI_WINDUP_LIMIT, pid->integral));
+    last_start_cycles = start_cycles;
+    have_last_start = true;
+}
 
-    /* Calculate derivative term */
-    derivative = pid->Kd * (error - pid->previous_error) / dT;
+/**
+ * @brief Update the execution time statistics at the end of a cycle.
+ *
+ * @param start_cycles DWT cycle count at the start of this cycle
+ */
+static void Record_Execution(uint32_t start_cycles)
+{
+    uint32_t execution = Cycle_Counter_Now() - start_cycles;
 
-    /* Update Previous Error */
-    pid->previous_error = error;
+    taskENTER_CRITICAL();
+    if (execution > timing.execution_max)
+    {
+        timing.execution_max = execution;
+    }
+    taskEXIT_CRITICAL();
+}
 
-    /* Total Output */
-    output = proportional + pid->integral + derivative;
+/**
+ * @brief Decide the direction of travel to schedule the gains on.
+ *
+ * The reference velocity decides while the reference moves, and the error
+ * once it has stopped. Within the deadzone the direction is kept, so the gains
+ * do not switch back and forth while holding position.
+ *
+ * @param reference_velocity Reference velocity
+ * @param error Reference minus measured position
+ */
+static Gain_Direction_t Travel_Direction(float reference_velocity, float error)
+{
+    float demand;
+
+    if (fabsf(reference_velocity) > DIRECTION_VELOCITY_MM_S)
+    {
+        demand = reference_velocity;
+    }
+    else if (fabsf(error) >= DEADZONE_MM)
+    {
+        demand = error;
+    }
+    else
+    {
+        return vertical_direction;
+    }
+    return (demand < 0.0f) ? GAIN_DIRECTION_UP : GAIN_DIRECTION_DOWN;
+}
+
+/**
+ * @brief Stop the hoist on a sensor failure and flag the fault to the mode layer.
+ *
+ * The idle command is sent once per failure; the integral restarts from zero.
+ *
+ * @param stopped Whether the hoist is already stopped, updated
+ */
+static void Stop_Vertical_Motor(bool *stopped)
+{
+    PWM_Duty_Cycle_t pwm_msg = {
+        .channel = VERTICAL_SERVO_PWM,
+        .direction = DIRECTION_IDLE,
+        .duty_cycle = 0,
+    };
+
+    xEventGroupSetBits(Motor_Event_Group, MOTOR_FAULT_BIT);
+    if (!*stopped)
+    {
+        PID_Controller_Reset(&vertical_pid);
+        PWM_Set_Drive(&pwm_msg);
+        *stopped = true;
+    }
+}
+
+/**
+ * @brief Wait for the vertical axis to reach its setpoint.
+ *
+ * Clears the setpoint reached event once seen. The fault event is left set
+ * for the mode layer to handle.
+ *
+ * @return false if the sensor failed first
+ */
+bool Wait_For_Setpoint(void)
+{
+    EventBits_t bits = xEventGroupWaitBits(Motor_Event_Group, MOTOR_EVENT_BIT | MOTOR_FAULT_BIT, pdFALSE, pdFALSE,
+                                           portMAX_DELAY);
+
+    xEventGroupClearBits(Motor_Event_Group, MOTOR_EVENT_BIT);
+    return (bits & MOTOR_FAULT_BIT) == 0;
+}
+
+/**
+ * @brief Hand the state of this control cycle to the telemetry stream.
+ *
+ * @param sample Filtered sample used this cycle
+ * @param pwm_msg PWM command sent this cycle
+ */
+static void Publish_Telemetry(const Filtered_Sample_t *sample, const PWM_Duty_Cycle_t *pwm_msg)
+{
+    uint8_t flags = control_loop_enabled ? TELEMETRY_FLAG_PID_ENABLED : 0;
 
-    if (output < 0)
+    if (sample->flags & SENSOR_SAMPLE_AFTER_MISSED)
     {
-        output *= GRAVITY_COMPENSATION; /* Compensate for gravity when moving up */
+        flags |= TELEMETRY_FLAG_SAMPLE_MISSED;
     }
 
-    /* Clamp Total Output */
-    output = fmaxf(PWM_MIN, fminf(PWM_MAX, output));
+    Telemetry_Record_t record = {
+        .timestamp_ms = xTaskGetTickCount() * portTICK_PERIOD_MS,
+        .raw_distance_mm = (uint16_t)sample->raw_distance_mm,
+        .filtered_distance_mm = (uint16_t)sample->distance_mm,
+        .setpoint_mm = (int16_t)vertical_position_setpoint_mm,
+        .proportional = vertical_pid.proportional,
+        .integral = vertical_pid.integral,
+        .derivative = vertical_pid.derivative,
+        .pwm_direction = (int8_t)pwm_msg->direction,
+        .pwm_duty = (uint8_t)pwm_msg->duty_cycle,
+        .mode = (uint8_t)Get_Control_Mode(),
+        .flags = flags,
+    };
+
+    Telemetry_Publish(&record);
+}
+
+/**
+ * @brief Hand the state of this control cycle to the capture recorder.
+ *
+ * @param sample Filtered sample used this cycle
+ * @param pwm_msg PWM command sent this cycle
+ */
+static void Record_Capture(const Filtered_Sample_t *sample, const PWM_Duty_Cycle_t *pwm_msg)
+{
+    int16_t output = (int16_t)pwm_msg->duty_cycle;
+
+    if (pwm_msg->direction == DIRECTION_COUNTERCLOCKWISE)
+    {
+        output = -output;
+    }
 
-    return output;
+    Capture_Record_t record = {
+        .timestamp_cycles = sample->timestamp_cycles,
+        .echo_us = (uint16_t)sample->echo_us,
+        .raw_distance_mm = (uint16_t)sample->raw_distance_mm,
+        .filtered_distance_mm = (uint16_t)sample->distance_mm,
+        .setpoint_mm = (int16_t)vertical_position_setpoint_mm,
+        .output = output,
+        .mode = (uint8_t)Get_Control_Mode(),
+        .flags = sample->flags,
+    };
+
+    Capture_Record(&record);
 }
 
 /**
@@ -185,7 +494,7 @@ void Set_Setpoint(uint32_t setpoint_mm)
     {
         setpoint_mm = SETPOINT_MAX_MM;
     }
-    xQueueSend(Motor_Setpoint_Queue, &setpoint_mm, portMAX_DELAY);
+    xQueueOverwrite(Motor_Setpoint_Queue, &setpoint_mm); /* Latest setpoint wins, never blocks */
 }
 
 /**
@@ -199,50 +508,277 @@ void Toggle_PID_Control(bool enable)
 }
 
 /**
- * @brief Set Proportional Gain for PID controller
+ * @brief Set Proportional Gain for PID controller at the current operating point, scaling the gain schedule
  *
  * @param Kp New proportional gain
+ * @return false if the gain is negative or not finite
  */
-void Set_Proportional_Gain(float Kp)
+bool Set_Proportional_Gain(float Kp)
 {
-    vertical_pid.Kp = Kp;
+    return Set_Scheduled_Gain(offsetof(Gain_Set_t, Kp), Kp);
 }
 
 /**
- * @brief Set Integral Gain for PID controller
+ * @brief Set Integral Gain for PID controller at the current operating point, scaling the gain schedule
  *
  * @param Ki New integral gain
+ * @return false if the gain is negative or not finite
  */
-void Set_Integral_Gain(float Ki)
+bool Set_Integral_Gain(float Ki)
 {
-    vertical_pid.Ki = Ki;
+    return Set_Scheduled_Gain(offsetof(Gain_Set_t, Ki), Ki);
 }
 
 /**
- * @brief Set Derivative Gain for PID controller
+ * @brief Set Derivative Gain for PID controller at the current operating point, scaling the gain schedule
  *
  * @param Kd New derivative gain
+ * @return false if the gain is negative or not finite
  */
-void Set_Derivative_Gain(float Kd)
+bool Set_Derivative_Gain(float Kd)
 {
-    vertical_pid.Kd = Kd;
+    return Set_Scheduled_Gain(offsetof(Gain_Set_t, Kd), Kd);
 }
 
 /**
- * @brief Get current PID gains and print them
+ * @brief Set Feedforward Gain on the trajectory velocity at the current operating point, scaling the gain schedule
+ *
+ * @param Kff New feedforward gain, pulse width per mm/s
+ * @return false if the gain is negative or not finite
+ */
+bool Set_Feedforward_Gain(float Kff)
+{
+    return Set_Scheduled_Gain(offsetof(Gain_Set_t, Kff), Kff);
+}
+
+/**
+ * @brief Set one gain at the current operating point by scaling the whole gain schedule
+ *
+ * Every entry is multiplied by new / current, where current is the gain
+ * scheduled now (as Print_PID_Gains reports it). The shape across schedule
+ * points and the ratio between up and down travel are kept. If the current
+ * gain is zero there is nothing to scale, and every entry is set to the new
+ * value.
+ *
+ * @param term Offset of the gain within Gain_Set_t
+ * @param value New gain at the current operating point
+ * @return false if the gain is negative or not finite, or too large a multiple
+ * of the current gain; the schedule is then unchanged
+ */
+static bool Set_Scheduled_Gain(size_t term, float value)
+{
+    Gain_Set_t gains;
+    float current;
+
+    if (!isfinite(value) || value < 0.0f)
+    {
+        return false;
+    }
+
+    Gain_Schedule_Lookup(vertical_direction, vertical_trajectory.position_mm, &gains);
+    current = *(float *)((uint8_t *)&gains + term);
+
+    /* Both rows are checked against the same from and to, so none or both change */
+    for (uint8_t direction = 0; direction < GAIN_DIRECTION_COUNT; direction++)
+    {
+        if (!Gain_Schedule_Rescale_Term((Gain_Direction_t)direction, term, current, value))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Set the trajectory limits for vertical moves
+ *
+ * @param velocity_mm_s Maximum velocity; 0 steps straight to each setpoint
+ * @param acceleration_mm_s2 Maximum acceleration
+ * @param jerk_mm_s3 Maximum jerk
+ * @return false if a limit is out of range
+ */
+bool Set_Trajectory_Limits(float velocity_mm_s, float acceleration_mm_s2, float jerk_mm_s3)
+{
+    if (velocity_mm_s < 0.0f || acceleration_mm_s2 <= 0.0f || jerk_mm_s3 <= 0.0f)
+    {
+        return false;
+    }
+
+    taskENTER_CRITICAL();
+    vertical_trajectory.max_velocity_mm_s = velocity_mm_s;
+    vertical_trajectory.max_acceleration_mm_s2 = acceleration_mm_s2;
+    vertical_trajectory.max_jerk_mm_s3 = jerk_mm_s3;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+/**
+ * @brief Get the PID gains scheduled for the current position and direction and print them
+ *
+ * The gains go to the console as plain text, readable without the log decoder,
+ * and as a LOG record at full precision.
  */
 void Print_PID_Gains(void)
 {
-    char debug_string[128];
-    sprintf(debug_string, "Current PID Gains - Kp: %.2f, Ki: %.2f, Kd: %.2f\r\n",
-            vertical_pid.Kp, vertical_pid.Ki, vertical_pid.Kd);
-    print_str(debug_string);
+    Gain_Set_t gains;
+    char gains_string[128] = "Current PID Gains -";
+    size_t length = strlen(gains_string);
+
+    Gain_Schedule_Lookup(vertical_direction, vertical_trajectory.position_mm, &gains);
+
+    length = Format_Gain(gains_string, sizeof(gains_string), length, " Kp: ", gains.Kp);
+    length = Format_Gain(gains_string, sizeof(gains_string), length, ", Ki: ", gains.Ki);
+    length = Format_Gain(gains_string, sizeof(gains_string), length, ", Kd: ", gains.Kd);
+    length = Format_Gain(gains_string, sizeof(gains_string), length, ", Kff: ", gains.Kff);
+    snprintf(&gains_string[length], sizeof(gains_string) - length, "\r\n");
+    print_str(gains_string);
+
+    LOG("Current PID Gains - Kp: %.2f, Ki: %.2f, Kd: %.2f, Kff: %.2f", gains.Kp, gains.Ki, gains.Kd, gains.Kff);
+}
+
+/**
+ * @brief Append one gain to two decimals without float printf, which nano libc leaves out.
+ *
+ * A gain that is not finite, or too large to round into a long, is printed as
+ * "out of range" rather than rounded. Output that does not fit is truncated.
+ *
+ * @param buffer String to append to
+ * @param size Size of buffer
+ * @param length Current length of the string, less than size
+ * @param name Text printed before the gain
+ * @param gain Gain to print
+ * @return New length of the string, at most size - 1
+ */
+static size_t Format_Gain(char *buffer, size_t size, size_t length, const char *name, float gain)
+{
+    long hundredths;
+    int written;
+
+    if (!isfinite(gain) || fabsf(gain) >= GAIN_PRINT_LIMIT)
+    {
+        written = snprintf(&buffer[length], size - length, "%sout of range", name);
+    }
+    else
+    {
+        hundredths = lroundf(fabsf(gain) * 100.0f);
+        written = snprintf(&buffer[length], size - length, "%s%s%ld.%02ld", name,
+                           (gain < 0.0f && hundredths != 0) ? "-" : "", hundredths / 100, hundredths % 100);
+    }
+
+    if (written < 0)
+    {
+        return length;
+    }
+    return ((size_t)written < size - length) ? length + (size_t)written : size - 1;
+}
+
+/**
+ * @brief Get the PID gains scheduled for the current position and direction
+ */
+void Get_PID_Gains(float *Kp, float *Ki, float *Kd)
+{
+    Gain_Set_t gains;
+
+    Gain_Schedule_Lookup(vertical_direction, vertical_trajectory.position_mm, &gains);
+    *Kp = gains.Kp;
+    *Ki = gains.Ki;
+    *Kd = gains.Kd;
+}
+
+/**
+ * @brief Get the current vertical position setpoint in millimeters
+ */
+int32_t Get_Setpoint(void)
+{
+    return vertical_position_setpoint_mm;
+}
+
+/**
+ * @brief Check whether the PID control loop is enabled
+ */
+bool PID_Control_Enabled(void)
+{
+    return control_loop_enabled;
 }
 
 /**
  * @brief Set PID output limits
+ *
+ * @param limit Symmetric limit on the pulse width adjustment, up to PWM_MAX
  */
 void Set_PID_Output_Limit(float limit)
 {
-    vertical_pid.output_limit = limit;
-}
\ No newline at end of file
+    vertical_pid.output_limit = fmaxf(0.0f, fminf(PWM_MAX, limit));
+}
+
+/**
+ * @brief Number of control cycles that followed one or more lost sensor samples
+ */
+uint32_t Control_Loop_Missed_Samples(void)
+{
+    return missed_samples;
+}
+
+/**
+ * @brief Largest output magnitude commanded since the last call, then restart it.
+ *
+ * @return Pulse width adjustment, 0 to PWM_MAX
+ */
+float Control_Loop_Take_Peak_Output(void)
+{
+    float peak;
+
+    taskENTER_CRITICAL();
+    peak = peak_output;
+    peak_output = 0.0f;
+    taskEXIT_CRITICAL();
+    return peak;
+}
+
+/**
+ * @brief Restart the cycle timing statistics.
+ */
+static void Reset_Timing_Stats(void)
+{
+    taskENTER_CRITICAL();
+    timing.cycles = 0;
+    timing.overruns = 0;
+    timing.period_min = UINT32_MAX;
+    timing.period_max = 0;
+    timing.latency_max = 0;
+    timing.execution_max = 0;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Copy the cycle timing statistics, then restart them.
+ *
+ * @param stats Filled with the statistics since the last call, times in microseconds
+ */
+void Control_Loop_Take_Stats(Control_Loop_Stats_t *stats)
+{
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+    taskENTER_CRITICAL();
+    stats->rate_hz = Control_Timer_Rate();
+    stats->cycles = timing.cycles;
+    stats->overruns = timing.overruns;
+    stats->period_min_us = (timing.period_min == UINT32_MAX) ? 0 : timing.period_min / cycles_per_us;
+    stats->period_max_us = timing.period_max / cycles_per_us;
+    stats->latency_max_us = timing.latency_max / cycles_per_us;
+    stats->execution_max_us = timing.execution_max / cycles_per_us;
+    taskEXIT_CRITICAL();
+
+    Reset_Timing_Stats();
+}
+
+/**
+ * @brief Set the control loop rate.
+ *
+ * @param rate_hz Cycles per second, CONTROL_TIMER_MIN_RATE_HZ to CONTROL_TIMER_MAX_RATE_HZ
+ * @return false if the rate is out of range
+ */
+bool Control_Loop_Set_Rate(uint32_t rate_hz)
+{
+    return Control_Timer_Set_Rate(rate_hz);
+}
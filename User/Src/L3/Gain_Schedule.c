@@ -0,0 +1,202 @@
+/**
+ * @file Gain_Schedule.c
+ *
+ * @brief Position- and direction-scheduled controller gains for the vertical axis.
+ *
+ * Each direction of travel has its own row of gain sets, one per schedule point.
+ * Points are positions in increasing order; between two points the gains are
+ * interpolated linearly, and beyond the end points the nearest set applies.
+ *
+ * The defaults reproduce the fixed gains used before scheduling: the same set at
+ * every point, scaled by 0.7 when lifting, where gravity assists the hoist.
+ */
+
+/* Module Header */
+#include "L3/Gain_Schedule.h"
+
+/* Standard Libraries */
+#include <math.h>
+
+/* User Libraries */
+#include "user_main.h"
+
+static float points_mm[GAIN_SCHEDULE_POINTS] = {30.0f, 65.0f, 105.0f, 140.0f};
+
+static Gain_Set_t schedule[GAIN_DIRECTION_COUNT][GAIN_SCHEDULE_POINTS] = {
+    [GAIN_DIRECTION_UP] =
+        {
+            {.Kp = 7.0f, .Kff = 0.14f},
+            {.Kp = 7.0f, .Kff = 0.14f},
+            {.Kp = 7.0f, .Kff = 0.14f},
+            {.Kp = 7.0f, .Kff = 0.14f},
+        },
+    [GAIN_DIRECTION_DOWN] =
+        {
+            {.Kp = 10.0f, .Kff = 0.2f},
+            {.Kp = 10.0f, .Kff = 0.2f},
+            {.Kp = 10.0f, .Kff = 0.2f},
+            {.Kp = 10.0f, .Kff = 0.2f},
+        },
+};
+
+/**
+ * @brief Whether a value can be stored as a controller gain.
+ *
+ * Gains must be finite and not negative; a negative gain would drive the
+ * hoist away from the setpoint.
+ */
+static bool Gain_Valid(float gain)
+{
+    return isfinite(gain) && gain >= 0.0f;
+}
+
+/**
+ * @brief Interpolated gains for a direction of travel and position.
+ *
+ * @param direction Direction of travel
+ * @param position_mm Position to schedule on
+ * @param gains Filled with the interpolated gains
+ */
+void Gain_Schedule_Lookup(Gain_Direction_t direction, float position_mm, Gain_Set_t *gains)
+{
+    const Gain_Set_t *row = schedule[direction];
+    const Gain_Set_t *low;
+    const Gain_Set_t *high;
+    uint8_t point = 1;
+    float fraction;
+
+    taskENTER_CRITICAL();
+    while (point < GAIN_SCHEDULE_POINTS - 1 && position_mm > points_mm[point])
+    {
+        point++;
+    }
+    low = &row[point - 1];
+    high = &row[point];
+
+    fraction = (position_mm - points_mm[point - 1]) / (points_mm[point] - points_mm[point - 1]);
+    fraction = fmaxf(0.0f, fminf(1.0f, fraction));
+
+    gains->Kp = low->Kp + (high->Kp - low->Kp) * fraction;
+    gains->Ki = low->Ki + (high->Ki - low->Ki) * fraction;
+    gains->Kd = low->Kd + (high->Kd - low->Kd) * fraction;
+    gains->Kff = low->Kff + (high->Kff - low->Kff) * fraction;
+    gains->offset = low->offset + (high->offset - low->offset) * fraction;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Copy the gains at one schedule point.
+ *
+ * @return false if the direction or point is out of range
+ */
+bool Gain_Schedule_Get_Entry(Gain_Direction_t direction, uint8_t point, Gain_Set_t *gains)
+{
+    if ((uint32_t)direction >= GAIN_DIRECTION_COUNT || point >= GAIN_SCHEDULE_POINTS)
+    {
+        return false;
+    }
+
+    taskENTER_CRITICAL();
+    *gains = schedule[direction][point];
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+/**
+ * @brief Replace the gains at one schedule point.
+ *
+ * The offset may be negative; every other gain must be finite and not negative.
+ *
+ * @return false if the direction or point is out of range or a gain is invalid
+ */
+bool Gain_Schedule_Set_Entry(Gain_Direction_t direction, uint8_t point, const Gain_Set_t *gains)
+{
+    if ((uint32_t)direction >= GAIN_DIRECTION_COUNT || point >= GAIN_SCHEDULE_POINTS || !Gain_Valid(gains->Kp) ||
+        !Gain_Valid(gains->Ki) || !Gain_Valid(gains->Kd) || !Gain_Valid(gains->Kff) || !isfinite(gains->offset))
+    {
+        return false;
+    }
+
+    taskENTER_CRITICAL();
+    schedule[direction][point] = *gains;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+/**
+ * @brief Rescale one gain throughout a direction's row.
+ *
+ * Every entry is multiplied by to / from, keeping the row's shape across
+ * schedule points. With from zero there is no shape to keep, and every entry
+ * is set to the new value.
+ *
+ * @param direction Direction of travel
+ * @param term Offset of the gain within Gain_Set_t
+ * @param from Gain the row is scaled from, usually its value at some position
+ * @param to Gain that value becomes
+ * @return false if the direction or term is out of range, or from or to is not a
+ * valid gain
+ */
+bool Gain_Schedule_Rescale_Term(Gain_Direction_t direction, size_t term, float from, float to)
+{
+    float *entry;
+
+    if ((uint32_t)direction >= GAIN_DIRECTION_COUNT || term > sizeof(Gain_Set_t) - sizeof(float) ||
+        term % sizeof(float) != 0 || term == offsetof(Gain_Set_t, offset) || !Gain_Valid(from) || !Gain_Valid(to) ||
+        (from != 0.0f && !isfinite(to / from)))
+    {
+        return false;
+    }
+
+    taskENTER_CRITICAL();
+    for (uint8_t point = 0; point < GAIN_SCHEDULE_POINTS; point++)
+    {
+        entry = (float *)((uint8_t *)&schedule[direction][point] + term);
+        *entry = (from != 0.0f) ? *entry * (to / from) : to;
+    }
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+/**
+ * @brief Get the position of one schedule point.
+ *
+ * @return false if the point is out of range
+ */
+bool Gain_Schedule_Get_Point(uint8_t point, float *position_mm)
+{
+    if (point >= GAIN_SCHEDULE_POINTS)
+    {
+        return false;
+    }
+
+    *position_mm = points_mm[point];
+    return true;
+}
+
+/**
+ * @brief Move one schedule point.
+ *
+ * @param point Point index
+ * @param position_mm New position, strictly between its neighbours
+ * @return false if the point is out of range or would leave the points out of order
+ */
+bool Gain_Schedule_Set_Point(uint8_t point, float position_mm)
+{
+    bool valid;
+
+    if (point >= GAIN_SCHEDULE_POINTS || !isfinite(position_mm))
+    {
+        return false;
+    }
+
+    taskENTER_CRITICAL();
+    valid = (point == 0 || position_mm > points_mm[point - 1]) &&
+            (point == GAIN_SCHEDULE_POINTS - 1 || position_mm < points_mm[point + 1]);
+    if (valid)
+    {
+        points_mm[point] = position_mm;
+    }
+    taskEXIT_CRITICAL();
+    return valid;
+}
@@ -0,0 +1,251 @@
+/**
+ * @file Modbus_Registers.c
+ *
+ * @brief Maps crane parameters and state onto Modbus registers.
+ *
+ * Writes go through the same non-blocking setters as the host commands.
+ *
+ * A float gain is written high word first. Each gain stages its own high
+ * word, and the low word applies the float and clears the staged word, so
+ * writes to different gains cannot mix and a low word alone is refused.
+ */
+
+/* Module Header */
+#include "L3/Modbus_Registers.h"
+
+/* Standard Libraries */
+#include <math.h>
+#include <string.h>
+
+/* User Libraries */
+#include "user_main.h"
+#include "L1/PWM_Driver.h"
+#include "L2/Modbus_RTU.h"
+#include "L2/Sensor_Filter.h"
+#include "L2/Sensor_Health.h"
+#include "L3/Control_Loop.h"
+#include "L5/Mode_Control.h"
+
+extern EventGroupHandle_t Motor_Event_Group;
+
+static int16_t horizontal_speed = 0;
+static int16_t vertical_speed = 0;
+
+/* High word of a gain's float, awaiting its low word */
+typedef struct
+{
+    uint16_t word;
+    bool valid;
+} Staged_Word_t;
+
+/* One per gain register pair, from HOLDING_KP_HIGH */
+#define STAGED_GAIN_COUNT ((HOLDING_KD_HIGH - HOLDING_KP_HIGH) / 2 + 1)
+#define STAGED_GAIN_INDEX(address) (((address) - HOLDING_KP_HIGH) / 2)
+_Static_assert(HOLDING_KI_HIGH == HOLDING_KP_HIGH + 2 && HOLDING_KD_HIGH == HOLDING_KI_HIGH + 2,
+               "Gain registers must be consecutive high/low pairs");
+
+static Staged_Word_t staged_high_words[STAGED_GAIN_COUNT];
+
+static Modbus_Exception_t Read_Holding(uint16_t address, uint16_t *value);
+static Modbus_Exception_t Write_Holding(uint16_t address, uint16_t value);
+static Modbus_Exception_t Read_Input(uint16_t address, uint16_t *value);
+
+static const Modbus_Register_Map_t crane_register_map = {
+    .holding_count = HOLDING_REGISTER_COUNT,
+    .input_count = INPUT_REGISTER_COUNT,
+    .read_holding = Read_Holding,
+    .write_holding = Write_Holding,
+    .read_input = Read_Input,
+};
+
+/**
+ * @brief Register the crane register map with the Modbus server.
+ */
+void Modbus_Registers_Init(void)
+{
+    Modbus_Set_Register_Map(&crane_register_map);
+}
+
+/**
+ * @brief One 16-bit word of a float's bit pattern.
+ */
+static uint16_t Float_Word(float value, bool high)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return high ? (uint16_t)(bits >> 16) : (uint16_t)bits;
+}
+
+/**
+ * @brief Combine a gain's staged high word with its low word into a float.
+ *
+ * The staged word is used up either way.
+ *
+ * @param address High or low register of the gain
+ * @param low_word Low word just written
+ * @param value Filled with the float
+ * @return false if no high word was staged or the float is not finite
+ */
+static bool Staged_Float(uint16_t address, uint16_t low_word, float *value)
+{
+    Staged_Word_t *staged = &staged_high_words[STAGED_GAIN_INDEX(address)];
+    uint32_t bits = ((uint32_t)staged->word << 16) | low_word;
+    bool valid = staged->valid;
+
+    staged->valid = false;
+    memcpy(value, &bits, sizeof(*value));
+    return valid && isfinite(*value);
+}
+
+/**
+ * @brief Read one holding register.
+ */
+static Modbus_Exception_t Read_Holding(uint16_t address, uint16_t *value)
+{
+    float Kp, Ki, Kd;
+
+    Get_PID_Gains(&Kp, &Ki, &Kd);
+
+    switch (address)
+    {
+    case HOLDING_SETPOINT_MM:
+        *value = (uint16_t)Get_Setpoint();
+        break;
+    case HOLDING_MODE:
+        *value = (uint16_t)Get_Control_Mode();
+        break;
+    case HOLDING_PID_ENABLE:
+        *value = PID_Control_Enabled() ? 1 : 0;
+        break;
+    case HOLDING_HORIZONTAL_SPEED:
+        *value = (uint16_t)horizontal_speed;
+        break;
+    case HOLDING_VERTICAL_SPEED:
+        *value = (uint16_t)vertical_speed;
+        break;
+    case HOLDING_KP_HIGH:
+    case HOLDING_KP_LOW:
+        *value = Float_Word(Kp, address == HOLDING_KP_HIGH);
+        break;
+    case HOLDING_KI_HIGH:
+    case HOLDING_KI_LOW:
+        *value = Float_Word(Ki, address == HOLDING_KI_HIGH);
+        break;
+    case HOLDING_KD_HIGH:
+    case HOLDING_KD_LOW:
+        *value = Float_Word(Kd, address == HOLDING_KD_HIGH);
+        break;
+    case HOLDING_LINK_MODE:
+        *value = 1; /* Always Modbus when read over Modbus */
+        break;
+    default:
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+    return MODBUS_EXCEPTION_NONE;
+}
+
+/**
+ * @brief Write one holding register.
+ */
+static Modbus_Exception_t Write_Holding(uint16_t address, uint16_t value)
+{
+    float gain;
+
+    switch (address)
+    {
+    case HOLDING_SETPOINT_MM:
+        Set_Setpoint(value);
+        break;
+    case HOLDING_MODE:
+        if (value > MODE_AUTOMATIC)
+        {
+            return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+        }
+        Transition_Mode((Control_Mode_t)value);
+        break;
+    case HOLDING_PID_ENABLE:
+        if (value > 1)
+        {
+            return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+        }
+        Toggle_PID_Control(value == 1);
+        break;
+    case HOLDING_HORIZONTAL_SPEED:
+        if (!PWM_Request_Speed(HORIZONTAL_SERVO_PWM, (int16_t)value))
+        {
+            return MODBUS_EXCEPTION_SERVER_DEVICE_BUSY;
+        }
+        horizontal_speed = (int16_t)value;
+        break;
+    case HOLDING_VERTICAL_SPEED:
+        if (!PWM_Request_Speed(VERTICAL_SERVO_PWM, (int16_t)value))
+        {
+            return MODBUS_EXCEPTION_SERVER_DEVICE_BUSY;
+        }
+        vertical_speed = (int16_t)value;
+        break;
+    case HOLDING_KP_HIGH:
+    case HOLDING_KI_HIGH:
+    case HOLDING_KD_HIGH:
+        staged_high_words[STAGED_GAIN_INDEX(address)] = (Staged_Word_t){.word = value, .valid = true};
+        break;
+    case HOLDING_KP_LOW:
+        if (!Staged_Float(address, value, &gain) || !Set_Proportional_Gain(gain))
+        {
+            return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+        }
+        break;
+    case HOLDING_KI_LOW:
+        if (!Staged_Float(address, value, &gain) || !Set_Integral_Gain(gain))
+        {
+            return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+        }
+        break;
+    case HOLDING_KD_LOW:
+        if (!Staged_Float(address, value, &gain) || !Set_Derivative_Gain(gain))
+        {
+            return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+        }
+        break;
+    case HOLDING_LINK_MODE:
+        if (value == 0)
+        {
+            Modbus_Request_Exit();
+        }
+        break;
+    default:
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+    return MODBUS_EXCEPTION_NONE;
+}
+
+/**
+ * @brief Read one input register.
+ */
+static Modbus_Exception_t Read_Input(uint16_t address, uint16_t *value)
+{
+    switch (address)
+    {
+    case INPUT_FILTERED_POSITION_MM:
+        *value = (uint16_t)Sensor_Filter_Last_Filtered();
+        break;
+    case INPUT_RAW_POSITION_MM:
+        *value = (uint16_t)Sensor_Filter_Last_Raw();
+        break;
+    case INPUT_MODE:
+        *value = (uint16_t)Get_Control_Mode();
+        break;
+    case INPUT_STATUS:
+        *value = (PID_Control_Enabled() ? MODBUS_STATUS_PID_ENABLED : 0) |
+                 ((Motor_Event_Group != NULL && (xEventGroupGetBits(Motor_Event_Group) & MOTOR_EVENT_BIT))
+                      ? MODBUS_STATUS_SETPOINT_REACHED
+                      : 0);
+        break;
+    case INPUT_SENSOR_HEALTH:
+        *value = (uint16_t)Sensor_Health_Get_State();
+        break;
+    default:
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+    return MODBUS_EXCEPTION_NONE;
+}
@@ -0,0 +1,263 @@
+/**
+ * @file PID_Controller.c
+ *
+ * @brief PID controller for the vertical axis built on the CMSIS-DSP PID kernel.
+ *
+ * The proportional and integral terms run in arm_pid_f32, the incremental form
+ * y[n] = y[n-1] + A0 e[n] + A1 e[n-1], with the integral gain pre-scaled by the
+ * cycle time so no division is needed per step. The kernel's own derivative
+ * would act on the error and kick on every setpoint step, so it is left at zero
+ * and the derivative instead acts on the measured rate against the reference
+ * rate. The measured rate comes from the position estimator rather than from
+ * differencing samples, and may be smoothed by an optional first-order filter.
+ *
+ * The output is clamped to output_limit. While clamped, the excess is fed back
+ * into the integral (back-calculation, tracking time constant Ti) so the
+ * integral does not wind up.
+ *
+ * The kernel state holds the proportional term of the last step alongside the
+ * integral; the integral alone is state[2] - Kp state[0].
+ */
+
+/* Module Header */
+#include "L3/PID_Controller.h"
+
+/* Standard Libraries */
+#include <math.h>
+
+/* User Libraries */
+#include "user_main.h"
+#include "L1/Cycle_Counter.h"
+
+#define BENCHMARK_STEPS 64
+#define BENCHMARK_DT_S 0.005f
+
+/* Constants of the original PID_Compute, kept for the benchmark baseline */
+#define PWM_MAX 35.0f  /* Max pulse width adjustment for PWM */
+#define PWM_MIN -35.0f /* Min pulse width adjustment for PWM */
+#define PID_ANTI_WINDUP_LIMIT 50.0f
+#define DEADZONE_MM 4.0f
+#define GRAVITY_COMPENSATION 0.7f
+
+/* The original controller state, kept for the benchmark baseline */
+typedef struct
+{
+    float Kp;
+    float Ki;
+    float Kd;
+    float previous_error;
+    float integral;
+    float output_limit;
+} Reference_PID_t;
+
+static float PID_Compute(Reference_PID_t *pid, float error, float dT);
+
+/**
+ * @brief Initialize a controller with zero gains and state.
+ *
+ * @param pid Controller to initialize
+ * @param output_limit Symmetric output clamp
+ * @param derivative_filter_s Time constant of the measured rate filter in seconds, 0 for none
+ */
+void PID_Controller_Init(PID_Controller_t *pid, float output_limit, float derivative_filter_s)
+{
+    pid->pi.Kp = 0.0f;
+    pid->pi.Ki = 0.0f;
+    pid->pi.Kd = 0.0f;
+    arm_pid_init_f32(&pid->pi, 0);
+    pid->Kd = 0.0f;
+    pid->Kff = 0.0f;
+    pid->offset = 0.0f;
+    pid->output_limit = output_limit;
+    pid->derivative_filter_s = derivative_filter_s;
+    pid->dt = 0.0f;
+    PID_Controller_Reset(pid);
+}
+
+/**
+ * @brief Clear the integral and the measured rate, keeping the gains.
+ */
+void PID_Controller_Reset(PID_Controller_t *pid)
+{
+    arm_pid_reset_f32(&pid->pi);
+    pid->rate = 0.0f;
+    pid->have_rate = false;
+    pid->proportional = 0.0f;
+    pid->integral = 0.0f;
+    pid->derivative = 0.0f;
+}
+
+/**
+ * @brief Load the gains for the next step.
+ *
+ * The integral is kept across a change of gains; the proportional term follows
+ * the new Kp immediately.
+ *
+ * @param pid Controller
+ * @param gains New gains
+ * @param dT Cycle time in seconds
+ */
+void PID_Controller_Set_Gains(PID_Controller_t *pid, const Gain_Set_t *gains, float dT)
+{
+    float integral = pid->pi.state[2] - pid->pi.Kp * pid->pi.state[0];
+
+    if (dT != pid->dt)
+    {
+        pid->dt = dT;
+        pid->rate_weight = dT / (pid->derivative_filter_s + dT);
+    }
+
+    pid->pi.Kp = gains->Kp;
+    pid->pi.Ki = gains->Ki * dT;
+    pid->pi.Kd = 0.0f;
+    arm_pid_init_f32(&pid->pi, 0);
+    pid->pi.state[2] = integral + pid->pi.Kp * pid->pi.state[0];
+
+    pid->Kd = gains->Kd;
+    pid->Kff = gains->Kff;
+    pid->offset = gains->offset;
+}
+
+/**
+ * @brief Run one controller step at the cycle time of the last PID_Controller_Set_Gains.
+ *
+ * @param pid Controller
+ * @param error Reference minus measurement
+ * @param measured_rate Rate of change of the measurement
+ * @param reference_rate Rate of change of the reference, fed forward and to the derivative
+ * @return Clamped control output
+ */
+float PID_Controller_Step(PID_Controller_t *pid, float error, float measured_rate, float reference_rate)
+{
+    float output;
+    float limited;
+    float tracking;
+
+    /* Derivative on measurement; the filter starts from the first rate after a reset */
+    if (pid->have_rate)
+    {
+        pid->rate += (measured_rate - pid->rate) * pid->rate_weight;
+    }
+    else
+    {
+        pid->rate = measured_rate;
+        pid->have_rate = true;
+    }
+
+    output = arm_pid_f32(&pid->pi, error);
+    pid->proportional = pid->pi.Kp * error;
+    pid->derivative = pid->Kd * (reference_rate - pid->rate);
+    output += pid->derivative + pid->Kff * reference_rate + pid->offset;
+
+    limited = fmaxf(-pid->output_limit, fminf(pid->output_limit, output));
+    if (limited != output)
+    {
+        /* Back-calculation: Ki dT / (Kp + Ki dT) is dT / (Ti + dT) */
+        tracking = pid->pi.Kp + pid->pi.Ki;
+        if (tracking > 0.0f)
+        {
+            pid->pi.state[2] += (limited - output) * pid->pi.Ki / tracking;
+        }
+    }
+    pid->integral = pid->pi.state[2] - pid->proportional;
+
+    return limited;
+}
+
+/**
+ * @brief Time one step of this controller against the original PID_Compute.
+ *
+ * Both run the same Kp, Ki and Kd on the same errors, on private instances,
+ * with interrupts masked up to configMAX_SYSCALL_INTERRUPT_PRIORITY. Loading
+ * the gains is included for this controller, as the control loop does so
+ * every cycle. The original divides by dT each step and has no feedforward.
+ *
+ * @param reference_cycles Mean cycles per step of the original PID_Compute
+ * @param cmsis_cycles Mean cycles per step of this controller
+ */
+void PID_Controller_Benchmark(uint32_t *reference_cycles, uint32_t *cmsis_cycles)
+{
+    static float errors[BENCHMARK_STEPS];
+    static float rates[BENCHMARK_STEPS];
+    static PID_Controller_t pid;
+    const Gain_Set_t gains = {.Kp = 10.0f, .Ki = 2.0f, .Kd = 0.5f, .Kff = 0.2f, .offset = 1.0f};
+    Reference_PID_t reference = {
+        .Kp = gains.Kp, .Ki = gains.Ki, .Kd = gains.Kd, .previous_error = 0.0f, .integral = 0.0f};
+    volatile float sink = 0.0f; /* Keeps the outputs live */
+    uint32_t start;
+
+    for (uint8_t i = 0; i < BENCHMARK_STEPS; i++)
+    {
+        errors[i] = 5.0f - (float)(i % 16);
+        rates[i] = (float)(i % 8) - 4.0f;
+    }
+    PID_Controller_Init(&pid, 35.0f, 0.05f);
+
+    taskENTER_CRITICAL();
+    start = Cycle_Counter_Now();
+    for (uint8_t i = 0; i < BENCHMARK_STEPS; i++)
+    {
+        sink = PID_Compute(&reference, errors[i], BENCHMARK_DT_S);
+    }
+    *reference_cycles = (Cycle_Counter_Now() - start) / BENCHMARK_STEPS;
+
+    start = Cycle_Counter_Now();
+    for (uint8_t i = 0; i < BENCHMARK_STEPS; i++)
+    {
+        PID_Controller_Set_Gains(&pid, &gains, BENCHMARK_DT_S);
+        sink = PID_Controller_Step(&pid, errors[i], rates[i], 0.0f);
+    }
+    *cmsis_cycles = (Cycle_Counter_Now() - start) / BENCHMARK_STEPS;
+    taskEXIT_CRITICAL();
+
+    UNUSED(sink);
+}
+
+/**
+ * @brief Calculate PID control output.
+ *
+ * The original controller, as it stood before this module, kept verbatim as
+ * the benchmark baseline.
+ *
+ * @param pid Pointer to PID controller structure
+ * @param error Setpoint minus measurement
+ * @param dT Time since the last computation in seconds
+ * @return Control output
+ */
+static float PID_Compute(Reference_PID_t *pid, float error, float dT)
+{
+    float proportional;
+    float derivative;
+    float output;
+
+    /* Apply Deadzone */
+    float effective_error = (fabsf(error) < DEADZONE_MM) ? 0.0f : error;
+
+    /* Proportional Term */
+    proportional = pid->Kp * effective_error;
+
+    /* Accumulate Error term*/
+    pid->integral += pid->Ki * effective_error * dT;
+
+    /* Anti-windup clamp */
+    pid->integral = fmaxf(-PID_ANTI_WINDUP_LIMIT, fminf(PID_ANTI_WINDUP_LIMIT, pid->integral));
+
+    /* Calculate derivative term */
+    derivative = pid->Kd * (error - pid->previous_error) / dT;
+
+    /* Update Previous Error */
+    pid->previous_error = error;
+
+    /* Total Output */
+    output = proportional + pid->integral + derivative;
+
+    if (output < 0)
+    {
+        output *= GRAVITY_COMPENSATION; /* Compensate for gravity when moving up */
+    }
+
+    /* Clamp Total Output */
+    output = fmaxf(PWM_MIN, fminf(PWM_MAX, output));
+
+    return output;
+}
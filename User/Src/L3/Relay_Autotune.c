@@ -0,0 +1,260 @@
+/**
+ * @file Relay_Autotune.c
+ *
+ * @brief Relay-feedback (Astrom-Hagglund) identification of the vertical axis.
+ *
+ * While running, the control loop hands the position error to this module
+ * instead of the PID, and drives the hoist with a relay: a fixed output whose
+ * sign follows the error, with hysteresis against sensor noise. The relay
+ * switches about a bias, the output that holds the hoist still, so that gravity
+ * does not skew the cycle. The hoist settles into a limit cycle, whose
+ * amplitude a and period give the ultimate gain and period of the loop:
+ *
+ *   Ku = 4 d / (pi sqrt(a^2 - e^2))
+ *
+ * for relay output d and hysteresis e. The first cycles are discarded while
+ * the oscillation settles, and the rest are averaged.
+ *
+ * The hoist does not travel up and down alike, so each direction is identified
+ * on its own: each half-cycle is taken as half of a symmetric cycle of its
+ * direction. A direction's period is twice the time the relay drives that way,
+ * and its amplitude is the overshoot that travel leaves past the setpoint.
+ * Negative output lifts the hoist, and lifting overshoots into positive error.
+ */
+
+/* Module Header */
+#include "L3/Relay_Autotune.h"
+
+/* Standard Libraries */
+#include <stdint.h>
+#include <math.h>
+
+/* User Libraries */
+#include "user_main.h"
+
+#define AUTOTUNE_SETTLE_CYCLES 2
+#define AUTOTUNE_MEASURE_CYCLES 4
+#define AUTOTUNE_TIMEOUT_S 20.0f
+#define AUTOTUNE_MAX_ERROR_MM 40.0f  /* Abort a swing wider than this */
+#define AUTOTUNE_PERIOD_SPREAD 0.25f /* Measured periods must agree within this fraction of their mean */
+#define PI_F 3.14159265f
+
+/* Gain factors of each rule: Kp = kp Ku, Ti = ti Tu, Td = td Tu */
+static const struct
+{
+    float kp;
+    float ti;
+    float td;
+} tuning_rules[AUTOTUNE_RULE_COUNT] = {
+    [AUTOTUNE_RULE_ZIEGLER_NICHOLS] = {0.6f, 0.5f, 0.125f},
+    [AUTOTUNE_RULE_ZIEGLER_NICHOLS_PI] = {0.45f, 0.833f, 0.0f},
+    [AUTOTUNE_RULE_TYREUS_LUYBEN] = {0.4545f, 2.2f, 0.159f},
+    [AUTOTUNE_RULE_NO_OVERSHOOT] = {0.2f, 0.5f, 0.333f},
+};
+
+static volatile Autotune_State_t state = AUTOTUNE_IDLE;
+static float relay_output;
+static float relay_bias;
+static float hysteresis_mm;
+static float elapsed_s;
+static float last_rise_s; /* Time of the last switch to positive output */
+static float last_fall_s; /* Time of the last switch to negative output */
+static float error_max;   /* Extremes since the last switch to positive output */
+static float error_min;
+static float period_sum;
+static float period_min;
+static float period_max;
+static float drive_time_sum[GAIN_DIRECTION_COUNT]; /* Time the relay drove each way */
+static float amplitude_sum[GAIN_DIRECTION_COUNT];
+static int8_t relay_sign;
+static uint8_t cycles;
+static Autotune_Result_t result[GAIN_DIRECTION_COUNT];
+
+static void Complete_Cycle(void);
+
+/**
+ * @brief Start a relay experiment around the current setpoint.
+ *
+ * @param output Relay output magnitude about the bias, pulse width
+ * @param hysteresis Error band, in mm, the error must leave before the relay switches
+ * @param bias Output that holds the hoist at the setpoint, pulse width
+ */
+void Relay_Autotune_Start(float output, float hysteresis, float bias)
+{
+    taskENTER_CRITICAL();
+    relay_output = output;
+    relay_bias = bias;
+    hysteresis_mm = hysteresis;
+    elapsed_s = 0.0f;
+    relay_sign = 0; /* Taken from the first error */
+    cycles = 0;
+    period_sum = 0.0f;
+    period_min = INFINITY;
+    period_max = 0.0f;
+    for (uint8_t direction = 0; direction < GAIN_DIRECTION_COUNT; direction++)
+    {
+        drive_time_sum[direction] = 0.0f;
+        amplitude_sum[direction] = 0.0f;
+    }
+    state = AUTOTUNE_RUNNING;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Stop a running experiment without a result.
+ */
+void Relay_Autotune_Cancel(void)
+{
+    taskENTER_CRITICAL();
+    if (state == AUTOTUNE_RUNNING)
+    {
+        state = AUTOTUNE_IDLE;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Run the relay for one control cycle.
+ *
+ * @param error Setpoint minus measured position
+ * @param dt Time since the previous step in seconds
+ * @return Relay output including the bias, 0 once the experiment has ended
+ */
+float Relay_Autotune_Step(float error, float dt)
+{
+    if (state != AUTOTUNE_RUNNING)
+    {
+        return 0.0f;
+    }
+
+    elapsed_s += dt;
+    if (elapsed_s > AUTOTUNE_TIMEOUT_S || fabsf(error) > AUTOTUNE_MAX_ERROR_MM)
+    {
+        state = AUTOTUNE_FAILED;
+        return 0.0f;
+    }
+
+    if (relay_sign == 0)
+    {
+        relay_sign = (error < 0.0f) ? -1 : 1;
+        error_max = error;
+        error_min = error;
+    }
+    error_max = fmaxf(error_max, error);
+    error_min = fminf(error_min, error);
+
+    if (relay_sign > 0 && error < -hysteresis_mm)
+    {
+        relay_sign = -1;
+        last_fall_s = elapsed_s;
+    }
+    else if (relay_sign < 0 && error > hysteresis_mm)
+    {
+        relay_sign = 1;
+        Complete_Cycle();
+    }
+
+    return (state == AUTOTUNE_RUNNING) ? relay_bias + relay_sign * relay_output : 0.0f;
+}
+
+/**
+ * @brief Account for one full relay cycle, ending on a switch to positive output.
+ *
+ * The first switch only starts the cycle timing.
+ */
+static void Complete_Cycle(void)
+{
+    float period = elapsed_s - last_rise_s;
+    float mean_period;
+    float amplitude;
+
+    if (cycles++ > AUTOTUNE_SETTLE_CYCLES)
+    {
+        period_sum += period;
+        period_min = fminf(period_min, period);
+        period_max = fmaxf(period_max, period);
+        drive_time_sum[GAIN_DIRECTION_DOWN] += last_fall_s - last_rise_s;
+        drive_time_sum[GAIN_DIRECTION_UP] += elapsed_s - last_fall_s;
+        amplitude_sum[GAIN_DIRECTION_UP] += error_max;
+        amplitude_sum[GAIN_DIRECTION_DOWN] -= error_min;
+    }
+    last_rise_s = elapsed_s;
+    error_max = hysteresis_mm;
+    error_min = hysteresis_mm;
+
+    if (cycles <= AUTOTUNE_SETTLE_CYCLES + AUTOTUNE_MEASURE_CYCLES)
+    {
+        return;
+    }
+
+    mean_period = period_sum / AUTOTUNE_MEASURE_CYCLES;
+    if (period_max - period_min > AUTOTUNE_PERIOD_SPREAD * mean_period)
+    {
+        state = AUTOTUNE_FAILED; /* No steady limit cycle */
+        return;
+    }
+
+    for (uint8_t direction = 0; direction < GAIN_DIRECTION_COUNT; direction++)
+    {
+        amplitude = amplitude_sum[direction] / AUTOTUNE_MEASURE_CYCLES;
+        if (amplitude <= hysteresis_mm)
+        {
+            state = AUTOTUNE_FAILED; /* Swings no wider than the hysteresis carry no information */
+            return;
+        }
+        result[direction].ultimate_gain =
+            4.0f * relay_output / (PI_F * sqrtf(amplitude * amplitude - hysteresis_mm * hysteresis_mm));
+        result[direction].ultimate_period_s = 2.0f * drive_time_sum[direction] / AUTOTUNE_MEASURE_CYCLES;
+        result[direction].amplitude_mm = amplitude;
+    }
+    state = AUTOTUNE_DONE;
+}
+
+/**
+ * @brief Check whether the relay is driving the hoist.
+ */
+bool Relay_Autotune_Running(void)
+{
+    return state == AUTOTUNE_RUNNING;
+}
+
+Autotune_State_t Relay_Autotune_Get_State(void)
+{
+    return state;
+}
+
+/**
+ * @brief Copy the result of the last experiment for one direction of travel.
+ *
+ * @return false unless the last experiment completed
+ */
+bool Relay_Autotune_Get_Result(Gain_Direction_t direction, Autotune_Result_t *copy)
+{
+    if (state != AUTOTUNE_DONE || (uint32_t)direction >= GAIN_DIRECTION_COUNT)
+    {
+        return false;
+    }
+    *copy = result[direction];
+    return true;
+}
+
+/**
+ * @brief PID gains from an ultimate gain and period by a tuning rule.
+ *
+ * Ki and Kd are in the parallel form used by the control loop: Ki = Kp / Ti
+ * and Kd = Kp Td.
+ *
+ * @return false for AUTOTUNE_RULE_NONE or an invalid rule
+ */
+bool Relay_Autotune_Gains(Autotune_Rule_t rule, const Autotune_Result_t *identified, float *Kp, float *Ki, float *Kd)
+{
+    if (rule <= AUTOTUNE_RULE_NONE || rule >= AUTOTUNE_RULE_COUNT)
+    {
+        return false;
+    }
+
+    *Kp = tuning_rules[rule].kp * identified->ultimate_gain;
+    *Ki = *Kp / (tuning_rules[rule].ti * identified->ultimate_period_s);
+    *Kd = *Kp * tuning_rules[rule].td * identified->ultimate_period_s;
+    return true;
+}
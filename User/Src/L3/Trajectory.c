@@ -0,0 +1,135 @@
+/**
+ * @file Trajectory.c
+ *
+ * @brief Online jerk-limited trajectory generator for setpoint changes.
+ *
+ * Each step drives the reference towards the target as fast as the velocity,
+ * acceleration and jerk limits allow, giving an S-curve move. The target may
+ * change at any time, including mid-move.
+ *
+ * The velocity aimed for is the fastest from which the reference can still stop
+ * at the target, measured from where it will be once its current acceleration
+ * is ramped out. The acceleration aimed for is the largest that still reaches
+ * that velocity without exceeding the jerk limit. Both are capped to what one
+ * step can reach, so the reference settles exactly on the target rather than
+ * chattering around it.
+ */
+
+/* Module Header */
+#include "L3/Trajectory.h"
+
+/* Standard Libraries */
+#include <stdint.h>
+#include <math.h>
+
+/* User Libraries */
+
+#define TRAJECTORY_MAX_STEP_S 0.0025f /* Longer steps are split to keep the switching curves accurate */
+#define TRAJECTORY_DONE_MM 0.5f
+#define TRAJECTORY_DONE_MM_S 2.0f
+
+static void Trajectory_Substep(Trajectory_t *trajectory, float target_mm, float dt);
+static float Braking_Velocity(const Trajectory_t *trajectory, float distance_mm);
+
+static inline float Sign(float value)
+{
+    return (value < 0.0f) ? -1.0f : 1.0f;
+}
+
+/**
+ * @brief Restart the reference at rest on a position.
+ *
+ * @param trajectory Trajectory to reset
+ * @param position_mm Starting position
+ */
+void Trajectory_Reset(Trajectory_t *trajectory, float position_mm)
+{
+    trajectory->position_mm = position_mm;
+    trajectory->velocity_mm_s = 0.0f;
+    trajectory->acceleration_mm_s2 = 0.0f;
+}
+
+/**
+ * @brief Advance the reference towards a target.
+ *
+ * @param trajectory Trajectory to advance
+ * @param target_mm Position to move to and stop at
+ * @param dt Time step in seconds
+ */
+void Trajectory_Step(Trajectory_t *trajectory, float target_mm, float dt)
+{
+    uint32_t steps;
+
+    if (trajectory->max_velocity_mm_s <= 0.0f)
+    {
+        Trajectory_Reset(trajectory, target_mm);
+        return;
+    }
+
+    steps = (uint32_t)ceilf(dt / TRAJECTORY_MAX_STEP_S);
+    for (uint32_t i = 0; i < steps; i++)
+    {
+        Trajectory_Substep(trajectory, target_mm, dt / (float)steps);
+    }
+}
+
+/**
+ * @brief Check whether the reference has come to rest on a target.
+ */
+bool Trajectory_Done(const Trajectory_t *trajectory, float target_mm)
+{
+    return fabsf(target_mm - trajectory->position_mm) < TRAJECTORY_DONE_MM &&
+           fabsf(trajectory->velocity_mm_s) < TRAJECTORY_DONE_MM_S;
+}
+
+/**
+ * @brief Advance the reference by one step with the jerk that best approaches the target.
+ */
+static void Trajectory_Substep(Trajectory_t *trajectory, float target_mm, float dt)
+{
+    float a = trajectory->acceleration_mm_s2;
+    float v = trajectory->velocity_mm_s;
+    float j_max = trajectory->max_jerk_mm_s3;
+
+    /* Position once the current acceleration is ramped out at full jerk */
+    float ramp = fabsf(a) / j_max;
+    float ramped_position = trajectory->position_mm + v * ramp + a * ramp * ramp / 2.0f -
+                            Sign(a) * j_max * ramp * ramp * ramp / 6.0f;
+    float distance = target_mm - ramped_position;
+
+    float target_velocity = Sign(distance) * fminf(fminf(trajectory->max_velocity_mm_s,
+                                                         Braking_Velocity(trajectory, fabsf(distance))),
+                                                   fabsf(distance) / (2.0f * dt));
+    float velocity_error = target_velocity - v;
+    float target_acceleration = Sign(velocity_error) * fminf(fminf(trajectory->max_acceleration_mm_s2,
+                                                                   sqrtf(2.0f * j_max * fabsf(velocity_error))),
+                                                             fabsf(velocity_error) / (2.0f * dt));
+
+    float jerk = fmaxf(-j_max, fminf(j_max, (target_acceleration - a) / dt));
+
+    trajectory->position_mm += v * dt + a * dt * dt / 2.0f + jerk * dt * dt * dt / 6.0f;
+    trajectory->velocity_mm_s += a * dt + jerk * dt * dt / 2.0f;
+    trajectory->acceleration_mm_s2 += jerk * dt;
+}
+
+/**
+ * @brief Fastest velocity from which a jerk-limited stop covers a distance.
+ *
+ * Inverts the stopping distance starting from zero acceleration: v^2 / 2A + v A / 2J
+ * when the deceleration reaches its limit, v sqrt(v / J) when it does not.
+ *
+ * @param trajectory Trajectory holding the limits
+ * @param distance_mm Distance left to stop in, not negative
+ */
+static float Braking_Velocity(const Trajectory_t *trajectory, float distance_mm)
+{
+    float a_max = trajectory->max_acceleration_mm_s2;
+    float j_max = trajectory->max_jerk_mm_s3;
+    float ramp_velocity = a_max * a_max / (2.0f * j_max);
+
+    if (distance_mm >= a_max * a_max * a_max / (j_max * j_max))
+    {
+        return sqrtf(ramp_velocity * ramp_velocity + 2.0f * a_max * distance_mm) - ramp_velocity;
+    }
+    return cbrtf(distance_mm * distance_mm * j_max);
+}
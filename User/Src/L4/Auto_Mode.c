@@ -75,7 +75,7 @@ void Run_Auto_Mode(void)
     case STATE_AUTO_MOVE_VERTICAL_TO_HOME:
         print_str("Moving vertical to home position\r\n");
         /* Wait for vertical movement to reach home position */
-        if (xEventGroupWaitBits(Motor_Event_Group, MOTOR_EVENT_BIT, pdTRUE, pdTRUE, portMAX_DELAY) & MOTOR_EVENT_BIT)
+        if (Wait_For_Setpoint())
         {
             auto_state = STATE_AUTO_MOVE_HORIZONTAL_TO_LOWER_PICKUP;
         }
@@ -98,7 +98,7 @@ void Run_Auto_Mode(void)
     case STATE_AUTO_MOVE_VERTICAL_TO_LOWER_LATCH:
         print_str("Moving vertical to lower latch position\r\n");
         /* Wait for vertical movement to reach lower latch position */
-        if (xEventGroupWaitBits(Motor_Event_Group, MOTOR_EVENT_BIT, pdTRUE, pdTRUE, portMAX_DELAY) & MOTOR_EVENT_BIT)
+        if (Wait_For_Setpoint())
         {
             auto_state = STATE_AUTO_MOVE_HORIZONTAL_TO_CARRY_POSITION;
         }
@@ -121,7 +121,7 @@ void Run_Auto_Mode(void)
     case STATE_AUTO_MOVE_VERTICAL_TO_UPPER_SHELF:
         print_str("Moving vertical to upper shelf position\r\n");
         /* Wait for vertical movement to reach upper shelf position */
-        if (xEventGroupWaitBits(Motor_Event_Group, MOTOR_EVENT_BIT, pdTRUE, pdTRUE, portMAX_DELAY) & MOTOR_EVENT_BIT)
+        if (Wait_For_Setpoint())
         {
             auto_state = STATE_AUTO_MOVE_HORIZONTAL_TO_UPPER_DROPOFF;
         }
@@ -144,7 +144,7 @@ void Run_Auto_Mode(void)
     case STATE_AUTO_MOVE_VERTICAL_TO_UPPER_DROPOFF:
         print_str("Moving vertical to upper dropoff position\r\n");
         /* Wait for vertical movement to reach upper dropoff position */
-        if (xEventGroupWaitBits(Motor_Event_Group, MOTOR_EVENT_BIT, pdTRUE, pdTRUE, portMAX_DELAY) & MOTOR_EVENT_BIT)
+        if (Wait_For_Setpoint())
         {
             auto_state = STATE_AUTO_MOVE_HORIZONTAL_TO_HOME_FROM_UPPER;
         }
@@ -167,7 +167,7 @@ void Run_Auto_Mode(void)
     case STATE_AUTO_MOVE_VERTICAL_TO_HOME_FROM_UPPER:
         print_str("Moving vertical to home from upper position\r\n");
         /* Wait for vertical movement to reach home position */
-        if (xEventGroupWaitBits(Motor_Event_Group, MOTOR_EVENT_BIT, pdTRUE, pdTRUE, portMAX_DELAY) & MOTOR_EVENT_BIT)
+        if (Wait_For_Setpoint())
         {
             print_str("Automatic mode sequence complete\r\n");
             /* Disable PID */
@@ -3,24 +3,43 @@
  *
  * @brief Implements calibration mode operations for the warehouse crane.
  * Contains state machine logic for servo speeds.
+ *
+ * When a tuning rule is selected, calibration starts with a relay autotune at
+ * mid travel. The identified gains are applied before the calibration moves,
+ * so those moves exercise them.
+ *
+ * The calibration moves run with the full output range, and record the peak
+ * drive the controller asked for. A controller that drives close to the limit
+ * is given a lower output limit for normal operation.
  */
 
 /* Module Header */
 #include "L4/Calibrate_Mode.h"
 
 /* Standard Libraries */
+#include <math.h>
+#include <stddef.h>
 
 /* User Libraries */
 #include "user_main.h"
+#include "Log.h"
 #include "L3/Control_Loop.h"
+#include "L3/Gain_Schedule.h"
 
 #define HOME_POSITION_MM (60)
 #define UPPER_SHELF_POSITION_MM (130)
 #define PWM_MAX (35.0f)
 
+#define AUTOTUNE_POSITION_MM (85)
+#define AUTOTUNE_RELAY_OUTPUT (8.0f)  /* Pulse width adjustment */
+#define AUTOTUNE_HYSTERESIS_MM (1.0f) /* Above the filtered sensor noise */
+#define AUTOTUNE_POLL_MS (50)
+
 typedef enum Calibrate_States
 {
     STATE_CALIBRATE_START = 0,
+    STATE_CALIBRATE_MOVE_VERTICAL_TO_TUNE,
+    STATE_CALIBRATE_AUTOTUNE,
     STATE_CALIBRATE_MOVE_VERTICAL_TO_HOME,
     STATE_CALIBRATE_MOVE_VERTICAL_TO_TOP,
     STATE_CALIBRATE_MOVE_VERTICAL_TO_BOTTOM,
@@ -29,9 +48,13 @@ typedef enum Calibrate_States
 
 extern EventGroupHandle_t Motor_Event_Group;
 static Calibrate_States_t calibrate_state;
+static Autotune_Rule_t autotune_rule = AUTOTUNE_RULE_NONE;
 
 float output_limit = PWM_MAX;
-float max_speed = 0.0f;
+float max_speed = 0.0f; /* Peak pulse width adjustment over the calibration moves */
+
+static float Autotune_Bias(void);
+static void Apply_Autotune_Result(void);
 
 /**
  * @brief Reset and initialize calibration mode.
@@ -39,6 +62,17 @@ float max_speed = 0.0f;
 void Initialize_Calibrate_Mode(void)
 {
     calibrate_state = STATE_CALIBRATE_START;
+    Relay_Autotune_Cancel();
+}
+
+/**
+ * @brief Select the tuning rule for the autotune at the start of calibration.
+ *
+ * @param rule Tuning rule, AUTOTUNE_RULE_NONE to skip the autotune
+ */
+void Set_Autotune_Rule(Autotune_Rule_t rule)
+{
+    autotune_rule = rule;
 }
 
 /**
@@ -50,10 +84,43 @@ void Run_Calibrate_Mode(void)
     {
     case STATE_CALIBRATE_START:
         print_str("Entering calibration mode\r\n");
+        /* Measure with the full output range */
+        output_limit = PWM_MAX;
+        max_speed = 0.0f;
+        Set_PID_Output_Limit(output_limit);
         /* Enable PID */
         Toggle_PID_Control(true);
+        /* Clear Wait for Motor Event */
+        xEventGroupClearBits(Motor_Event_Group, MOTOR_EVENT_BIT);
+        if (autotune_rule != AUTOTUNE_RULE_NONE)
+        {
+            Set_Setpoint(AUTOTUNE_POSITION_MM);
+            calibrate_state = STATE_CALIBRATE_MOVE_VERTICAL_TO_TUNE;
+            break;
+        }
         /* Set Setpoint to home position */
         Set_Setpoint(HOME_POSITION_MM);
+        Control_Loop_Take_Peak_Output(); /* The calibration moves start here */
+        calibrate_state = STATE_CALIBRATE_MOVE_VERTICAL_TO_HOME;
+        break;
+    case STATE_CALIBRATE_MOVE_VERTICAL_TO_TUNE:
+        print_str("Calibrating: Moving vertical to autotune position\r\n");
+        if (!Wait_For_Setpoint())
+        {
+            break; /* Sensor failed; the mode layer takes over */
+        }
+        Relay_Autotune_Start(AUTOTUNE_RELAY_OUTPUT, AUTOTUNE_HYSTERESIS_MM, Autotune_Bias());
+        calibrate_state = STATE_CALIBRATE_AUTOTUNE;
+        break;
+    case STATE_CALIBRATE_AUTOTUNE:
+        if (Relay_Autotune_Running())
+        {
+            vTaskDelay(pdMS_TO_TICKS(AUTOTUNE_POLL_MS));
+            break;
+        }
+        Apply_Autotune_Result();
+        Set_Setpoint(HOME_POSITION_MM);
+        Control_Loop_Take_Peak_Output(); /* The relay's output does not count */
         /* Clear Wait for Motor Event */
         xEventGroupClearBits(Motor_Event_Group, MOTOR_EVENT_BIT);
         calibrate_state = STATE_CALIBRATE_MOVE_VERTICAL_TO_HOME;
@@ -61,7 +128,11 @@ void Run_Calibrate_Mode(void)
     case STATE_CALIBRATE_MOVE_VERTICAL_TO_HOME:
         print_str("Calibrating: Moving vertical to home position\r\n");
         /* Wait for vertical movement to reach home position */
-        xEventGroupWaitBits(Motor_Event_Group, MOTOR_EVENT_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+        if (!Wait_For_Setpoint())
+        {
+            break; /* Sensor failed; the mode layer takes over */
+        }
+        max_speed = fmaxf(max_speed, Control_Loop_Take_Peak_Output());
         Set_Setpoint(UPPER_SHELF_POSITION_MM); /* Move to upper shelf position */
         /* Clear Wait for Motor Event */
         xEventGroupClearBits(Motor_Event_Group, MOTOR_EVENT_BIT);
@@ -69,7 +140,11 @@ void Run_Calibrate_Mode(void)
         break;
     case STATE_CALIBRATE_MOVE_VERTICAL_TO_TOP:
         print_str("Calibrating: Moving vertical to top position\r\n");
-        xEventGroupWaitBits(Motor_Event_Group, MOTOR_EVENT_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+        if (!Wait_For_Setpoint())
+        {
+            break; /* Sensor failed; the mode layer takes over */
+        }
+        max_speed = fmaxf(max_speed, Control_Loop_Take_Peak_Output());
         Set_Setpoint(HOME_POSITION_MM); /* Move to bottom position */
         /* Clear Wait for Motor Event */
         xEventGroupClearBits(Motor_Event_Group, MOTOR_EVENT_BIT);
@@ -77,7 +152,11 @@ void Run_Calibrate_Mode(void)
         break;
     case STATE_CALIBRATE_MOVE_VERTICAL_TO_BOTTOM:
         print_str("Calibrating: Moving vertical to bottom position\r\n");
-        xEventGroupWaitBits(Motor_Event_Group, MOTOR_EVENT_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+        if (!Wait_For_Setpoint())
+        {
+            break; /* Sensor failed; the mode layer takes over */
+        }
+        max_speed = fmaxf(max_speed, Control_Loop_Take_Peak_Output());
         Set_Setpoint(HOME_POSITION_MM); /* Move to home position */
         /* Clear Wait for Motor Event */
         xEventGroupClearBits(Motor_Event_Group, MOTOR_EVENT_BIT);
@@ -86,6 +165,7 @@ void Run_Calibrate_Mode(void)
         {
             output_limit = 0.8f * PWM_MAX;
         }
+        LOG("Calibration peak drive %.1f, output limit %.1f", max_speed, output_limit);
         Set_PID_Output_Limit(output_limit);
         calibrate_state = STATE_CALIBRATE_IDLE;
         break;
@@ -96,4 +176,62 @@ void Run_Calibrate_Mode(void)
         vTaskDelay(pdMS_TO_TICKS(100));
         break;
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Relay bias for the autotune: the output that holds the hoist at the tune point.
+ *
+ * Holding still is neither direction of travel, so the two scheduled offsets are averaged.
+ */
+static float Autotune_Bias(void)
+{
+    Gain_Set_t up;
+    Gain_Set_t down;
+
+    Gain_Schedule_Lookup(GAIN_DIRECTION_UP, AUTOTUNE_POSITION_MM, &up);
+    Gain_Schedule_Lookup(GAIN_DIRECTION_DOWN, AUTOTUNE_POSITION_MM, &down);
+    return (up.offset + down.offset) / 2.0f;
+}
+
+/**
+ * @brief Apply and report the gains from the autotune experiment.
+ *
+ * Each direction gets the gains identified for its own travel. Its row of the
+ * gain schedule is rescaled so that the gains at the tune point match them;
+ * the shape across schedule points is kept. A failed experiment leaves the
+ * gains unchanged.
+ */
+static void Apply_Autotune_Result(void)
+{
+    Autotune_Result_t result[GAIN_DIRECTION_COUNT];
+    Gain_Set_t tuned[GAIN_DIRECTION_COUNT];
+    Gain_Set_t current;
+
+    for (uint8_t direction = 0; direction < GAIN_DIRECTION_COUNT; direction++)
+    {
+        if (!Relay_Autotune_Get_Result((Gain_Direction_t)direction, &result[direction]) ||
+            !Relay_Autotune_Gains(autotune_rule, &result[direction], &tuned[direction].Kp, &tuned[direction].Ki,
+                                  &tuned[direction].Kd) ||
+            !isfinite(tuned[direction].Kp) || !isfinite(tuned[direction].Ki) || !isfinite(tuned[direction].Kd) ||
+            tuned[direction].Kp < 0.0f || tuned[direction].Ki < 0.0f || tuned[direction].Kd < 0.0f)
+        {
+            LOG("Autotune failed, gains unchanged");
+            return;
+        }
+    }
+
+    for (uint8_t direction = 0; direction < GAIN_DIRECTION_COUNT; direction++)
+    {
+        LOG("Autotune direction %u: Ku %.3f, Tu %.3f s, amplitude %.2f mm", direction,
+            result[direction].ultimate_gain, result[direction].ultimate_period_s, result[direction].amplitude_mm);
+
+        Gain_Schedule_Lookup((Gain_Direction_t)direction, AUTOTUNE_POSITION_MM, &current);
+        Gain_Schedule_Rescale_Term((Gain_Direction_t)direction, offsetof(Gain_Set_t, Kp), current.Kp,
+                                   tuned[direction].Kp);
+        Gain_Schedule_Rescale_Term((Gain_Direction_t)direction, offsetof(Gain_Set_t, Ki), current.Ki,
+                                   tuned[direction].Ki);
+        Gain_Schedule_Rescale_Term((Gain_Direction_t)direction, offsetof(Gain_Set_t, Kd), current.Kd,
+                                   tuned[direction].Kd);
+    }
+    Print_PID_Gains();
+}
@@ -5,7 +5,7 @@
  *
  * Modes:
  * - Manual: Direct motor control via switches and buttons.
- * - Calibration: Calibrates maximum speed for vertical sensor.
+ * - Calibration: Calibrates maximum speed for vertical sensor, after an optional PID autotune.
  * - Automatic: Uses closed-loop control to move item from lower to upper shelf.
  */
 
@@ -19,6 +19,9 @@
 
 /* User Libraries */
 #include "user_main.h"
+#include "Log.h"
+#include "L2/Capture.h"
+#include "L3/Control_Loop.h"
 #include <complex.h>
 #include "Mode_Control.h"
 
@@ -26,6 +29,8 @@
 
 static Control_Mode_t current_mode = MODE_MANUAL;
 
+extern EventGroupHandle_t Motor_Event_Group;
+
 /**
  * @brief Task to manage control mode of the crane.
  */
@@ -51,6 +56,15 @@ void Mode_Control_Task(void *pvParameters)
             current_mode = MODE_MANUAL;
             break;
         }
+
+        /* A sensor failure ends any closed-loop sequence */
+        if (Motor_Event_Group != NULL &&
+            (xEventGroupClearBits(Motor_Event_Group, MOTOR_FAULT_BIT) & MOTOR_FAULT_BIT) &&
+            current_mode != MODE_MANUAL)
+        {
+            LOG("Sensor failed in mode %u, switching to manual", current_mode);
+            Transition_Mode(MODE_MANUAL);
+        }
     }
     UNUSED(pvParameters);
 }
@@ -75,4 +89,13 @@ void Transition_Mode(Control_Mode_t new_mode)
     Initialize_Auto_Mode();
 
     current_mode = new_mode;
+    Capture_Trigger(CAPTURE_TRIGGER_MODE);
+}
+
+/**
+ * @brief Get the active control mode
+ */
+Control_Mode_t Get_Control_Mode(void)
+{
+    return current_mode;
 }
\ No newline at end of file
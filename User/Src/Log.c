@@ -0,0 +1,105 @@
+/**
+ * @file Log.c
+ *
+ * @brief Tokenized log records, drained to the Host PC as binary frames.
+ *
+ * Log_Write copies a fixed-size record into a ring inside a short critical
+ * section and returns. Log_Task periodically frames pending records, so no
+ * formatting, framing or kernel call happens at the call site.
+ */
+
+/* Module Header */
+#include "Log.h"
+
+/* Standard Libraries */
+
+/* User Libraries */
+#include "user_main.h"
+#include "L2/Comm_Datalink.h"
+
+#define LOG_RING_LENGTH 32 /* Must be a power of two */
+#define LOG_RING_MASK (LOG_RING_LENGTH - 1)
+#define LOG_DRAIN_PERIOD_MS 10
+
+/* Frame payload layout, little-endian */
+typedef struct __attribute__((packed)) Log_Record
+{
+    uint32_t timestamp_ms;
+    uint16_t id; /* Offset of the format string in .log_strings */
+    uint8_t count;
+    uint32_t arguments[LOG_MAX_ARGUMENTS];
+} Log_Record_t;
+
+static Log_Record_t log_ring[LOG_RING_LENGTH];
+static volatile uint32_t log_head = 0; /* Free-running record counts */
+static volatile uint32_t log_tail = 0;
+static volatile uint32_t log_dropped = 0;
+
+_Static_assert(sizeof(Log_Record_t) <= DATALINK_MAX_PAYLOAD, "Log record exceeds frame payload");
+
+/**
+ * @brief Store a log record for the Host PC. Called through LOG().
+ *
+ * @param id Format string ID
+ * @param arguments Raw argument words
+ * @param count Number of arguments, at most LOG_MAX_ARGUMENTS
+ */
+void Log_Write(uint16_t id, const uint32_t *arguments, uint8_t count)
+{
+    UBaseType_t saved_mask = taskENTER_CRITICAL_FROM_ISR();
+    uint32_t head = log_head;
+
+    if (head - log_tail < LOG_RING_LENGTH)
+    {
+        Log_Record_t *record = &log_ring[head & LOG_RING_MASK];
+
+        record->timestamp_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        record->id = id;
+        record->count = count;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            record->arguments[i] = arguments[i];
+        }
+        __atomic_store_n(&log_head, head + 1, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        log_dropped++;
+    }
+
+    taskEXIT_CRITICAL_FROM_ISR(saved_mask);
+}
+
+/**
+ * @brief Task to frame pending log records for the Host PC.
+ */
+void Log_Task(void *pvParameters)
+{
+    Log_Record_t record;
+
+    while (1)
+    {
+        while (log_tail != log_head)
+        {
+            record = log_ring[log_tail & LOG_RING_MASK];
+            __atomic_store_n(&log_tail, log_tail + 1, __ATOMIC_RELEASE);
+
+            /* Only the used arguments are sent */
+            if (!Datalink_Send_Frame(LOG_OPCODE_RECORD, &record,
+                                     sizeof(record) - (LOG_MAX_ARGUMENTS - record.count) * sizeof(uint32_t)))
+            {
+                log_dropped++;
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_PERIOD_MS));
+    }
+    UNUSED(pvParameters);
+}
+
+/**
+ * @brief Number of log records lost to a full ring or TX ring
+ */
+uint32_t Log_Dropped_Records(void)
+{
+    return log_dropped;
+}
@@ -11,23 +11,103 @@
 /* Module Header */
 #include "user_main.h"
 
+/* Standard Libraries */
+#include <stdio.h>
+
 /* User Libraries */
 #include "Debug.h"
+#include "Log.h"
 #include "L1/USART_Driver.h"
 #include "L1/PWM_Driver.h"
 #include "L1/Ultrasonic_Driver.h"
+#include "L1/Cycle_Counter.h"
 #include "L2/Comm_Datalink.h"
 #include "L2/Sensor_Filter.h"
+#include "L2/Telemetry.h"
+#include "L2/Capture.h"
+#include "L2/Modbus_RTU.h"
+#include "L2/Link_Rate.h"
 #include "L3/Command_Dispatch.h"
 #include "L3/Control_Loop.h"
+#include "L3/Modbus_Registers.h"
 #include "L5/Mode_Control.h"
 
 extern QueueHandle_t PWM_Queue;
 extern QueueHandle_t Command_Queue;
-extern QueueHandle_t Queue_hostPC_UART;
-extern QueueHandle_t Raw_Ultrasonic_Queue;
+extern QueueHandle_t Message_Pool_Queue;
+extern StreamBufferHandle_t Stream_hostPC_UART;
+extern MessageBufferHandle_t Message_hostPC_Frames;
+extern QueueHandle_t Link_Rate_Queue;
+extern SemaphoreHandle_t Link_Rate_Confirm_Semaphore;
 extern QueueHandle_t Filtered_Ultrasonic_Queue;
 extern QueueHandle_t Motor_Setpoint_Queue;
+extern QueueHandle_t Telemetry_Queue;
+
+/* Queue and buffer sizes, shared with the heap budget below */
+#define PWM_QUEUE_LENGTH 2
+#define HOSTPC_STREAM_BYTES 512
+#define HOSTPC_FRAMES_BYTES (2 * (MODBUS_MAX_ADU_LENGTH + sizeof(size_t)))
+
+/*
+ * Tasks created at startup: function, name, stack depth in words, priority above idle.
+ * No stack is below its size before the heap budget. Tasks that grew since get
+ * more: the control loop (estimator, trajectory, PID, capture and telemetry
+ * records) and the tasks that format gains with snprintf (command dispatch,
+ * mode control). The "stacks" command prints each task's unused stack, to be
+ * read after exercising every mode and command; configCHECK_FOR_STACK_OVERFLOW
+ * is only the backstop. Debug tasks have static stacks, see Debug.c.
+ */
+#define USER_TASKS(TASK)                                                                                               \
+    TASK(HostPC_RX_Task, "RX_Task", configMINIMAL_STACK_SIZE + 100, 2)                                                 \
+    TASK(PWM_Timer_Task, "PWM_Timer_Task", configMINIMAL_STACK_SIZE + 100, 2)                                          \
+    TASK(Ultrasonic_Read_Task, "Ultrasonic_Read", configMINIMAL_STACK_SIZE + 100, 2)                                   \
+    TASK(Sensor_Filter_Task, "Sensor_Filter", configMINIMAL_STACK_SIZE + 200, 2)                                       \
+    TASK(Tokenize_Task, "Tokenize Task", configMINIMAL_STACK_SIZE + 100, 2)                                            \
+    TASK(Modbus_Task, "Modbus Task", configMINIMAL_STACK_SIZE + 100, 2)        /* Idle until the link is switched */   \
+    TASK(Link_Rate_Task, "Link Rate Task", configMINIMAL_STACK_SIZE + 100, 2)  /* Host PC baud rate negotiation */     \
+    TASK(Command_Dispatch_Task, "Command Dispatch", configMINIMAL_STACK_SIZE + 300, 2)                                 \
+    TASK(Update_Motor_Setpoint_Task, "Motor Setpoint", configMINIMAL_STACK_SIZE + 100, 2)                              \
+    TASK(Control_Loop_Task, "Control Loop", configMINIMAL_STACK_SIZE + 400, 3) /* Above every other task */            \
+    TASK(Telemetry_Task, "Telemetry Task", configMINIMAL_STACK_SIZE + 200, 1)  /* Below the control loop */            \
+    TASK(Capture_Task, "Capture Task", configMINIMAL_STACK_SIZE + 200, 1)      /* Capture dump on request */           \
+    TASK(Log_Task, "Log Task", configMINIMAL_STACK_SIZE + 200, 1)              /* Tokenized log drain */               \
+    TASK(Mode_Control_Task, "Mode Control", configMINIMAL_STACK_SIZE + 300, 2) /* High level state machine */
+
+/*
+ * FreeRTOS heap budget. heap_4 prefixes every block with an 8-byte header and
+ * rounds it up to 8 bytes. Nothing created here is ever freed, so the budget
+ * is a plain sum: a TCB and a stack per task, a control block plus storage per
+ * queue or buffer. The idle and timer tasks use static memory (cmsis_os2.c).
+ */
+#define HEAP_BLOCK_BYTES(bytes) (((bytes) + 8U + 7U) & ~(size_t)7U)
+#define TASK_HEAP_BYTES(function, name, stack, priority)                                                               \
+    +HEAP_BLOCK_BYTES(sizeof(StaticTask_t)) + HEAP_BLOCK_BYTES((stack) * sizeof(StackType_t))
+#define QUEUE_HEAP_BYTES(length, item_size) HEAP_BLOCK_BYTES(sizeof(StaticQueue_t) + (length) * (item_size))
+#define STREAM_HEAP_BYTES(size) HEAP_BLOCK_BYTES(sizeof(StaticStreamBuffer_t) + (size) + 1U)
+
+#define OBJECT_HEAP_BYTES                                                                                              \
+    (QUEUE_HEAP_BYTES(PWM_QUEUE_LENGTH, sizeof(PWM_Duty_Cycle_t)) +                                                    \
+     2 * QUEUE_HEAP_BYTES(MESSAGE_POOL_SIZE, sizeof(Message_t *)) + /* Command and free message queues */             \
+     STREAM_HEAP_BYTES(HOSTPC_STREAM_BYTES) + STREAM_HEAP_BYTES(HOSTPC_FRAMES_BYTES) +                                 \
+     2 * QUEUE_HEAP_BYTES(1, sizeof(uint32_t)) + /* Link rate request, motor setpoint */                               \
+     2 * QUEUE_HEAP_BYTES(1, 0) +                /* Link rate confirmation, TX space semaphore (USART_Driver.c) */     \
+     QUEUE_HEAP_BYTES(1, sizeof(Filtered_Sample_t)) +                                                                  \
+     QUEUE_HEAP_BYTES(TELEMETRY_QUEUE_LENGTH, sizeof(Telemetry_Record_t)) +                                            \
+     HEAP_BLOCK_BYTES(sizeof(StaticEventGroup_t))) /* Motor events (Control_Loop.c) */
+
+#define HEAP_BUDGET_BYTES ((0 USER_TASKS(TASK_HEAP_BYTES)) + OBJECT_HEAP_BYTES)
+
+_Static_assert(HEAP_BUDGET_BYTES <= configTOTAL_HEAP_SIZE, "configTOTAL_HEAP_SIZE is below the startup heap budget");
+
+/* Task handles in USER_TASKS order, for the stack report */
+#define TASK_INDEX(function, name, stack, priority) USER_TASK_##function,
+enum
+{
+    USER_TASKS(TASK_INDEX) USER_TASK_COUNT
+};
+#undef TASK_INDEX
+
+static TaskHandle_t user_task_handles[USER_TASK_COUNT];
 
 /* Local function prototypes */
 void create_queues(void);
@@ -41,8 +121,12 @@ void user_main(void)
     /* Initialize UART Print functions */
     util_init();
 
+    /* Timestamp source for sensor samples */
+    Cycle_Counter_Init();
+
     /* Create User-made FreeRTOS objects */
     create_queues();
+    Modbus_Registers_Init();
     create_initial_tasks();
 
     vTaskStartScheduler();
@@ -56,60 +140,67 @@ void user_main(void)
 void create_queues(void)
 {
     /* Update PWM pulse widths */
-    PWM_Queue = xQueueCreate(2, sizeof(PWM_Duty_Cycle_t));
-    /* Commands received from Host PC */
-    Command_Queue = xQueueCreate(1, sizeof(Message_t));
-    /* Queue for Host PC UART characters*/
-    Queue_hostPC_UART = xQueueCreate(80, sizeof(uint8_t));
-    /* Queue for Ultrasonic sensor readings */
-    Raw_Ultrasonic_Queue = xQueueCreate(1, sizeof(uint32_t));
+    PWM_Queue = xQueueCreate(PWM_QUEUE_LENGTH, sizeof(PWM_Duty_Cycle_t));
+    /* Commands received from Host PC, passed by pointer */
+    Command_Queue = xQueueCreate(MESSAGE_POOL_SIZE, sizeof(Message_t *));
+    /* Free command messages */
+    Message_Pool_Queue = xQueueCreate(MESSAGE_POOL_SIZE, sizeof(Message_t *));
+    /* Stream buffer for Host PC UART receive chunks */
+    Stream_hostPC_UART = xStreamBufferCreate(HOSTPC_STREAM_BYTES, 1);
+    /* Modbus RTU request frames, delimited by t3.5 of silence */
+    Message_hostPC_Frames = xMessageBufferCreate(HOSTPC_FRAMES_BYTES);
+    /* Requested Host PC baud rate and its confirmation */
+    Link_Rate_Queue = xQueueCreate(1, sizeof(uint32_t));
+    Link_Rate_Confirm_Semaphore = xSemaphoreCreateBinary();
     /* Queue for Filtered Ultrasonic sensor readings */
-    Filtered_Ultrasonic_Queue = xQueueCreate(1, sizeof(uint32_t));
+    Filtered_Ultrasonic_Queue = xQueueCreate(1, sizeof(Filtered_Sample_t));
     /* Queue for Motor Setpoints */
     Motor_Setpoint_Queue = xQueueCreate(1, sizeof(uint32_t));
+    /* Control-loop records waiting to be framed for the Host PC */
+    Telemetry_Queue = xQueueCreate(TELEMETRY_QUEUE_LENGTH, sizeof(Telemetry_Record_t));
+
+    configASSERT(PWM_Queue != NULL && Command_Queue != NULL && Message_Pool_Queue != NULL);
+    configASSERT(Stream_hostPC_UART != NULL && Message_hostPC_Frames != NULL);
+    configASSERT(Link_Rate_Queue != NULL && Link_Rate_Confirm_Semaphore != NULL);
+    configASSERT(Filtered_Ultrasonic_Queue != NULL && Motor_Setpoint_Queue != NULL && Telemetry_Queue != NULL);
 }
 
 /**
  * @brief Create all initial tasks
  *
  * This function is called from user_main() to create the initial tasks before starting the scheduler.
+ * A task that does not fit the heap stops here rather than leaving the system half started.
  */
 void create_initial_tasks(void)
 {
-    /* RX Task to receive communication with Host PC */
-    xTaskCreate(HostPC_RX_Task, "RX_Task", configMINIMAL_STACK_SIZE + 100, NULL,
-                tskIDLE_PRIORITY + 2, NULL);
-    /* Start PWM Timers for servo control */
-    xTaskCreate(PWM_Timer_Task, "PWM_Timer_Task", configMINIMAL_STACK_SIZE + 100, NULL,
-                tskIDLE_PRIORITY + 2, NULL);
-    /* Start Ultrasonic Sensor Read Task */
-    xTaskCreate(Ultrasonic_Read_Task, "Ultrasonic_Read_Task", configMINIMAL_STACK_SIZE + 100, NULL,
-                tskIDLE_PRIORITY + 2, NULL);
-    /* Start Sensor Filter Task */
-    xTaskCreate(Sensor_Filter_Task, "Sensor_Filter_Task", configMINIMAL_STACK_SIZE + 200, NULL,
-                tskIDLE_PRIORITY + 2, NULL);
-    /* Start UART string tokenizer */
-    xTaskCreate(Tokenize_Task, "Tokenize Task", configMINIMAL_STACK_SIZE + 100, NULL,
-                tskIDLE_PRIORITY + 2, NULL);
-    /* Command Dispatch Task */
-    xTaskCreate(Command_Dispatch_Task, "Command Dispatch Task", configMINIMAL_STACK_SIZE + 200, NULL,
-                tskIDLE_PRIORITY + 2, NULL);
-    /* Motor Control Loop Tasks */
-    xTaskCreate(Update_Motor_Setpoint_Task, "Update Motor Setpoint Task", configMINIMAL_STACK_SIZE + 100, NULL,
-                tskIDLE_PRIORITY + 2, NULL);
-    xTaskCreate(Control_Loop_Task, "Control Loop Task", configMINIMAL_STACK_SIZE + 300, NULL,
-                tskIDLE_PRIORITY + 2, NULL);
-
-    /* High Level State Machine Task */
-    xTaskCreate(Mode_Control_Task, "Mode Control Task", configMINIMAL_STACK_SIZE + 200, NULL,
-                tskIDLE_PRIORITY + 2, NULL);
-    /* Debug Tasks */
-    xTaskCreate(Debug_Task1, "Debug_Task1", configMINIMAL_STACK_SIZE + 100, NULL,
-                tskIDLE_PRIORITY + 1, NULL);
-    xTaskCreate(Debug_Task2, "Debug_Task2", configMINIMAL_STACK_SIZE + 100, NULL,
-                tskIDLE_PRIORITY + 1, NULL);
-    xTaskCreate(Debug_Task3, "Debug_Task3", configMINIMAL_STACK_SIZE + 100, NULL,
-                tskIDLE_PRIORITY + 1, NULL);
-    xTaskCreate(Debug_Task4, "Debug_Task4", configMINIMAL_STACK_SIZE + 100, NULL,
-                tskIDLE_PRIORITY + 1, NULL);
-}
\ No newline at end of file
+    BaseType_t created;
+
+#define CREATE_TASK(function, name, stack, priority)                                                                   \
+    created = xTaskCreate(function, name, stack, NULL, tskIDLE_PRIORITY + (priority),                                  \
+                          &user_task_handles[USER_TASK_##function]);                                                   \
+    configASSERT(created == pdPASS);
+    USER_TASKS(CREATE_TASK)
+#undef CREATE_TASK
+    UNUSED(created);
+
+    Debug_Create_Tasks();
+}
+
+/**
+ * @brief Print the unused stack of every startup task
+ *
+ * The high water mark is the least free stack the task has had since it
+ * started, in words. Task context only; the output goes through print_str.
+ */
+void Print_Task_Stacks(void)
+{
+    char line[64];
+
+#define PRINT_TASK_STACK(function, name, stack, priority)                                                              \
+    snprintf(line, sizeof(line), "%-16s %4lu of %4lu words unused\r\n", name,                                          \
+             (unsigned long)uxTaskGetStackHighWaterMark(user_task_handles[USER_TASK_##function]),                      \
+             (unsigned long)(stack));                                                                                   \
+    print_str(line);
+    USER_TASKS(PRINT_TASK_STACK)
+#undef PRINT_TASK_STACK
+}
@@ -8,28 +8,24 @@
 #include <string.h>
 
 #include "FreeRTOS.h"
-#include "semphr.h"
+#include "L1/USART_Driver.h"
 
-#define MAX_RX_BUFFER_LENGTH 40
-
-static SemaphoreHandle_t mutexHandle_print_str;
 extern UART_HandleTypeDef huart2;
 
 void util_init()
 {
-    mutexHandle_print_str = xSemaphoreCreateMutex();
+    HostPC_TX_Init();
 }
 
 static void print_str_local(char *str)
 {
-    HAL_UART_Transmit(&huart2, (uint8_t *)str, strlen(str), HAL_MAX_DELAY);
+    /* Queued to the TX DMA ring; never waits on the wire */
+    HostPC_Transmit((uint8_t *)str, strlen(str));
 }
 
 void print_str(char *str)
 {
-    xSemaphoreTake(mutexHandle_print_str, portMAX_DELAY);
     print_str_local(str);
-    xSemaphoreGive(mutexHandle_print_str);
 }
 void print_str_ISR(char *str)
 {